@@ -31,6 +31,25 @@ typedef BYTE_T BUZZER_MODE_E;
 #define BUZZER_MODE_ONCE    0x01
 #define BUZZER_MODE_FAULT   0x02
 
+/* Buzzer priority, a melody does not cut one of higher priority */
+typedef BYTE_T BUZZER_PRIORITY_E;
+#define BUZZER_PRIORITY_KEY     0x00
+#define BUZZER_PRIORITY_ALARM   0x01
+
+/* Buzzer note */
+typedef struct {
+    uint16_t freq;                      /* Hz, 0-rest */
+    uint16_t time;                      /* ms */
+} BUZZER_NOTE_T;
+
+/* Buzzer melody, keep it const */
+typedef struct {
+    const BUZZER_NOTE_T *note;          /* note array */
+    uint8_t note_num;
+    uint8_t repeat;                     /* times to play, 0-until stopped */
+    BUZZER_PRIORITY_E priority;
+} BUZZER_MELODY_T;
+
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
@@ -47,17 +66,31 @@ void buzzer_pwm_init(void);
 
 /**
  * @brief set buzzer mode
- * @param[in] none
+ * @param[in] mode: buzzer mode
  * @return none
  */
 void set_buzzer_mode(BUZZER_MODE_E mode);
 
 /**
- * @brief update buzzer status
+ * @brief play a melody, unless one of higher priority is playing
+ * @param[in] melody: buzzer melody
+ * @return none
+ */
+void play_buzzer_melody(const BUZZER_MELODY_T *melody);
+
+/**
+ * @brief stop the melody
  * @param[in] none
  * @return none
  */
-void update_buzzer_status(void);
+void stop_buzzer_melody(void);
+
+/**
+ * @brief get buzzer status
+ * @param[in] none
+ * @return buzzer on / buzzer off
+ */
+bool get_buzzer(void);
 
 #ifdef __cplusplus
 }
@@ -21,11 +21,20 @@ extern "C" {
 /***********************************************************
 ************************micro define************************
 ***********************************************************/
+/* Key number */
+#define KEY_NUM_MAX             8       /* bits of KEY_MASK_T */
+#define KEY_COMBO_NUM_MAX       4
 /* Key code */
-#define KEY1_CODE               0x01
-#define KEY2_CODE               0x02
+#define KEY_CODE(idx)           ((KEY_MASK_T)(1 << (idx)))
 /* Key press time */
 #define KEY_PRESS_SHORT_TIME    50
+#define KEY_DOUBLE_CLICK_TIME   300     /* longest gap between the two clicks */
+/* Key scan mode */
+#define KEY_SCAN_MODE_POLL      0       /* scan all the time */
+#define KEY_SCAN_MODE_WAKE      1       /* scan from a key press until the keys are idle */
+#ifndef KEY_SCAN_MODE
+#define KEY_SCAN_MODE           KEY_SCAN_MODE_WAKE
+#endif
 /* Key init result */
 #define KEY_INIT_OK             0
 #define KEY_INIT_ERR            (!KEY_INIT_OK)
@@ -33,17 +42,31 @@ extern "C" {
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+/* Key mask, one bit per key */
+typedef uint8_t KEY_MASK_T;
+
 /* Key define */
 typedef void(* KEY_CALLBACK)();
+typedef struct {
+    uint16_t pin;                       /* key pin, low when pressed */
+    KEY_CALLBACK short_press_cb;        /* short press callback function */
+    KEY_CALLBACK long_press_cb;         /* long press callback function */
+    KEY_CALLBACK double_click_cb;       /* double click callback function */
+    uint32_t long_press_time;           /* long press time set (ms) */
+} KEY_DEF_T;
+
+/* Key combo define */
+typedef struct {
+    KEY_MASK_T code;                    /* keys held together, KEY_CODE(idx) | ... */
+    KEY_CALLBACK press_cb;              /* combo callback function */
+    uint32_t press_time;                /* combo hold time set (ms) */
+} KEY_COMBO_DEF_T;
+
 typedef struct {                        /* user define */
-    uint16_t key1_pin;                  /* ts02n CH1 pin */
-    uint16_t key2_pin;                  /* ts02n CH2 pin */
-    KEY_CALLBACK key1_short_press_cb;   /* key1 short press callback function */
-    KEY_CALLBACK key2_short_press_cb;   /* key2 short press callback function */
-    KEY_CALLBACK key1_long_press_cb;    /* key1 long press callback function */
-    KEY_CALLBACK key2_long_press_cb;    /* key2 long press callback function */
-    uint32_t key1_long_press_time;      /* key1 long press time set (ms) */
-    uint32_t key2_long_press_time;      /* key2 long press time set (ms) */
+    const KEY_DEF_T *key;               /* key define array */
+    uint8_t key_num;                    /* 1 ~ KEY_NUM_MAX */
+    const KEY_COMBO_DEF_T *combo;       /* combo define array, NULL-none */
+    uint8_t combo_num;                  /* 0 ~ KEY_COMBO_NUM_MAX */
     uint32_t scan_time;                 /* Scan cycle set (ms) */
 } TS02N_KEY_DEF_T;
 
@@ -57,17 +80,26 @@ typedef struct {                        /* user define */
 ***********************************************************/
 /**
  * @brief key driver init
- * @param[in] key_def: user key define
+ * @param[in] key_def: user key define, copied in
+ * @return KEY_INIT_OK / KEY_INIT_ERR
+ */
+uint8_t ts02n_key_init(const TS02N_KEY_DEF_T* user_key_def);
+
+/**
+ * @brief note a wake-up that may have been a key press: a pad wake-up, or a main loop pass
+ *        without a suspend, when the pad cannot wake the chip
+ * @param[in] none
  * @return none
  */
-uint8_t ts02n_key_init(TS02N_KEY_DEF_T* user_key_def);
+void ts02n_key_wake_up(void);
 
 /**
- * @brief ts02n key loop
+ * @brief start key scanning if a key is pressed while the scan is stopped,
+ *        the pins are read only after ts02n_key_wake_up()
  * @param[in] none
  * @return none
  */
-void ts02n_key_loop(void);
+void ts02n_key_wake_check(void);
 
 #ifdef __cplusplus
 }
@@ -25,14 +25,33 @@ extern "C" {
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
-/* LED mode */
-typedef BYTE_T LED_MODE_E;
-#define LED_MODE_FIX        0x00
-#define LED_MODE_TWINKLE    0x01
+/* LED ID */
+typedef BYTE_T LED_ID_E;
+#define LED_RED             0x00
+#define LED_ORANGE          0x01
+#define LED_GREEN           0x02
+#define LED_NUM             0x03
+
+/* LED pattern type */
+typedef BYTE_T LED_PATTERN_TYPE_E;
+#define LED_PATTERN_SOLID   0x00    /* on */
+#define LED_PATTERN_BLINK   0x01    /* on_time on, off_time off */
+#define LED_PATTERN_N_BLINK 0x02    /* count blinks, then gap_time off */
+#define LED_PATTERN_BREATHE 0x03    /* PWM fade in over on_time, fade out over off_time, 0 ms-no fade */
+
+/* LED pattern, keep it const */
+typedef struct {
+    LED_PATTERN_TYPE_E type;
+    uint8_t count;                  /* blinks per group, N_BLINK only */
+    uint16_t on_time;               /* ms */
+    uint16_t off_time;              /* ms */
+    uint16_t gap_time;              /* ms, N_BLINK only */
+} LED_PATTERN_T;
 
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
+extern const LED_PATTERN_T g_led_pattern_twinkle;
 
 /***********************************************************
 ***********************function define**********************
@@ -45,39 +64,27 @@ typedef BYTE_T LED_MODE_E;
 void led_init(void);
 
 /**
- * @brief set red led on or off
- * @param[in] b_on_off: led on / led off
- * @return none
- */
-void set_led_red(bool b_on_off);
-
-/**
- * @brief set orange led on or off
+ * @brief set led on or off, shown while no pattern is running
+ * @param[in] id: led id
  * @param[in] b_on_off: led on / led off
  * @return none
  */
-void set_led_orange(bool b_on_off);
-
-/**
- * @brief set green led on or off
- * @param[in] mode: led mode
- * @return none
- */
-void set_led_green_mode(LED_MODE_E mode);
+void set_led(LED_ID_E id, bool b_on_off);
 
 /**
- * @brief set green led status
- * @param[in] status: led status
+ * @brief run a pattern on the led
+ * @param[in] id: led id
+ * @param[in] pattern: led pattern, NULL-back to on or off set by set_led()
  * @return none
  */
-void set_led_green_status(uint8_t status);
+void set_led_pattern(LED_ID_E id, const LED_PATTERN_T *pattern);
 
 /**
- * @brief update led green status
+ * @brief get led PWM status, PWM stops in suspend
  * @param[in] none
- * @return none
+ * @return ON-a led is breathing / OFF
  */
-void update_led_green_status(void);
+bool get_led_pwm(void);
 
 #ifdef __cplusplus
 }
@@ -21,6 +21,13 @@ extern "C" {
 /***********************************************************
 ************************micro define************************
 ***********************************************************/
+/* Temperature filter: median of NTC_SAMPLE_NUM samples, then IIR y += (x - y) / 2^NTC_IIR_SHIFT */
+#ifndef NTC_SAMPLE_NUM
+#define NTC_SAMPLE_NUM          5       /* odd, 1 ~ 9 */
+#endif
+#ifndef NTC_IIR_SHIFT
+#define NTC_IIR_SHIFT           1       /* 0: no IIR */
+#endif
 
 /***********************************************************
 ***********************typedef define***********************
@@ -40,6 +47,14 @@ extern "C" {
  */
 void ntc_adc_init(void);
 
+/**
+ * @brief ntc adc session reset, call after wake-up from suspend: only marks the session lost,
+ *        the next sample initializes the adc again
+ * @param[in] none
+ * @return none
+ */
+void ntc_adc_session_reset(void);
+
 /**
  * @brief get current temperature
  * @param[in] none
@@ -47,6 +62,13 @@ void ntc_adc_init(void);
  */
 uint8_t get_cur_temp(void);
 
+/**
+ * @brief get current temperature in 0.1 degree (median and IIR filtered)
+ * @param[in] none
+ * @return ntc_temp: temperature value (0.1 degree)
+ */
+uint16_t get_cur_temp_x10(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
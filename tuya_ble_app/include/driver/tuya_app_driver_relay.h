@@ -47,6 +47,13 @@ void relay_init(void);
  */
 void set_relay(bool b_on_off);
 
+/**
+ * @brief get relay status
+ * @param[in] none
+ * @return relay on / relay off
+ */
+bool get_relay(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -36,6 +36,15 @@ extern "C" {
 
 void tuya_ble_custom_app_uart_common_process(uint8_t *p_in_data,uint16_t in_len);
 
+//ty_uart_*_send() queue frames in a tx ring, a frame that does not fit waits for the ring to drain
+uint16_t tuya_uart_tx_free(void);
+uint16_t tuya_uart_tx_process(void);
+void tuya_uart_tx_flush(void);
+
+//suspend loses uart rx bytes, the app does not suspend while tuya_uart_rx_busy()
+void tuya_uart_rx_awake(void);
+uint8_t tuya_uart_rx_busy(void);
+
 
 #ifdef __cplusplus
 }
@@ -165,6 +165,11 @@
 /* area size. */
 #define TUYA_NV_AREA_SIZE              (4*TUYA_NV_ERASE_MIN_SIZE)
 
+/* app data start address, the sector right after the sdk area (0x6A000 ~ 0x6AFFF):
+   above the OTA image area, which ends where the sdk area starts (0x66000),
+   and below the BLE pairing and MAC sectors (0x74000 and up) */
+#define APP_NV_START_ADDR              (TUYA_NV_START_ADDR + TUYA_NV_AREA_SIZE)
+
 #endif
 
 
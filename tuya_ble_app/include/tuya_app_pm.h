@@ -0,0 +1,61 @@
+/**
+ * @file tuya_app_pm.h
+ * @author lifan
+ * @brief app tickless idle header file
+ * @version 1.0
+ * @date 2021-07-06
+ *
+ * @copyright Copyright (c) tuya.inc 2021
+ *
+ */
+
+#ifndef __TUYA_APP_PM_H__
+#define __TUYA_APP_PM_H__
+
+#include "tuya_app_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************micro define************************
+***********************************************************/
+/* Tickless idle */
+#ifndef APP_PM_ENABLE
+#define APP_PM_ENABLE       1
+#endif
+#define APP_PM_SLEEP_MIN    3       /* ms, shorter idles are not worth a suspend */
+#define APP_PM_SLEEP_MAX    60000   /* ms, keeps the app timer time base under the tick wrap */
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/**
+ * @brief app power management init
+ * @param[in] none
+ * @return none
+ */
+void app_pm_init(void);
+
+/**
+ * @brief suspend until the next deadline, a key press or the next radio event,
+ *        not while the UART link is active: there is no UART rx wake source
+ * @param[in] sleep_ms: ms until the next deadline, 0-stay awake
+ * @return none
+ */
+void app_pm_idle(uint32_t sleep_ms);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TUYA_APP_PM_H__ */
@@ -43,16 +43,17 @@ void tuya_app_kettle_init(void);
 /**
  * @brief main loop of smart kettle
  * @param[in] none
- * @return none
+ * @return time: ms the kettle may sleep, APP_TIMER_NO_DEADLINE-no timer running
  */
-void tuya_app_kettle_loop(void);
+uint32_t tuya_app_kettle_loop(void);
 
 /**
  * @brief dp data handler of smart kettle
- * @param[in] dp_data: dp data array
+ * @param[in] dp_data: dp data array, one or more DPs (read only, SDK buffer)
+ * @param[in] dp_len: dp data length
  * @return none
  */
-void tuya_app_kettle_dp_data_handler(uint8_t *dp_data);
+void tuya_app_kettle_dp_data_handler(const uint8_t *dp_data, uint16_t dp_len);
 
 /**
  * @brief ble connect status change handler of smart kettle
@@ -61,6 +62,14 @@ void tuya_app_kettle_dp_data_handler(uint8_t *dp_data);
  */
 void tuya_app_kettle_ble_connect_status_change_handler(tuya_ble_connect_status_t status);
 
+/**
+ * @brief dp data report response handler of smart kettle
+ * @param[in] sn: sn of the report
+ * @param[in] status: response status, 0-success
+ * @return none
+ */
+void tuya_app_kettle_dp_report_response_handler(uint16_t sn, uint8_t status);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
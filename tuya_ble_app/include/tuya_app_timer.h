@@ -0,0 +1,116 @@
+/**
+ * @file tuya_app_timer.h
+ * @author lifan
+ * @brief app software timer header file
+ * @version 1.0
+ * @date 2021-07-06
+ *
+ * @copyright Copyright (c) tuya.inc 2021
+ *
+ */
+
+#ifndef __TUYA_APP_TIMER_H__
+#define __TUYA_APP_TIMER_H__
+
+#include "tuya_app_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************micro define************************
+***********************************************************/
+/* No timer running */
+#define APP_TIMER_NO_DEADLINE   0xFFFFFFFF
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+/* Timer callback */
+typedef void(* APP_TIMER_CALLBACK)(void);
+
+/* Timer, storage is owned by the user module */
+typedef struct app_timer {
+    struct app_timer *next;     /* next timer by deadline */
+    APP_TIMER_CALLBACK cb;      /* timeout callback function */
+    uint32_t deadline;          /* ms, next timeout while active, else the last one */
+    uint32_t period;            /* ms, 0-one shot */
+    uint8_t active;
+} APP_TIMER_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/**
+ * @brief app timer init
+ * @param[in] none
+ * @return none
+ */
+void app_timer_init(void);
+
+/**
+ * @brief get app timer time base
+ * @param[in] none
+ * @return time: ms since init, call at least once every 268s
+ */
+uint32_t app_timer_get_ms(void);
+
+/**
+ * @brief start or restart a timer
+ * @param[in] timer: timer
+ * @param[in] timeout: first timeout (ms)
+ * @param[in] period: period after the first timeout (ms), 0-one shot
+ * @param[in] cb: timeout callback function
+ * @return none
+ */
+void app_timer_start(APP_TIMER_T *timer, uint32_t timeout, uint32_t period, APP_TIMER_CALLBACK cb);
+
+/**
+ * @brief start or restart a timer at an absolute deadline
+ * @param[in] timer: timer
+ * @param[in] deadline: first timeout (ms of app_timer_get_ms()), a passed one times out on the next run
+ * @param[in] period: period after the first timeout (ms), 0-one shot
+ * @param[in] cb: timeout callback function
+ * @return none
+ */
+void app_timer_start_at(APP_TIMER_T *timer, uint32_t deadline, uint32_t period, APP_TIMER_CALLBACK cb);
+
+/**
+ * @brief get the next deadline on the grid of base + n * period
+ * @param[in] base: last deadline (ms)
+ * @param[in] period: period (ms)
+ * @return deadline: first grid point after now, missed periods are skipped
+ */
+uint32_t app_timer_next_deadline(uint32_t base, uint32_t period);
+
+/**
+ * @brief stop a timer
+ * @param[in] timer: timer
+ * @return none
+ */
+void app_timer_stop(APP_TIMER_T *timer);
+
+/**
+ * @brief is the timer running
+ * @param[in] timer: timer
+ * @return 0-false 1-true
+ */
+uint8_t app_timer_is_active(const APP_TIMER_T *timer);
+
+/**
+ * @brief run the due timers
+ * @param[in] none
+ * @return time: ms until the next deadline, APP_TIMER_NO_DEADLINE-no timer running
+ */
+uint32_t app_timer_run(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TUYA_APP_TIMER_H__ */
@@ -10,6 +10,7 @@
  */
 
 #include "tuya_app_driver_buzzer.h"
+#include "tuya_app_timer.h"
 #include "tuya_ble_log.h"
 #include "app_config.h"
 #include "gpio_8258.h"
@@ -21,8 +22,10 @@
 ***********************************************************/
 /* PWM ID */
 #define PWM_ID_BUZZER       PWM2_ID     /* PWM2 */
-/* Buzzer timer */
+/* Buzzer note */
+#define BUZZER_FREQ         2000        /* 2KHz */
 #define BUZZER_ONCE_TIME    70          /* 70ms */
+#define BUZZER_FAULT_TIME   1000        /* 1s, repeated */
 
 /***********************************************************
 ***********************typedef define***********************
@@ -31,8 +34,34 @@
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-static uint8_t sg_buzzer_timer = OFF;   /* timer on/off */
-static uint32_t sg_buzzer_tm = 0;       /* timer counter */
+/* Buzzer melody */
+static const BUZZER_NOTE_T sg_note_once[] = {
+    {BUZZER_FREQ, BUZZER_ONCE_TIME},
+};
+static const BUZZER_MELODY_T sg_melody_once = {
+    .note = sg_note_once,
+    .note_num = sizeof(sg_note_once) / sizeof(sg_note_once[0]),
+    .repeat = 1,
+    .priority = BUZZER_PRIORITY_KEY,
+};
+static const BUZZER_NOTE_T sg_note_fault[] = {
+    {BUZZER_FREQ, BUZZER_FAULT_TIME},
+};
+static const BUZZER_MELODY_T sg_melody_fault = {
+    .note = sg_note_fault,
+    .note_num = sizeof(sg_note_fault) / sizeof(sg_note_fault[0]),
+    .repeat = 0,
+    .priority = BUZZER_PRIORITY_ALARM,
+};
+
+static bool sg_buzzer_status = OFF;     /* buzzer on/off */
+static uint16_t sg_buzzer_freq = BUZZER_FREQ;
+static const BUZZER_MELODY_T *sg_melody = NULL;    /* NULL-not playing */
+static uint8_t sg_note_idx = 0;         /* next note */
+static uint8_t sg_repeat_cnt = 0;       /* times played */
+static uint32_t sg_note_deadline = 0;   /* end of the current note (ms) */
+static void buzzer_note_timeout_handler(void);
+static APP_TIMER_T sg_buzzer_timer;
 
 /***********************************************************
 ***********************function define**********************
@@ -58,36 +87,100 @@ void buzzer_pwm_init(void)
  */
 static void set_buzzer(bool b_on_off)
 {
-    static bool s_last_status = 0;
-    if (s_last_status != b_on_off) {
+    if (sg_buzzer_status != b_on_off) {
         if (b_on_off == ON) {
         	pwm_start(PWM_ID_BUZZER);
         } else {
         	pwm_stop(PWM_ID_BUZZER);
             gpio_write(P_BUZZER, 0);
         }
-        s_last_status = b_on_off;
+        sg_buzzer_status = b_on_off;
     }
 }
 
 /**
- * @brief set buzzer mode
+ * @brief set buzzer frequency, the PWM cycle only changes with the note
+ * @param[in] freq: frequency (Hz), 0-off
+ * @return none
+ */
+static void set_buzzer_freq(uint16_t freq)
+{
+    uint32_t cycle;
+
+    if (freq == 0) {
+        set_buzzer(OFF);
+        return;
+    }
+    if (freq != sg_buzzer_freq) {
+        /* 16-bit cycle register: the lowest tones are clamped */
+        cycle = CLOCK_SYS_CLOCK_HZ / freq;
+        if (cycle > 0xFFFF) {
+            cycle = 0xFFFF;
+        }
+        pwm_set_cycle_and_duty(PWM_ID_BUZZER, (uint16_t)cycle, (uint16_t)(cycle >> 1));    /* 50% */
+        sg_buzzer_freq = freq;
+    }
+    set_buzzer(ON);
+}
+
+/**
+ * @brief get buzzer status
  * @param[in] none
+ * @return buzzer on / buzzer off
+ */
+bool get_buzzer(void)
+{
+    return sg_buzzer_status;
+}
+
+/**
+ * @brief play a melody, unless one of higher priority is playing
+ * @param[in] melody: buzzer melody
+ * @return none
+ */
+void play_buzzer_melody(const BUZZER_MELODY_T *melody)
+{
+    if ((melody == NULL) || (melody->note_num == 0)) {
+        return;
+    }
+    if ((sg_melody != NULL) && (melody->priority < sg_melody->priority)) {
+        return;
+    }
+    sg_melody = melody;
+    sg_note_idx = 0;
+    sg_repeat_cnt = 0;
+    sg_note_deadline = app_timer_get_ms();
+    buzzer_note_timeout_handler();          /* first note now */
+}
+
+/**
+ * @brief stop the melody
+ * @param[in] none
+ * @return none
+ */
+void stop_buzzer_melody(void)
+{
+    app_timer_stop(&sg_buzzer_timer);
+    sg_melody = NULL;
+    set_buzzer(OFF);
+}
+
+/**
+ * @brief set buzzer mode
+ * @param[in] mode: buzzer mode
  * @return none
  */
 void set_buzzer_mode(BUZZER_MODE_E mode)
 {
     switch (mode) {
     case BUZZER_MODE_STOP:
-        set_buzzer(OFF);
+        stop_buzzer_melody();
         break;
     case BUZZER_MODE_ONCE:
-        set_buzzer(ON);
-        sg_buzzer_timer = ON;
-        sg_buzzer_tm = clock_time();
+        play_buzzer_melody(&sg_melody_once);
         break;
     case BUZZER_MODE_FAULT:
-        set_buzzer(ON);
+        play_buzzer_melody(&sg_melody_fault);
         break;
     default:
         break;
@@ -95,17 +188,25 @@ void set_buzzer_mode(BUZZER_MODE_E mode)
 }
 
 /**
- * @brief update buzzer status
+ * @brief buzzer note timer handler, plays the next note
  * @param[in] none
  * @return none
  */
-void update_buzzer_status(void)
+static void buzzer_note_timeout_handler(void)
 {
-    if (sg_buzzer_timer == ON) {
-        if (!clock_time_exceed(sg_buzzer_tm, BUZZER_ONCE_TIME*1000)) {
+    const BUZZER_NOTE_T *note;
+
+    if (sg_note_idx >= sg_melody->note_num) {
+        sg_repeat_cnt++;
+        if ((sg_melody->repeat != 0) && (sg_repeat_cnt >= sg_melody->repeat)) {
+            stop_buzzer_melody();
             return;
         }
-        set_buzzer(OFF);
-        sg_buzzer_timer = OFF;
+        sg_note_idx = 0;
     }
+    note = &sg_melody->note[sg_note_idx++];
+    set_buzzer_freq(note->freq);
+    /* from the last note end, so the notes do not drift */
+    sg_note_deadline += note->time;
+    app_timer_start_at(&sg_buzzer_timer, sg_note_deadline, 0, buzzer_note_timeout_handler);
 }
@@ -10,10 +10,11 @@
  */
 
 #include "tuya_app_driver_key.h"
+#include "tuya_app_timer.h"
 #include "tuya_ble_log.h"
-#include "tuya_ble_mem.h"
 #include "gpio_8258.h"
 #include "timer.h"
+#include "pm.h"
 
 /***********************************************************
 ************************micro define************************
@@ -22,54 +23,90 @@
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
-/* Key status */
+/* Key status, masks hold one bit per key */
 typedef struct {
-    uint8_t cur_code;
-    uint8_t prv_code;
-    uint32_t cur_time;
-    uint32_t prv_time;
+    KEY_MASK_T state;                   /* debounced, 1-pressed */
+    KEY_MASK_T cnt0;                    /* vertical debounce counter, bit 0 */
+    KEY_MASK_T cnt1;                    /* vertical debounce counter, bit 1 */
+    KEY_MASK_T long_fired;              /* long press (or press-time short press) handled */
+    KEY_MASK_T click_pending;           /* first click released, waiting for a second */
+    KEY_MASK_T second_click;            /* pressed again inside the double click gap */
+    KEY_MASK_T combo_lock;              /* part of a multi-key press, no single key events */
+    uint32_t press_time[KEY_NUM_MAX];   /* debounced press time (ms) */
+    uint32_t click_time[KEY_NUM_MAX];   /* time since the first click was released (ms) */
+    uint32_t state_time;                /* time since the debounced state changed (ms) */
+    uint32_t scan_ms;                   /* last scan time (ms) */
 } TS02N_KEY_STATUS_T;
 
-/* Key manage */
+/* Key manage, the user define is copied in */
 typedef struct {
-    TS02N_KEY_DEF_T* ts02n_key_def_s;
-    TS02N_KEY_STATUS_T ts02n_key_status_s;
+    TS02N_KEY_STATUS_T status;
+    KEY_DEF_T key[KEY_NUM_MAX];
+    KEY_COMBO_DEF_T combo[KEY_COMBO_NUM_MAX];
+    uint8_t key_num;                    /* 0-not initialized */
+    uint8_t combo_num;
+    uint32_t scan_time;
 } TS02N_KEY_MANAGE_T;
 
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-static TS02N_KEY_MANAGE_T *sg_key_mag = NULL;
+static TS02N_KEY_MANAGE_T sg_key_mag;
+static void key_scan_timeout_handler(void);
+static APP_TIMER_T sg_key_scan_timer;
+/* a wake-up that may have been a key press, ts02n_key_wake_check() reads the pins */
+static volatile uint8_t sg_key_wake_pending = 0;
 
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
 /**
  * @brief key driver init
- * @param[in] key_def: user key define
- * @return none
+ * @param[in] key_def: user key define, copied in
+ * @return KEY_INIT_OK / KEY_INIT_ERR
  */
-uint8_t ts02n_key_init(TS02N_KEY_DEF_T* key_def)
+uint8_t ts02n_key_init(const TS02N_KEY_DEF_T* key_def)
 {
-    /* sg_key_mag init */
-    sg_key_mag = (TS02N_KEY_MANAGE_T *)tuya_ble_malloc(sizeof(TS02N_KEY_MANAGE_T));
-    memset(sg_key_mag, 0, sizeof(TS02N_KEY_MANAGE_T));
-    /* get user key define */
-    sg_key_mag->ts02n_key_def_s = key_def;
-    /* callback function check */
-    if ((key_def->key1_short_press_cb == NULL) && (key_def->key2_short_press_cb == NULL) &&
-        (key_def->key1_long_press_cb == NULL)  && (key_def->key2_long_press_cb == NULL)) {
-        tuya_ble_free((uint8_t *)sg_key_mag);
+    uint8_t i;
+
+    if ((key_def->key == NULL) || (key_def->key_num == 0) || (key_def->key_num > KEY_NUM_MAX) ||
+        ((key_def->combo == NULL) && (key_def->combo_num != 0)) || (key_def->combo_num > KEY_COMBO_NUM_MAX)) {
         return KEY_INIT_ERR;
     }
+    /* sg_key_mag init */
+    app_timer_stop(&sg_key_scan_timer);
+    memset(&sg_key_mag, 0, sizeof(TS02N_KEY_MANAGE_T));
+    /* copy user key define */
+    memcpy(sg_key_mag.key, key_def->key, key_def->key_num * sizeof(KEY_DEF_T));
+    if (key_def->combo_num != 0) {
+        memcpy(sg_key_mag.combo, key_def->combo, key_def->combo_num * sizeof(KEY_COMBO_DEF_T));
+    }
+    sg_key_mag.key_num = key_def->key_num;
+    sg_key_mag.combo_num = key_def->combo_num;
+    sg_key_mag.scan_time = key_def->scan_time;
+    /* debounce counters idle at all ones */
+    sg_key_mag.status.cnt0 = (KEY_MASK_T)~0;
+    sg_key_mag.status.cnt1 = (KEY_MASK_T)~0;
 
     /* gpio init */
-    gpio_set_func(key_def->key1_pin, AS_GPIO);
-    gpio_set_input_en(key_def->key1_pin, 1);
-    gpio_setup_up_down_resistor(key_def->key1_pin, PM_PIN_PULLUP_10K);
-    gpio_set_func(key_def->key2_pin, AS_GPIO);
-    gpio_set_input_en(key_def->key2_pin, 1);
-    gpio_setup_up_down_resistor(key_def->key2_pin, PM_PIN_PULLUP_10K);
+    for (i = 0; i < key_def->key_num; i++) {
+        gpio_set_func(key_def->key[i].pin, AS_GPIO);
+        gpio_set_input_en(key_def->key[i].pin, 1);
+        gpio_setup_up_down_resistor(key_def->key[i].pin, PM_PIN_PULLUP_10K);
+#if (KEY_SCAN_MODE == KEY_SCAN_MODE_WAKE)
+        /* a press wakes up the chip, the scan starts from there */
+        cpu_set_gpio_wakeup(key_def->key[i].pin, Level_Low, 1);
+#endif
+    }
+
+#if (KEY_SCAN_MODE == KEY_SCAN_MODE_WAKE)
+    /* a key held from power-on */
+    sg_key_wake_pending = 1;
+#else
+    /* scan timer */
+    sg_key_mag.status.scan_ms = app_timer_get_ms();
+    app_timer_start(&sg_key_scan_timer, key_def->scan_time, key_def->scan_time, key_scan_timeout_handler);
+#endif
 
     return KEY_INIT_OK;
 }
@@ -77,152 +114,246 @@ uint8_t ts02n_key_init(TS02N_KEY_DEF_T* key_def)
 /**
  * @brief get key code
  * @param[in] none
- * @return key code
+ * @return key code: 1-pressed
  */
-static uint8_t get_key_code(void)
+static KEY_MASK_T get_key_code(void)
 {
-    uint8_t key_code = 0;
-    /* KEY BOIL */
-    if (gpio_read(sg_key_mag->ts02n_key_def_s->key1_pin) == 0) {
-        key_code |= KEY1_CODE;
-    } else {
-        key_code &= ~KEY1_CODE;
-    }
-    /* KEY KEEP */
-    if (gpio_read(sg_key_mag->ts02n_key_def_s->key2_pin) == 0) {
-        key_code |= KEY2_CODE;
-    } else {
-        key_code &= ~KEY2_CODE;
+    KEY_MASK_T key_code = 0;
+    uint8_t i;
+
+    for (i = 0; i < sg_key_mag.key_num; i++) {
+        if (gpio_read(sg_key_mag.key[i].pin) == 0) {
+            key_code |= KEY_CODE(i);
+        }
     }
     return key_code;
 }
 
 /**
- * @brief key driver
+ * @brief debounce all keys at once: a key changes state after 4 equal scans
+ * @param[in] key_code: raw key code
+ * @return changed: keys whose debounced state changed
+ */
+static KEY_MASK_T debounce_key_code(KEY_MASK_T key_code)
+{
+    TS02N_KEY_STATUS_T *status = &sg_key_mag.status;
+    KEY_MASK_T changed;
+
+    /* 2-bit vertical counters, one per key, reset while raw equals the state */
+    changed = status->state ^ key_code;
+    status->cnt0 = ~(status->cnt0 & changed);
+    status->cnt1 = status->cnt0 ^ (status->cnt1 & changed);
+    changed &= status->cnt0 & status->cnt1;
+    status->state ^= changed;
+    return changed;
+}
+
+/**
+ * @brief is time crossing the threshold in this scan
+ * @param[in] time: time after this scan (ms)
+ * @param[in] time_inc: time increment of this scan (ms)
+ * @param[in] threshold: threshold (ms)
+ * @return 0-false 1-true
+ */
+static uint8_t is_time_crossing(uint32_t time, uint32_t time_inc, uint32_t threshold)
+{
+    return ((time >= threshold) && ((time - time_inc) < threshold));
+}
+
+/**
+ * @brief detect and handle single key event
+ * @param[in] idx: key index
+ * @param[in] changed: debounced state changed in this scan
  * @param[in] time_inc: time increment
  * @return none
  */
-static void update_key_status(uint32_t time_inc)
+static void detect_and_handle_single_key_event(uint8_t idx, uint8_t changed, uint32_t time_inc)
 {
-    uint8_t key_code;
+    TS02N_KEY_STATUS_T *status = &sg_key_mag.status;
+    const KEY_DEF_T *key = &sg_key_mag.key[idx];
+    KEY_MASK_T code = KEY_CODE(idx);
 
-    key_code = get_key_code();
-    sg_key_mag->ts02n_key_status_s.prv_time = sg_key_mag->ts02n_key_status_s.cur_time;
-    sg_key_mag->ts02n_key_status_s.cur_time += time_inc;
-
-    if (key_code != sg_key_mag->ts02n_key_status_s.cur_code) {
-        sg_key_mag->ts02n_key_status_s.prv_code = sg_key_mag->ts02n_key_status_s.cur_code;
-        sg_key_mag->ts02n_key_status_s.cur_code = key_code;
-        sg_key_mag->ts02n_key_status_s.prv_time = sg_key_mag->ts02n_key_status_s.cur_time;
-        sg_key_mag->ts02n_key_status_s.cur_time = 0;
-    } else {
-        sg_key_mag->ts02n_key_status_s.prv_code = sg_key_mag->ts02n_key_status_s.cur_code;
+    if (status->state & code) {
+        if (changed) {                              /* pressed */
+            status->press_time[idx] = 0;
+            status->long_fired &= ~code;
+            if (status->click_pending & code) {
+                status->click_pending &= ~code;
+                status->second_click |= code;
+            }
+            return;
+        }
+        status->press_time[idx] += time_inc;
+        if (status->combo_lock & code) {
+            return;
+        }
+        if (key->long_press_cb != NULL) {
+            if (is_time_crossing(status->press_time[idx], time_inc, key->long_press_time)) {
+                status->long_fired |= code;
+                key->long_press_cb();
+                TUYA_APP_LOG_DEBUG("key%d is long pressed", idx + 1);
+            }
+        } else if ((key->double_click_cb == NULL) && (key->short_press_cb != NULL)) {
+            /* no release event needed: short press on the press itself */
+            if (is_time_crossing(status->press_time[idx], time_inc, KEY_PRESS_SHORT_TIME)) {
+                status->long_fired |= code;
+                key->short_press_cb();
+                TUYA_APP_LOG_DEBUG("key%d is pressed", idx + 1);
+            }
+        }
+        return;
+    }
+
+    if (changed) {                                  /* released */
+        if ((status->combo_lock & code) || (status->long_fired & code) ||
+            (status->press_time[idx] < KEY_PRESS_SHORT_TIME)) {
+            status->second_click &= ~code;
+            return;
+        }
+        if (key->double_click_cb != NULL) {
+            if (status->second_click & code) {
+                status->second_click &= ~code;
+                key->double_click_cb();
+                TUYA_APP_LOG_DEBUG("key%d is double clicked", idx + 1);
+            } else {
+                status->click_pending |= code;
+                status->click_time[idx] = 0;
+            }
+        } else if (key->short_press_cb != NULL) {
+            key->short_press_cb();
+            TUYA_APP_LOG_DEBUG("key%d is pressed", idx + 1);
+        }
+        return;
+    }
+
+    if (status->click_pending & code) {             /* no second click in time */
+        status->click_time[idx] += time_inc;
+        if (status->click_time[idx] >= KEY_DOUBLE_CLICK_TIME) {
+            status->click_pending &= ~code;
+            if (key->short_press_cb != NULL) {
+                key->short_press_cb();
+                TUYA_APP_LOG_DEBUG("key%d is pressed", idx + 1);
+            }
+        }
     }
 }
 
 /**
- * @brief is key press over time
- * @param[in] key_code: key code used for judgment
- * @param[in] press_time: press time used for judgment
- * @return 0-false 1-true
+ * @brief detect and handle combo key event
+ * @param[in] changed: keys whose debounced state changed in this scan
+ * @param[in] time_inc: time increment
+ * @return none
  */
-static uint8_t is_key_press_over_time(uint8_t key_code, uint32_t press_time)
+static void detect_and_handle_combo_key_event(KEY_MASK_T changed, uint32_t time_inc)
 {
-    if (sg_key_mag->ts02n_key_status_s.cur_code == key_code) {
-        if ((sg_key_mag->ts02n_key_status_s.cur_time >= press_time) &&
-            (sg_key_mag->ts02n_key_status_s.prv_time < press_time)) {
-            return 1;
+    TS02N_KEY_STATUS_T *status = &sg_key_mag.status;
+    const KEY_COMBO_DEF_T *combo = sg_key_mag.combo;
+    uint8_t i;
+
+    if (changed) {
+        status->state_time = 0;
+    } else {
+        status->state_time += time_inc;
+    }
+    /* more than one key down: the keys only count as a combo until all are released */
+    if (status->state & (status->state - 1)) {
+        status->combo_lock |= status->state;
+    }
+    if ((sg_key_mag.combo_num == 0) || (status->state == 0)) {
+        return;
+    }
+    for (i = 0; i < sg_key_mag.combo_num; i++) {
+        if ((status->state == combo[i].code) && (combo[i].press_cb != NULL) &&
+            is_time_crossing(status->state_time, time_inc, combo[i].press_time)) {
+            combo[i].press_cb();
+            TUYA_APP_LOG_DEBUG("key combo 0x%02x is pressed", combo[i].code);
         }
     }
-    return 0;
 }
 
 /**
- * @brief is key from release to release less time
- * @param[in] key_code: key code used for judgment
- * @param[in] press_time: press time used for judgment
- * @return 0-false 1-true
+ * @brief key driver
+ * @param[in] time_inc: time since the last scan (ms)
+ * @return 0-keys idle 1-keys busy
  */
-static uint8_t is_key_release_to_release_less_time(uint8_t key_code, uint32_t press_time)
+static uint8_t update_key_status(uint32_t time_inc)
 {
-    if ((sg_key_mag->ts02n_key_status_s.prv_code == key_code) &&
-        (sg_key_mag->ts02n_key_status_s.cur_code != key_code)) {
-        if ((sg_key_mag->ts02n_key_status_s.prv_time >= KEY_PRESS_SHORT_TIME) &&
-            (sg_key_mag->ts02n_key_status_s.prv_time < press_time)) {
-            return 1;
+    TS02N_KEY_STATUS_T *status = &sg_key_mag.status;
+    KEY_MASK_T key_code, changed, active;
+    uint8_t i;
+
+    key_code = get_key_code();
+    changed = debounce_key_code(key_code);
+    detect_and_handle_combo_key_event(changed, time_inc);
+    /* only keys that are down, just released or waiting for a second click need work */
+    active = status->state | changed | status->click_pending;
+    for (i = 0; active != 0; i++, active >>= 1) {
+        if (active & 0x01) {
+            detect_and_handle_single_key_event(i, (changed >> i) & 0x01, time_inc);
         }
     }
-    return 0;
+    if (status->state == 0) {
+        status->combo_lock = 0;
+    }
+    /* released, debounce counters back at rest and no click to resolve */
+    return ((status->state | key_code | status->click_pending) != 0);
 }
 
 /**
- * @brief detect and handle key event
+ * @brief key scan timer handler
  * @param[in] none
  * @return none
  */
-static void detect_and_handle_key_event(void)
+static void key_scan_timeout_handler(void)
 {
-    /* key1 handler */
-    if (sg_key_mag->ts02n_key_def_s->key1_long_press_cb != NULL) {
-        /* long press */
-        if (is_key_press_over_time(KEY1_CODE, sg_key_mag->ts02n_key_def_s->key1_long_press_time)) {
-            sg_key_mag->ts02n_key_def_s->key1_long_press_cb();
-            TUYA_APP_LOG_DEBUG("key1 is long pressed");
-        }
-        /* short press */
-        if (sg_key_mag->ts02n_key_def_s->key1_short_press_cb != NULL) {
-            if (is_key_release_to_release_less_time(KEY1_CODE, sg_key_mag->ts02n_key_def_s->key1_long_press_time)) {
-                sg_key_mag->ts02n_key_def_s->key1_short_press_cb();
-                TUYA_APP_LOG_DEBUG("key1 is pressed");
-            }
-        }
-    } else {
-        /* short press */
-        if (sg_key_mag->ts02n_key_def_s->key1_short_press_cb != NULL) {
-            if (is_key_press_over_time(KEY1_CODE, KEY_PRESS_SHORT_TIME)) {
-                sg_key_mag->ts02n_key_def_s->key1_short_press_cb();
-                TUYA_APP_LOG_DEBUG("key1 is pressed");
-            }
-        }
-    }
-    /* key2 handler */
-    if (sg_key_mag->ts02n_key_def_s->key2_long_press_cb != NULL) {
-        /* long press */
-        if (is_key_press_over_time(KEY2_CODE, sg_key_mag->ts02n_key_def_s->key2_long_press_time)) {
-            sg_key_mag->ts02n_key_def_s->key2_long_press_cb();
-            TUYA_APP_LOG_DEBUG("key2 is long pressed");
-        }
-        /* short press */
-        if (sg_key_mag->ts02n_key_def_s->key2_short_press_cb != NULL) {
-            if (is_key_release_to_release_less_time(KEY2_CODE, sg_key_mag->ts02n_key_def_s->key2_long_press_time)) {
-                sg_key_mag->ts02n_key_def_s->key2_short_press_cb();
-                TUYA_APP_LOG_DEBUG("key2 is pressed");
-            }
-        }
-    } else {
-        /* short press */
-        if (sg_key_mag->ts02n_key_def_s->key2_short_press_cb != NULL) {
-            if (is_key_press_over_time(KEY2_CODE, KEY_PRESS_SHORT_TIME)) {
-                sg_key_mag->ts02n_key_def_s->key2_short_press_cb();
-                TUYA_APP_LOG_DEBUG("key2 is pressed");
-            }
-        }
+    TS02N_KEY_STATUS_T *status = &sg_key_mag.status;
+    uint32_t now, time_inc;
+
+    /* measured, not the nominal scan time: a late scan still counts the real hold time */
+    now = app_timer_get_ms();
+    time_inc = now - status->scan_ms;
+    status->scan_ms = now;
+#if (KEY_SCAN_MODE == KEY_SCAN_MODE_WAKE)
+    if (update_key_status(time_inc) == 0) {
+        app_timer_stop(&sg_key_scan_timer);     /* until the next press wakes us up */
     }
+#else
+    update_key_status(time_inc);
+#endif
 }
 
 /**
- * @brief ts02n key loop
+ * @brief note a wake-up that may have been a key press: a pad wake-up, or a main loop pass
+ *        without a suspend, when the pad cannot wake the chip
  * @param[in] none
  * @return none
  */
-void ts02n_key_loop(void)
+void ts02n_key_wake_up(void)
 {
-    static uint32_t s_key_scan_tm = 0;
-
-	if (!clock_time_exceed(s_key_scan_tm, (sg_key_mag->ts02n_key_def_s->scan_time)*1000)) {
-		return;
-	}
-	s_key_scan_tm = clock_time();
-    update_key_status(sg_key_mag->ts02n_key_def_s->scan_time);
-    detect_and_handle_key_event();
+#if (KEY_SCAN_MODE == KEY_SCAN_MODE_WAKE)
+    sg_key_wake_pending = 1;
+#endif
+}
+
+/**
+ * @brief start key scanning if a key is pressed while the scan is stopped,
+ *        the pins are read only after ts02n_key_wake_up()
+ * @param[in] none
+ * @return none
+ */
+void ts02n_key_wake_check(void)
+{
+#if (KEY_SCAN_MODE == KEY_SCAN_MODE_WAKE)
+    if (!sg_key_wake_pending) {
+        return;
+    }
+    sg_key_wake_pending = 0;
+    if ((sg_key_mag.key_num == 0) || app_timer_is_active(&sg_key_scan_timer)) {
+        return;
+    }
+    if (get_key_code() != 0) {
+        sg_key_mag.status.scan_ms = app_timer_get_ms();
+        app_timer_start(&sg_key_scan_timer, 0, sg_key_mag.scan_time, key_scan_timeout_handler);
+    }
+#endif
 }
@@ -10,26 +10,67 @@
  */
 
 #include "tuya_app_driver_led.h"
+#include "tuya_app_timer.h"
 #include "tuya_ble_log.h"
+#include "app_config.h"
 #include "gpio_8258.h"
+#include "pwm.h"
 #include "timer.h"
 
 /***********************************************************
 ************************micro define************************
 ***********************************************************/
 /* LED time */
-#define LED_TWINKLE_TIME  200  /* 0.2s */
+#define LED_TWINKLE_TIME    200     /* 0.2s */
+#define LED_BREATHE_STEP    20      /* 20ms per brightness step */
+/* LED PWM, the PWM clock is the system clock set in buzzer_pwm_init() */
+#define LED_PWM_CYCLE       ((uint16_t)(1000 * CLOCK_SYS_CLOCK_1US))    /* 1ms 1KHz */
+#define LED_LEVEL_MAX       255
+/* deadline a is before or at b, wrap safe */
+#define IS_TIME_BEFORE_EQ(a, b)     ((int32_t)((a) - (b)) <= 0)
 
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+/* LED channel define */
+typedef struct {
+    uint16_t pin;                   /* low when on */
+    uint8_t pwm_id;
+    uint8_t pwm_func;               /* pin function of pwm_id */
+} LED_CHANNEL_DEF_T;
+
+/* LED channel status */
+typedef struct {
+    const LED_PATTERN_T *pattern;   /* NULL-show base */
+    uint32_t deadline;              /* next pattern step (ms) */
+    bool timed;                     /* pattern steps to come */
+    uint16_t step;                  /* blink: on/off phase index, breathe: time in the cycle (ms) */
+    bool base;                      /* on/off without a pattern */
+    bool out;                       /* on/off to show */
+    bool written;                   /* on/off last written to the pin */
+} LED_CHANNEL_T;
 
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-/* LED green */
-LED_MODE_E g_led_green_mode = LED_MODE_FIX;
-uint8_t g_led_green_status = OFF;
+/* LED pattern */
+const LED_PATTERN_T g_led_pattern_twinkle = {
+    .type = LED_PATTERN_BLINK,
+    .count = 0,
+    .on_time = LED_TWINKLE_TIME,
+    .off_time = LED_TWINKLE_TIME,
+    .gap_time = 0,
+};
+
+/* LED channel */
+static const LED_CHANNEL_DEF_T sg_led_def[LED_NUM] = {
+    {P_LED_RED,     PWM5_ID, AS_PWM5},
+    {P_LED_ORANGE,  PWM4_ID, AS_PWM4},
+    {P_LED_GREEN,   PWM3_ID, AS_PWM3},
+};
+static LED_CHANNEL_T sg_led[LED_NUM];
+static void led_timeout_handler(void);
+static APP_TIMER_T sg_led_timer;
 
 /***********************************************************
 ***********************function define**********************
@@ -41,116 +82,235 @@ uint8_t g_led_green_status = OFF;
  */
 void led_init(void)
 {
-	gpio_set_func(P_LED_RED, AS_GPIO);
-    gpio_set_output_en(P_LED_RED, 1);
-    gpio_write(P_LED_RED, 1);
-    gpio_set_func(P_LED_ORANGE, AS_GPIO);
-    gpio_set_output_en(P_LED_ORANGE, 1);
-    gpio_write(P_LED_ORANGE, 1);
-    gpio_set_output_en(P_LED_GREEN, 1);
-	gpio_set_func(P_LED_GREEN, AS_GPIO);
-    gpio_write(P_LED_GREEN, 1);
+    uint8_t i;
+
+    memset(sg_led, 0, sizeof(sg_led));
+    for (i = 0; i < LED_NUM; i++) {
+        gpio_set_func(sg_led_def[i].pin, AS_GPIO);
+        gpio_set_output_en(sg_led_def[i].pin, 1);
+        gpio_write(sg_led_def[i].pin, 1);
+        pwm_set_mode(sg_led_def[i].pwm_id, PWM_NORMAL_MODE);
+    }
 }
 
 /**
- * @brief set red led on or off
- * @param[in] b_on_off: led on / led off
+ * @brief write the changed led outputs, one register write per port
+ * @param[in] none
  * @return none
  */
-void set_led_red(bool b_on_off)
+static void write_led_port(void)
 {
-    static bool s_last_status = 0;
-    if (s_last_status != b_on_off) {
-        if (b_on_off == ON) {
-        	gpio_write(P_LED_RED, 0);
+    uint16_t port[LED_NUM];
+    uint8_t on_mask[LED_NUM], off_mask[LED_NUM];
+    uint8_t port_num = 0;
+    uint8_t i, j;
+
+    for (i = 0; i < LED_NUM; i++) {
+        if ((sg_led[i].out == sg_led[i].written) ||
+            ((sg_led[i].pattern != NULL) && (sg_led[i].pattern->type == LED_PATTERN_BREATHE))) {
+            continue;                       /* unchanged, or driven by PWM */
+        }
+        sg_led[i].written = sg_led[i].out;
+        for (j = 0; j < port_num; j++) {
+            if (port[j] == (sg_led_def[i].pin & 0xFF00)) {
+                break;
+            }
+        }
+        if (j == port_num) {
+            port[j] = sg_led_def[i].pin & 0xFF00;
+            on_mask[j] = 0;
+            off_mask[j] = 0;
+            port_num++;
+        }
+        if (sg_led[i].out == ON) {
+            on_mask[j] |= (uint8_t)sg_led_def[i].pin;
         } else {
-        	gpio_write(P_LED_RED, 1);
+            off_mask[j] |= (uint8_t)sg_led_def[i].pin;
         }
-        s_last_status = b_on_off;
+    }
+    for (j = 0; j < port_num; j++) {
+        /* low is on */
+        reg_gpio_out(port[j]) = (reg_gpio_out(port[j]) & ~on_mask[j]) | off_mask[j];
     }
 }
 
 /**
- * @brief set orange led on or off
- * @param[in] b_on_off: led on / led off
+ * @brief set led breathing brightness
+ * @param[in] id: led id
  * @return none
  */
-void set_led_orange(bool b_on_off)
+static void set_led_breathe_level(LED_ID_E id)
 {
-    static bool s_last_status = 0;
-    if (s_last_status != b_on_off) {
-        if (b_on_off == ON) {
-        	gpio_write(P_LED_ORANGE, 0);
+    const LED_PATTERN_T *pattern = sg_led[id].pattern;
+    uint32_t level;
+
+    /* a zero on_time or off_time is a step: straight to full on, or straight to off */
+    if (sg_led[id].step < pattern->on_time) {
+        level = (uint32_t)sg_led[id].step * LED_LEVEL_MAX / pattern->on_time;
+    } else if (pattern->off_time == 0) {
+        level = LED_LEVEL_MAX;
+    } else {
+        level = (uint32_t)(pattern->on_time + pattern->off_time - sg_led[id].step) * LED_LEVEL_MAX / pattern->off_time;
+    }
+    /* squared for an even fade to the eye, low is on */
+    level = (uint32_t)LED_PWM_CYCLE * level * level / (LED_LEVEL_MAX * LED_LEVEL_MAX);
+    pwm_set_cmp(sg_led_def[id].pwm_id, (uint16_t)(LED_PWM_CYCLE - level));
+}
+
+/**
+ * @brief move the led pattern on by one step
+ * @param[in] id: led id
+ * @return time: time of this step (ms), 0-no more steps
+ */
+static uint32_t run_led_pattern_step(LED_ID_E id)
+{
+    LED_CHANNEL_T *led = &sg_led[id];
+    const LED_PATTERN_T *pattern = led->pattern;
+    uint32_t time = 0;
+
+    switch (pattern->type) {
+    case LED_PATTERN_SOLID:
+        led->out = ON;
+        break;
+    case LED_PATTERN_BLINK:
+        led->out = ((led->step & 0x01) == 0) ? ON : OFF;
+        time = (led->out == ON) ? pattern->on_time : pattern->off_time;
+        led->step = (led->step + 1) & 0x01;
+        break;
+    case LED_PATTERN_N_BLINK:
+        led->out = ((led->step & 0x01) == 0) ? ON : OFF;
+        if (led->out == ON) {
+            time = pattern->on_time;
+        } else if (led->step + 1 < (pattern->count << 1)) {
+            time = pattern->off_time;
         } else {
-        	gpio_write(P_LED_ORANGE, 1);
+            time = pattern->gap_time;       /* end of the group */
+        }
+        led->step++;
+        if (led->step >= (pattern->count << 1)) {
+            led->step = 0;
         }
-        s_last_status = b_on_off;
+        break;
+    case LED_PATTERN_BREATHE:
+        set_led_breathe_level(id);
+        time = LED_BREATHE_STEP;
+        led->step += LED_BREATHE_STEP;
+        if (led->step >= pattern->on_time + pattern->off_time) {
+            led->step = 0;
+        }
+        break;
+    default:
+        break;
     }
+    return time;
 }
 
 /**
- * @brief set green led on or off
- * @param[in] b_on_off: led on / led off
+ * @brief led timer handler, runs the due pattern steps of all leds
+ * @param[in] none
  * @return none
  */
-static void set_led_green(bool b_on_off)
+static void led_timeout_handler(void)
 {
-    static bool s_last_status = 0;
+    uint32_t now, time, next = 0;
+    uint8_t i, running = 0;
 
-    if (s_last_status != b_on_off) {
-        if (b_on_off == ON) {
-        	gpio_write(P_LED_GREEN, 0);
-        } else {
-        	gpio_write(P_LED_GREEN, 1);
+    now = app_timer_get_ms();
+    for (i = 0; i < LED_NUM; i++) {
+        if ((sg_led[i].pattern == NULL) || (sg_led[i].timed == 0)) {
+            continue;
+        }
+        if (IS_TIME_BEFORE_EQ(sg_led[i].deadline, now)) {
+            time = run_led_pattern_step(i);
+            if (time == 0) {
+                sg_led[i].timed = 0;
+                continue;
+            }
+            /* from the deadline, unless a stall has already passed the next one */
+            sg_led[i].deadline += time;
+            if (IS_TIME_BEFORE_EQ(sg_led[i].deadline, now)) {
+                sg_led[i].deadline = now + time;
+            }
+        }
+        if ((running == 0) || IS_TIME_BEFORE_EQ(sg_led[i].deadline, next)) {
+            next = sg_led[i].deadline;
         }
-        s_last_status = b_on_off;
+        running = 1;
+    }
+    write_led_port();
+    if (running) {
+        app_timer_start_at(&sg_led_timer, next, 0, led_timeout_handler);
+    } else {
+        app_timer_stop(&sg_led_timer);
     }
 }
 
 /**
- * @brief set green led on or off
- * @param[in] mode: led mode
+ * @brief set led on or off, shown while no pattern is running
+ * @param[in] id: led id
+ * @param[in] b_on_off: led on / led off
  * @return none
  */
-void set_led_green_mode(LED_MODE_E mode)
+void set_led(LED_ID_E id, bool b_on_off)
 {
-    g_led_green_mode = mode;
+    if (id >= LED_NUM) {
+        return;
+    }
+    sg_led[id].base = b_on_off;
+    if (sg_led[id].pattern == NULL) {
+        sg_led[id].out = b_on_off;
+        write_led_port();
+    }
 }
 
 /**
- * @brief set green led status
- * @param[in] status: led status
+ * @brief run a pattern on the led
+ * @param[in] id: led id
+ * @param[in] pattern: led pattern, NULL-back to on or off set by set_led()
  * @return none
  */
-void set_led_green_status(uint8_t status)
+void set_led_pattern(LED_ID_E id, const LED_PATTERN_T *pattern)
 {
-    g_led_green_status = status;
+    const LED_PATTERN_T *last;
+
+    if ((id >= LED_NUM) || (sg_led[id].pattern == pattern)) {
+        return;
+    }
+    last = sg_led[id].pattern;
+    if ((last != NULL) && (last->type == LED_PATTERN_BREATHE)) {
+        pwm_stop(sg_led_def[id].pwm_id);
+        gpio_set_func(sg_led_def[id].pin, AS_GPIO);
+    }
+    if ((pattern != NULL) && (pattern->type == LED_PATTERN_BREATHE)) {
+        pwm_set_cycle_and_duty(sg_led_def[id].pwm_id, LED_PWM_CYCLE, LED_PWM_CYCLE);
+        gpio_set_func(sg_led_def[id].pin, sg_led_def[id].pwm_func);
+        pwm_start(sg_led_def[id].pwm_id);
+    }
+    sg_led[id].pattern = pattern;
+    sg_led[id].step = 0;
+    if (pattern == NULL) {
+        sg_led[id].out = sg_led[id].base;
+        sg_led[id].timed = 0;
+    } else {
+        sg_led[id].deadline = app_timer_get_ms();
+        sg_led[id].timed = 1;
+    }
+    led_timeout_handler();                  /* first step now, and reschedule */
 }
 
 /**
- * @brief update led green status
+ * @brief get led PWM status, PWM stops in suspend
  * @param[in] none
- * @return none
+ * @return ON-a led is breathing / OFF
  */
-void update_led_green_status(void)
+bool get_led_pwm(void)
 {
-    static bool s_status = 0;
-    static uint32_t s_twinkle_tm = 0;
+    uint8_t i;
 
-    switch (g_led_green_mode) {
-    case LED_MODE_FIX:
-        set_led_green(g_led_green_status);
-        s_twinkle_tm = 0;
-        break;
-    case LED_MODE_TWINKLE:
-        if (!clock_time_exceed(s_twinkle_tm, LED_TWINKLE_TIME*1000)) {
-            break;
+    for (i = 0; i < LED_NUM; i++) {
+        if ((sg_led[i].pattern != NULL) && (sg_led[i].pattern->type == LED_PATTERN_BREATHE)) {
+            return ON;
         }
-        s_twinkle_tm = clock_time();
-        s_status = !s_status;
-        set_led_green(s_status);
-        break;
-    default:
-        break;
     }
+    return OFF;
 }
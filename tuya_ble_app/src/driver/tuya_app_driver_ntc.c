@@ -21,6 +21,18 @@
 /* Temperature-voltage array related */
 #define TEMP_ARRAY_MIN_VALUE    0
 #define TEMP_ARRAY_SIZE         120
+/* Voltage-temperature array related */
+#define VOL_ARRAY_MIN_VALUE     190     /* vol_data_of_temp[0] */
+#define VOL_ARRAY_MAX_VALUE     2769    /* vol_data_of_temp[TEMP_ARRAY_SIZE-1] */
+#define VOL_STEP_SHIFT          3       /* 8mV per step */
+#define VOL_ARRAY_SIZE          (((VOL_ARRAY_MAX_VALUE - VOL_ARRAY_MIN_VALUE) >> VOL_STEP_SHIFT) + 1)
+/* Temperature filter limits, the filter is set in tuya_app_driver_ntc.h */
+#if ((NTC_SAMPLE_NUM % 2) == 0) || (NTC_SAMPLE_NUM > 9)
+#error "NTC_SAMPLE_NUM must be odd and not more than 9"
+#endif
+#if (NTC_IIR_SHIFT > 4)
+#error "NTC_IIR_SHIFT must not be more than 4"
+#endif
 
 /***********************************************************
 ***********************typedef define***********************
@@ -29,7 +41,14 @@
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-/* Voltage value corresponding to NTC(B3950/100K) temperature */
+/* ADC session: initialized once, lost after suspend */
+static uint8_t sg_ntc_adc_ready = 0;
+/* IIR filter state: filtered temperature (0.1 degree) << NTC_IIR_SHIFT */
+static uint32_t sg_ntc_iir_acc = 0;
+static uint8_t sg_ntc_iir_ready = 0;
+
+/* Voltage value corresponding to NTC(B3950/100K) temperature, from the vendor R-T table
+   (the part and the divider are in test/ntc_table.h) */
 const uint16_t vol_data_of_temp[TEMP_ARRAY_SIZE] = {
      190,  199,  209,  219,  229,  240,  251,  263,  275,  288,  301,  314,  328,  342,  357,  372,  388,  404,  420,  437, /* 0 ~ 19 */
      455,  473,  491,  510,  530,  549,  570,  591,  612,  634,  656,  679,  702,  725,  749,  774,  799,  824,  849,  875, /* 20 ~ 39 */
@@ -39,6 +58,30 @@ const uint16_t vol_data_of_temp[TEMP_ARRAY_SIZE] = {
     2480, 2498, 2516, 2534, 2551, 2568, 2584, 2600, 2616, 2632, 2647, 2662, 2676, 2690, 2704, 2718, 2731, 2744, 2757, 2769  /* 100 ~ 119 */
 };
 
+/* Temperature of the first voltage of each 8mV step, generated from vol_data_of_temp
+   by test/gen_ntc_table (make ntc_table).
+   Adjacent temperatures are at least 9mV apart, so a step holds at most one change of
+   the nearest temperature, which is resolved by one comparison. */
+const uint8_t temp_data_of_vol[VOL_ARRAY_SIZE] = {
+      0,   1,   2,   3,   3,   4,   5,   6,   6,   7,   8,   8,   9,   9,  10,  11,  11,  12,  12,  13, /*  190 ~  349 mV */
+     14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,  20,  20,  20,  21,  21,  22,  22,  23, /*  350 ~  509 mV */
+     23,  23,  24,  24,  25,  25,  25,  26,  26,  27,  27,  27,  28,  28,  28,  29,  29,  30,  30,  30, /*  510 ~  669 mV */
+     31,  31,  31,  32,  32,  32,  33,  33,  33,  34,  34,  34,  35,  35,  35,  36,  36,  36,  37,  37, /*  670 ~  829 mV */
+     37,  38,  38,  38,  39,  39,  39,  39,  40,  40,  40,  41,  41,  41,  42,  42,  42,  42,  43,  43, /*  830 ~  989 mV */
+     43,  44,  44,  44,  44,  45,  45,  45,  46,  46,  46,  46,  47,  47,  47,  48,  48,  48,  48,  49, /*  990 ~ 1149 mV */
+     49,  49,  49,  50,  50,  50,  51,  51,  51,  51,  52,  52,  52,  53,  53,  53,  53,  54,  54,  54, /* 1150 ~ 1309 mV */
+     54,  55,  55,  55,  56,  56,  56,  56,  57,  57,  57,  57,  58,  58,  58,  58,  59,  59,  59,  60, /* 1310 ~ 1469 mV */
+     60,  60,  60,  61,  61,  61,  61,  62,  62,  62,  63,  63,  63,  63,  64,  64,  64,  64,  65,  65, /* 1470 ~ 1629 mV */
+     65,  66,  66,  66,  66,  67,  67,  67,  67,  68,  68,  68,  69,  69,  69,  69,  70,  70,  70,  71, /* 1630 ~ 1789 mV */
+     71,  71,  71,  72,  72,  72,  73,  73,  73,  73,  74,  74,  74,  75,  75,  75,  75,  76,  76,  76, /* 1790 ~ 1949 mV */
+     77,  77,  77,  78,  78,  78,  78,  79,  79,  79,  80,  80,  80,  81,  81,  81,  82,  82,  82,  83, /* 1950 ~ 2109 mV */
+     83,  83,  84,  84,  84,  85,  85,  85,  86,  86,  86,  87,  87,  87,  88,  88,  88,  89,  89,  89, /* 2110 ~ 2269 mV */
+     90,  90,  90,  91,  91,  92,  92,  92,  93,  93,  93,  94,  94,  95,  95,  95,  96,  96,  97,  97, /* 2270 ~ 2429 mV */
+     97,  98,  98,  99,  99,  99, 100, 100, 101, 101, 102, 102, 103, 103, 103, 104, 104, 105, 105, 106, /* 2430 ~ 2589 mV */
+    106, 107, 107, 108, 108, 109, 109, 110, 110, 111, 112, 112, 113, 113, 114, 114, 115, 116, 116, 117, /* 2590 ~ 2749 mV */
+    117, 118, 119  /* 2750 ~ 2769 mV */
+};
+
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
@@ -52,80 +95,115 @@ void ntc_adc_init(void)
 	adc_init();
 	adc_base_init(P_NTC);
 	adc_power_on_sar_adc(1);
+    sg_ntc_adc_ready = 1;
 }
 
 /**
- * @brief is voltage value between data[num1] and data[num2]
- * @param[in] value: voltage value
- * @param[in] num1: smaller voltage value's number
- * @param[in] num2: larger voltage value's number
+ * @brief ntc adc session reset, the next sample initializes the adc again
+ * @param[in] none
  * @return none
  */
-static uint8_t is_vol_value_between(uint16_t value, uint8_t num1, uint8_t num2)
+void ntc_adc_session_reset(void)
 {
-    if ((value >= vol_data_of_temp[num1]) && (value <= vol_data_of_temp[num2])) {
-        return 1;
-    } else {
-        return 0;
-    }
+    sg_ntc_adc_ready = 0;
 }
 
 /**
- * @brief get closer number
+ * @brief transform voltage value to temperature value
  * @param[in] value: voltage value
- * @param[in] num1: smaller voltage value's number
- * @param[in] num2: larger voltage value's number
- * @return none
+ * @return temp: temprature value (nearest one in vol_data_of_temp)
  */
-static uint8_t get_closer_num(uint16_t value, uint8_t num1, uint8_t num2)
+static uint8_t transform_vol_to_temp(uint16_t vol_value)
 {
-    if ((value - vol_data_of_temp[num1]) < (vol_data_of_temp[num2] - value)) {
-        return num1;
-    } else {
-        return num2;
+    uint8_t num;
+
+    if (vol_value <= VOL_ARRAY_MIN_VALUE) {
+        return TEMP_ARRAY_MIN_VALUE;
+    }
+    if (vol_value >= VOL_ARRAY_MAX_VALUE) {
+        return (TEMP_ARRAY_MIN_VALUE + TEMP_ARRAY_SIZE - 1);
+    }
+    num = temp_data_of_vol[(vol_value - VOL_ARRAY_MIN_VALUE) >> VOL_STEP_SHIFT];
+    /* closer to the next one (the middle point belongs to the next one) */
+    if ((num < (TEMP_ARRAY_SIZE - 1)) &&
+        ((vol_value << 1) >= (vol_data_of_temp[num] + vol_data_of_temp[num+1]))) {
+        num++;
     }
+    return (num + TEMP_ARRAY_MIN_VALUE);
 }
 
 /**
- * @brief transform voltage value to temperature value
+ * @brief transform voltage value to temperature value in 0.1 degree
  * @param[in] value: voltage value
- * @return temp: temprature value
+ * @return temp: temprature value (0.1 degree), interpolated in vol_data_of_temp
  */
-static uint8_t transform_vol_to_temp(uint16_t vol_value)
+static uint16_t transform_vol_to_temp_x10(uint16_t vol_value)
 {
-    uint8_t comp_num;
-    uint8_t min = 0;
-    uint8_t max = TEMP_ARRAY_SIZE - 1;
-    uint8_t temp = 0;
+    uint8_t num;
+    uint16_t vol_diff;
 
-    if (vol_value <= vol_data_of_temp[min]) {
-        return TEMP_ARRAY_MIN_VALUE;
+    if (vol_value <= VOL_ARRAY_MIN_VALUE) {
+        return (TEMP_ARRAY_MIN_VALUE * 10);
     }
-    if (vol_value >= vol_data_of_temp[max]) {
-        return (TEMP_ARRAY_MIN_VALUE + TEMP_ARRAY_SIZE - 1);
+    if (vol_value >= VOL_ARRAY_MAX_VALUE) {
+        return ((TEMP_ARRAY_MIN_VALUE + TEMP_ARRAY_SIZE - 1) * 10);
+    }
+    /* the step temperature is the nearest one at the step start, the lower one is at most one away */
+    num = temp_data_of_vol[(vol_value - VOL_ARRAY_MIN_VALUE) >> VOL_STEP_SHIFT];
+    if (vol_value < vol_data_of_temp[num]) {
+        num--;
+    } else if ((num < (TEMP_ARRAY_SIZE - 1)) && (vol_value >= vol_data_of_temp[num+1])) {
+        num++;
+    }
+    if (num >= (TEMP_ARRAY_SIZE - 1)) {
+        return ((TEMP_ARRAY_MIN_VALUE + TEMP_ARRAY_SIZE - 1) * 10);
     }
-    while (1) {
-        comp_num = (max + min) / 2;
-        if (vol_value == vol_data_of_temp[comp_num]) {
-            temp = comp_num + TEMP_ARRAY_MIN_VALUE;
-            break;
-        } else if (vol_value < vol_data_of_temp[comp_num]) {
-            if (is_vol_value_between(vol_value, comp_num-1, comp_num)) {
-                temp = get_closer_num(vol_value, comp_num-1, comp_num) + TEMP_ARRAY_MIN_VALUE;
-                break;
-            } else {
-                max = comp_num;
-            }
-        } else {
-            if (is_vol_value_between(vol_value, comp_num, comp_num+1)) {
-                temp = get_closer_num(vol_value, comp_num, comp_num+1) + TEMP_ARRAY_MIN_VALUE;
-                break;
-            } else {
-                min = comp_num;
-            }
+    /* linear interpolation between num and num+1, rounded */
+    vol_diff = vol_data_of_temp[num+1] - vol_data_of_temp[num];
+    return ((num + TEMP_ARRAY_MIN_VALUE) * 10 +
+            ((vol_value - vol_data_of_temp[num]) * 10 + (vol_diff >> 1)) / vol_diff);
+}
+
+/**
+ * @brief get ntc voltage
+ * @param[in] none
+ * @return ntc_vol_value: median of NTC_SAMPLE_NUM voltage values (mV)
+ */
+static uint16_t get_ntc_vol(void)
+{
+    uint16_t ntc_vol_value[NTC_SAMPLE_NUM];
+    uint16_t vol;
+    uint8_t i, j;
+    /* adc init (only when the session is lost) */
+    if (!sg_ntc_adc_ready) {
+        ntc_adc_init();
+    }
+    /* get adc result (voltage value -mV), insertion sorted */
+    for (i = 0; i < NTC_SAMPLE_NUM; i++) {
+        vol = (uint16_t)adc_sample_and_get_result();
+        for (j = i; (j > 0) && (ntc_vol_value[j-1] > vol); j--) {
+            ntc_vol_value[j] = ntc_vol_value[j-1];
         }
+        ntc_vol_value[j] = vol;
+    }
+    TUYA_APP_LOG_DEBUG("voltage: %d (%d ~ %d)", ntc_vol_value[NTC_SAMPLE_NUM/2], ntc_vol_value[0], ntc_vol_value[NTC_SAMPLE_NUM-1]);
+    return ntc_vol_value[NTC_SAMPLE_NUM/2];
+}
+
+/**
+ * @brief smooth temperature with IIR filter
+ * @param[in] temp: temperature value (0.1 degree)
+ * @return filtered temperature value (0.1 degree)
+ */
+static uint16_t filter_temp_x10(uint16_t temp)
+{
+    if (!sg_ntc_iir_ready) {
+        sg_ntc_iir_acc = (uint32_t)temp << NTC_IIR_SHIFT;
+        sg_ntc_iir_ready = 1;
+    } else {
+        sg_ntc_iir_acc = sg_ntc_iir_acc - (sg_ntc_iir_acc >> NTC_IIR_SHIFT) + temp;
     }
-    return temp;
+    return (uint16_t)(sg_ntc_iir_acc >> NTC_IIR_SHIFT);
 }
 
 /**
@@ -136,14 +214,22 @@ static uint8_t transform_vol_to_temp(uint16_t vol_value)
 uint8_t get_cur_temp(void)
 {
     uint8_t ntc_temp;
-    uint16_t ntc_vol_value;
-    /* adc init */
-    ntc_adc_init();
-    /* get adc result (voltage value -mV) */
-    ntc_vol_value = (uint16_t)adc_sample_and_get_result();
-    TUYA_APP_LOG_DEBUG("voltage: %d", ntc_vol_value);
     /* get temp value */
-    ntc_temp = transform_vol_to_temp(ntc_vol_value);
+    ntc_temp = transform_vol_to_temp(get_ntc_vol());
     TUYA_APP_LOG_DEBUG("temperature: %d", ntc_temp);
     return ntc_temp;
 }
+
+/**
+ * @brief get current temperature in 0.1 degree (median and IIR filtered)
+ * @param[in] none
+ * @return ntc_temp: temperature value (0.1 degree)
+ */
+uint16_t get_cur_temp_x10(void)
+{
+    uint16_t ntc_temp;
+    /* get temp value */
+    ntc_temp = filter_temp_x10(transform_vol_to_temp_x10(get_ntc_vol()));
+    TUYA_APP_LOG_DEBUG("temperature: %d.%d", ntc_temp / 10, ntc_temp % 10);
+    return ntc_temp;
+}
@@ -24,6 +24,7 @@
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
+static bool sg_relay_status = 0;
 
 /***********************************************************
 ***********************function define**********************
@@ -47,13 +48,22 @@ void relay_init(void)
  */
 void set_relay(bool b_on_off)
 {
-    static bool s_last_status = 0;
-    if (s_last_status != b_on_off) {
+    if (sg_relay_status != b_on_off) {
         if (b_on_off == ON) {
         	gpio_write(P_RELAY, 1);
         } else {
         	gpio_write(P_RELAY, 0);
         }
-        s_last_status = b_on_off;
+        sg_relay_status = b_on_off;
     }
 }
+
+/**
+ * @brief get relay status
+ * @param[in] none
+ * @return relay on / relay off
+ */
+bool get_relay(void)
+{
+    return sg_relay_status;
+}
@@ -1,10 +1,16 @@
 
 #include "tuya_ble_common.h"
 #include "tuya_ble_mem.h"
+#include "custom_app_uart_common_handler.h"
 
 #define DP_LEN_MAX       220
 #define UART_HEAD_NUM    6
 #define UART_FRAME_MAX  (220+4+7)
+#define UART_RX_TIMEOUT_MS  800
+#define UART_TX_DATA_MAX    (255+4)
+#define UART_TX_RING_SIZE   512     //power of 2, holds the largest frame
+#define UART_TX_CHUNK       16      //bytes sent per tuya_uart_tx_process()
+#define UART_RX_AWAKE_MS    5000    //no suspend after power-on and after the last rx byte
 
 
 //MYFIFO_INIT(uart_rx_fifo, UART_FRAME_MAX+2, 4);
@@ -12,63 +18,103 @@
 
 
 
+static u8 uart_tx_ring[UART_TX_RING_SIZE];
+static volatile u16 uart_tx_head=0;//write index, free running
+static volatile u16 uart_tx_tail=0;//read index, free running
+
+//bytes that fit in the tx ring
+u16 tuya_uart_tx_free(void)
+{
+	return UART_TX_RING_SIZE-(u16)(uart_tx_head-uart_tx_tail);
+}
+
+static void uart_tx_ring_put(u8 *buf,u16 len)
+{
+	u16 offset=uart_tx_head&(UART_TX_RING_SIZE-1);
+	u16 n=UART_TX_RING_SIZE-offset;
+
+	if(n>len) n=len;
+	memcpy(uart_tx_ring+offset,buf,n);
+	memcpy(uart_tx_ring,buf+n,len-n);
+	uart_tx_head+=len;
+}
+
+//the ring is full: send chunks here until len bytes fit, as the blocking senders did
+static void uart_tx_ring_wait(u16 len)
+{
+	while(tuya_uart_tx_free()<len)
+	{
+		tuya_uart_tx_process();
+	}
+}
+
+//queue a frame: head(2) version(1) cmd(1) len(2) data(len) sum(1), 0-ok
+static u32 uart_tx_frame_submit(u8 head,u8 type,u8 *pdata,u16 len)
+{
+	u8 frame_head[UART_HEAD_NUM];
+	u8 ck_sum;
+
+	uart_tx_ring_wait(UART_HEAD_NUM+len+1);
+	frame_head[0] = head;
+	frame_head[1] = 0xaa;
+	frame_head[2] = 0x0;
+	frame_head[3] = type;
+	frame_head[4] = len>>8;
+	frame_head[5] = len;
+	ck_sum = check_sum(frame_head,UART_HEAD_NUM)+check_sum(pdata,len);
+
+	uart_tx_ring_put(frame_head,UART_HEAD_NUM);
+	uart_tx_ring_put(pdata,len);
+	uart_tx_ring_put(&ck_sum,1);
+	return 0;
+}
+
+//send a chunk of the tx ring, call it from the main loop, return bytes still queued
+u16 tuya_uart_tx_process(void)
+{
+	u16 offset=uart_tx_tail&(UART_TX_RING_SIZE-1);
+	u16 n=(u16)(uart_tx_head-uart_tx_tail);
+
+	if(n==0) return 0;
+	if(n>UART_TX_RING_SIZE-offset) n=UART_TX_RING_SIZE-offset;
+	if(n>UART_TX_CHUNK) n=UART_TX_CHUNK;
+	tuya_bsp_uart_send_bytes(uart_tx_ring+offset,n);
+	uart_tx_tail+=n;
+	return (u16)(uart_tx_head-uart_tx_tail);
+}
+
+//send all of the tx ring before a reset or a long blocking call,
+//the bsp has no tx done irq or dma to drain it in the background
+void tuya_uart_tx_flush(void)
+{
+	while(tuya_uart_tx_process()!=0);
+}
+
 void tuya_uart_common_send_bytes(u8* buf,u16 len)
 {
-	tuya_bsp_uart_send_bytes (buf, len);
+	if(len>UART_TX_RING_SIZE)
+	{
+		tuya_log_d("uart tx too long-%d",len);
+		return;
+	}
+	uart_tx_ring_wait(len);
+	uart_tx_ring_put(buf,len);
 }
 
 u32 ty_uart_protocol_send(u8 type,u8 *pdata,u16 len)
 {
-    u8 alloc_buf[255+4+7];
-
-    if(len+7>sizeof(alloc_buf)) return 1;
-    //
-    alloc_buf[0+1] = 0x55;
-    alloc_buf[1+1] = 0xaa;
-    alloc_buf[2+1] = 0x0;
-    alloc_buf[3+1] = type;
-    alloc_buf[4+1] = len>>8;
-    alloc_buf[5+1] = len;
-
-    memcpy(alloc_buf+6+1,pdata,len);
-    alloc_buf[7+len] = check_sum(alloc_buf+1,6+len);
-    tuya_uart_common_send_bytes(alloc_buf+1,7+len);
-    return 0;
+    if(len>UART_TX_DATA_MAX) return 1;
+    return uart_tx_frame_submit(0x55,type,pdata,len);
 }
 u32 ty_uart_debug_send(u8 type,u8 *pdata,u16 len)
 {
-    u8 alloc_buf[255+4+7];
-
-    if(len+7>sizeof(alloc_buf)) return 1;
-    //
-    alloc_buf[0+1] = 0x77;
-    alloc_buf[1+1] = 0xaa;
-    alloc_buf[2+1] = 0x0;
-    alloc_buf[3+1] = type;
-    alloc_buf[4+1] = len>>8;
-    alloc_buf[5+1] = len;
-
-    memcpy(alloc_buf+6+1,pdata,len);
-    alloc_buf[7+len] = check_sum(alloc_buf+1,6+len);
-    tuya_uart_common_send_bytes(alloc_buf+1,7+len);
-    return 0;
+    if(len>UART_TX_DATA_MAX) return 1;
+    return uart_tx_frame_submit(0x77,type,pdata,len);
 }
 
 u32 ty_uart_protocol_factory_send(u8 type,u8 *pdata,u8 len)
 {
-    u8 alloc_buf[256];
-    //
-    alloc_buf[0+1] = 0x66;
-    alloc_buf[1+1] = 0xaa;
-    alloc_buf[2+1] = 0x0;
-    alloc_buf[3+1] = type;
-    alloc_buf[4+1] = 0;
-    alloc_buf[5+1] = len;
-
-    memcpy(alloc_buf+6+1,pdata,len);
-    alloc_buf[7+len] = check_sum(alloc_buf+1,6+len);
-    tuya_uart_common_send_bytes(alloc_buf+1,7+len);
-    return 0;
+    return uart_tx_frame_submit(0x66,type,pdata,len);
 }
 
 s32 mcu_heartbeat_callback()
@@ -143,130 +189,6 @@ u32 uart_dpData_to_ble_dpData(u8* in_buffer,u16 in_len,u8* out_buffer,u16 out_bu
 	   return 0;
 }
 
-u16 uart_rx_len=0;
-static u8  uart_rx_buffer[UART_FRAME_MAX];
-static u8 status =0;
-
-s32 uart_timeout_handler(void)
-{
-	tuya_log_d("uart rx len-%d",uart_rx_len);
-	uart_rx_len=0;
-	tuya_log_dumpHex("uart rx",50,uart_rx_buffer,uart_rx_len>50?50:uart_rx_len);
-    status=0;
-    tuya_log_d("uart_timeout_handler");
-    return -1;
-}
-
-u8 uart_data_unpack(u8 data)
-{
-	static u16 datalen =0;
-	u8 err_code=1;
-	u8 ck_sum;
-
-    switch (status)
-    {
-    case 0:
-        if(data==0x55||data==0x66||data==0x77)
-        {
-            uart_rx_buffer[status]=data;
-            uart_rx_len=1;
-            tuya_timer_start(TIMER_UART_RX_TIMEOUT,800);
-            status=1;
-        }
-        break;
-    case 1:
-        if(data==0xAA)
-        {
-        	uart_rx_len++;
-            uart_rx_buffer[status]=data;
-            status=2;
-        }
-        else if(data==0x55||data==0x66||data==0x77)
-        {
-        	uart_rx_buffer[0]=data;
-        	uart_rx_len=1;
-        	status=1;
-        }
-        else
-        {
-			status=0;
-        }
-        break;
-    case 2:
-    	uart_rx_len++;
-        uart_rx_buffer[status]=data;
-        status=3;
-        break;
-    case 3:
-    	uart_rx_len++;
-        uart_rx_buffer[status]=data;
-        uart_rx_len=4;
-        status=4;
-        break;
-    case 4:
-    	uart_rx_len++;
-    	//data_len=data<<8;
-        uart_rx_buffer[status]=data;
-        status=5;
-        break;
-    case 5:
-    	//data_len=data_len+data;
-        uart_rx_buffer[status]=data;
-        uart_rx_len=6;
-        datalen=(uart_rx_buffer[4]<<8)+uart_rx_buffer[5];
-        if(datalen==0)
-            status=7;
-        else if(datalen<=(UART_FRAME_MAX-7))
-        {
-        	//tuya_log_d("uart rx data len-%d",datalen);
-            status=6;
-        }
-        else//长度超限制
-        {
-        	tuya_log_d("uart rx dp_len too large-%d-%d",datalen);
-        	status=0;
-        }
-        break;
-    case 6:
-        if(uart_rx_len<=(UART_FRAME_MAX-2))
-        {
-            uart_rx_buffer[uart_rx_len++]=data;
-        }
-        else
-        {
-            uart_rx_len++;
-        }
-        if(uart_rx_len>=datalen+6)
-            status=7;
-        else
-            status=6;
-        break;
-    case 7:
-        tuya_timer_delete(TIMER_UART_RX_TIMEOUT);
-        if(uart_rx_len<=(UART_FRAME_MAX-1))
-        {
-        	ck_sum = check_sum(uart_rx_buffer,uart_rx_len);
-        	//tuya_log_d("uart rx crc-%d-%d-%d",ck_sum,data,uart_rx_len);
-            uart_rx_buffer[uart_rx_len++]=data;
-            if(ck_sum == data)
-            {
-            	err_code=0;
-            }
-            else
-            {
-            	err_code=2;
-            }
-        }
-        //tuya_log_d("uart rx unpack-%d-%x-%x-%x-%x-%d",err_code,uart_rx_buffer[0],uart_rx_buffer[1],data,ck_sum,uart_rx_len);
-        status=0;
-        break;
-    default:
-        status=0;
-        break;
-    }
-    //tuya_log_d("uart_rx frame-%d-0x%x",status,data);
-    return err_code;
-}
 void tuya_uart_send_ble_dpdata(u8* ble_dp_data,u16 dp_len)
 {
 	u8 uart_data[220+4];//���е���dp�220
@@ -335,6 +257,9 @@ void tuya_uart_common_handler(u8 *pData,u16 len)
 			}
 			ty_uart_protocol_send(TY_SEND_STATUS_TYPE,&return_code,1);
 			break;
+		case TUYA_BLE_UART_COMMON_RESET_TYPE:
+			tuya_uart_tx_flush();//queued frames go out before the module resets
+			break;
 	}
 }
 
@@ -342,32 +267,215 @@ void tuya_uart_debug_handler(u8 *pData,u16 len)
 {
 }
 
-void tuya_uart_rx_handler(u8 *uart_Data,u16 len)
+u16 uart_rx_len=0;
+static u8  uart_rx_buffer[UART_FRAME_MAX] __attribute__((aligned(4)));
+static u16 uart_rx_data_len=0;
+static u32 uart_rx_start_tick=0;
+static u8  uart_rx_done=0;//frame left in uart_rx_buffer by uart_data_unpack()
+static u32 uart_rx_awake_tick=0;
+static u8  uart_rx_awake=0;
+static u8  uart_link_active=0;//the mcu or the factory tester sent a frame, it may send again at any time
+
+s32 uart_timeout_handler(void)
 {
-	u32 index=0;
-	//tuya_log_d("tuya_uart_rx_handler-%d",len);
+	tuya_log_d("uart rx len-%d",uart_rx_len);
+	tuya_log_dumpHex("uart rx",50,uart_rx_buffer,uart_rx_len>50?50:uart_rx_len);
+	uart_rx_len=0;
+    tuya_log_d("uart_timeout_handler");
+    return -1;
+}
 
-	if(tuya_get_ota_status() != TUYA_OTA_STATUS_NONE) return;//升级状态不处理串口数据
+//8-bit sum of a 4-byte aligned buffer, two bytes per 16-bit lane of a word
+static u8 uart_check_sum(u8 *buf,u16 len)
+{
+	u32 *word=(u32 *)buf;
+	u32 acc=0;
+	u8 sum=0;
 
+	//lanes stay below 0xFFFF for frames up to 512 bytes
+	while(len>=4)
+	{
+		acc+=(*word&0x00FF00FF)+((*word>>8)&0x00FF00FF);
+		word++;
+		len-=4;
+	}
+	buf=(u8 *)word;
+	while(len>0)
+	{
+		sum+=*buf++;
+		len--;
+	}
+	return (u8)(sum+acc+(acc>>16));
+}
+
+static u8 uart_is_frame_head(u8 data)
+{
+	return (data==0x55)||(data==0x66)||(data==0x77);
+}
+
+//find the first frame head (0x55/0x66/0x77 then 0xAA), return its offset or len
+static u16 uart_find_frame_head(u8 *data,u16 len)
+{
+	u8 *p=data;
+	u8 *end=data+len;
+
+	while(p<end)
+	{
+		p=memchr(p,0xAA,end-p);
+		if(p==NULL) break;
+		if((p>data)&&uart_is_frame_head(p[-1]))
+		{
+			return (p-1)-data;
+		}
+		p++;
+	}
+	return len;
+}
+
+//rx bytes are lost in suspend, there is no rx wake source: start the awake window
+void tuya_uart_rx_awake(void)
+{
+	uart_rx_awake_tick=clock_time();
+	uart_rx_awake=1;
+}
+
+//1-hold off suspend: the mcu link or the factory test is active, or inside the awake window
+u8 tuya_uart_rx_busy(void)
+{
+	if(uart_link_active) return 1;
+	if(uart_rx_awake&&clock_time_exceed(uart_rx_awake_tick,UART_RX_AWAKE_MS*1000))
+	{
+		uart_rx_awake=0;
+	}
+	return uart_rx_awake;
+}
+
+static void uart_frame_dispatch(void)
+{
+	if(uart_rx_buffer[0]==0x55)
+	{//正常指令集
+		uart_link_active=1;
+		tuya_uart_common_handler(uart_rx_buffer,uart_rx_len);
+	}
+	else if((ty_factory_flag==1)&&(uart_rx_buffer[0]==0x66))
+	{//生产指令集
+		uart_link_active=1;
+		//tuya_log_v("ty_factory_flag:%d",ty_factory_flag);
+		tuya_uart_factory_test(uart_rx_buffer,uart_rx_len);
+	}
+	else if(uart_rx_buffer[0]==0x77)
+	{//调试指令集
+		tuya_uart_debug_handler(uart_rx_buffer,uart_rx_len);
+	}
+}
+
+//frame: head(2) version(1) cmd(1) len(2) data(len) sum(1), frames may be split over chunks
+//dispatch=0: stop at the end of a frame and leave it in uart_rx_buffer/uart_rx_len
+//return: 0-frame ok, 2-check sum error, 1-no frame ended
+static u8 uart_frame_unpack(u8 *data,u16 len,u8 dispatch)
+{
+	u16 index=0;
+	u16 head;
+	u16 n;
+	u8 err_code=1;
+
+	if(uart_rx_done)
+	{
+		uart_rx_done=0;
+		uart_rx_len=0;
+	}
+	if((uart_rx_len!=0)&&clock_time_exceed(uart_rx_start_tick,UART_RX_TIMEOUT_MS*1000))
+	{
+		uart_timeout_handler();
+	}
 	while(index<len)
 	{
-		if(uart_data_unpack(uart_Data[index++])==0)
+		if(uart_rx_len<2)
 		{
-			if(uart_rx_buffer[0]==0x55)
-			{//正常指令集
-				tuya_uart_common_handler(uart_rx_buffer,uart_rx_len);
+			if((uart_rx_len==1)&&(data[index]==0xAA))
+			{//head split over two chunks
+				uart_rx_buffer[uart_rx_len++]=data[index++];
+				continue;
 			}
-			else if((ty_factory_flag==1)&&(uart_rx_buffer[0]==0x66))
-			{//生产指令集
-				//tuya_log_v("ty_factory_flag:%d",ty_factory_flag);
-				tuya_uart_factory_test(uart_rx_buffer,uart_rx_len);
+			uart_rx_len=0;
+			head=index+uart_find_frame_head(data+index,len-index);
+			if(head>=len)
+			{//keep a head byte at the end for the next chunk
+				if(uart_is_frame_head(data[len-1]))
+				{
+					uart_rx_buffer[0]=data[len-1];
+					uart_rx_len=1;
+					uart_rx_start_tick=clock_time();
+				}
+				break;
 			}
-			else if(uart_rx_buffer[0]==0x77)
-			{//调试指令集
-				tuya_uart_debug_handler(uart_rx_buffer,uart_rx_len);
+			uart_rx_buffer[0]=data[head];
+			uart_rx_buffer[1]=0xAA;
+			uart_rx_len=2;
+			uart_rx_start_tick=clock_time();
+			index=head+2;
+		}
+		else if(uart_rx_len<UART_HEAD_NUM)
+		{
+			n=UART_HEAD_NUM-uart_rx_len;
+			if(n>len-index) n=len-index;
+			memcpy(uart_rx_buffer+uart_rx_len,data+index,n);
+			uart_rx_len+=n;
+			index+=n;
+			if(uart_rx_len==UART_HEAD_NUM)
+			{
+				uart_rx_data_len=(uart_rx_buffer[4]<<8)+uart_rx_buffer[5];
+				if(uart_rx_data_len>(UART_FRAME_MAX-7))
+				{//长度超限制
+					tuya_log_d("uart rx dp_len too large-%d",uart_rx_data_len);
+					uart_rx_len=0;
+				}
+			}
+		}
+		else
+		{//data and sum in bulk
+			n=UART_HEAD_NUM+uart_rx_data_len+1-uart_rx_len;
+			if(n>len-index) n=len-index;
+			memcpy(uart_rx_buffer+uart_rx_len,data+index,n);
+			uart_rx_len+=n;
+			index+=n;
+			if(uart_rx_len==UART_HEAD_NUM+uart_rx_data_len+1)
+			{
+				if(uart_check_sum(uart_rx_buffer,uart_rx_len-1)==uart_rx_buffer[uart_rx_len-1])
+				{
+					err_code=0;
+					if(dispatch) uart_frame_dispatch();
+				}
+				else
+				{
+					err_code=2;
+				}
+				if(!dispatch)
+				{
+					uart_rx_done=1;
+					break;
+				}
+				uart_rx_len=0;
 			}
 		}
 	}
+	return err_code;
+}
+
+//byte parser kept for old callers, on 0 the frame is in uart_rx_buffer/uart_rx_len
+u8 uart_data_unpack(u8 data)
+{
+	return uart_frame_unpack(&data,1,0);
+}
+
+void tuya_uart_rx_handler(u8 *uart_Data,u16 len)
+{
+	//tuya_log_d("tuya_uart_rx_handler-%d",len);
+	tuya_uart_rx_awake();
+
+	if(tuya_get_ota_status() != TUYA_OTA_STATUS_NONE) return;//升级状态不处理串口数据
+
+	uart_frame_unpack(uart_Data,len,1);
 }
 
 void tuya_ble_custom_app_uart_common_process(uint8_t *p_in_data,uint16_t in_len)
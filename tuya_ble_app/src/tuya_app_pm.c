@@ -0,0 +1,116 @@
+/**
+ * @file tuya_app_pm.c
+ * @author lifan
+ * @brief app tickless idle source file
+ * @version 1.0
+ * @date 2021-07-06
+ *
+ * @copyright Copyright (c) tuya.inc 2021
+ *
+ */
+
+#include "tuya_app_pm.h"
+#include "tuya_app_driver_ntc.h"
+#include "tuya_app_driver_key.h"
+#include "custom_app_uart_common_handler.h"
+#include "tuya_ble_common.h"
+#include "timer.h"
+#include "pm.h"
+
+/***********************************************************
+************************micro define************************
+***********************************************************/
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+#if APP_PM_ENABLE
+/**
+ * @brief suspend exit handler, called by the stack
+ * @param[in] e: event
+ * @param[in] p: event data
+ * @param[in] n: event data length
+ * @return none
+ */
+static void app_suspend_exit_handler(u8 e, u8 *p, int n)
+{
+    ntc_adc_session_reset();    /* the ADC is powered down in suspend, the next sample sets it up */
+}
+
+/**
+ * @brief gpio early wake-up handler, called by the stack: a key pad woke us up before the
+ *        deadline, or kept us from suspending
+ * @param[in] e: event
+ * @param[in] p: event data
+ * @param[in] n: event data length
+ * @return none
+ */
+static void app_gpio_wakeup_handler(u8 e, u8 *p, int n)
+{
+    ts02n_key_wake_up();
+}
+#endif
+
+/**
+ * @brief app power management init
+ * @param[in] none
+ * @return none
+ */
+void app_pm_init(void)
+{
+#if APP_PM_ENABLE
+    blc_ll_initPowerManagement_module();
+    bls_app_registerEventCallback(BLT_EV_FLAG_SUSPEND_EXIT, &app_suspend_exit_handler);
+    bls_app_registerEventCallback(BLT_EV_FLAG_GPIO_EARLY_WAKEUP, &app_gpio_wakeup_handler);
+    /* the key driver arms the key pins, a press wakes up the chip */
+    bls_pm_setWakeupSource(PM_WAKEUP_PAD);
+    bls_pm_setSuspendMask(SUSPEND_DISABLE);
+    /* the factory tester and the MCU talk first after power-on */
+    tuya_uart_rx_awake();
+#endif
+}
+
+/**
+ * @brief suspend until the next deadline, a key press or the next radio event,
+ *        not while the UART link is active: there is no UART rx wake source
+ * @param[in] sleep_ms: ms until the next deadline, 0-stay awake
+ * @return none
+ */
+void app_pm_idle(uint32_t sleep_ms)
+{
+#if APP_PM_ENABLE
+    uint32_t wakeup_tick;
+
+    if ((sleep_ms < APP_PM_SLEEP_MIN) || tuya_uart_rx_busy()) {
+        bls_pm_setSuspendMask(SUSPEND_DISABLE);
+        ts02n_key_wake_up();    /* awake, no pad wake-up: the next pass reads the keys */
+        return;
+    }
+    if (sleep_ms > APP_PM_SLEEP_MAX) {
+        sleep_ms = APP_PM_SLEEP_MAX;
+    }
+    wakeup_tick = clock_time() + sleep_ms * CLOCK_16M_SYS_TIMER_CLK_1MS;
+    if (blc_ll_getCurrentState() == BLS_LINK_STATE_IDLE) {
+        /* no advertising or connection: the stack does not suspend, sleep here */
+        if (cpu_sleep_wakeup(SUSPEND_MODE, PM_WAKEUP_PAD | PM_WAKEUP_TIMER, wakeup_tick) &
+            (WAKEUP_STATUS_PAD | STATUS_GPIO_ERR_NO_ENTER_PM)) {
+            ts02n_key_wake_up();
+        }
+        ntc_adc_session_reset();
+    } else {
+        /* the stack suspends between radio events and wakes us up for the deadline */
+        bls_pm_setSuspendMask(SUSPEND_ADV | SUSPEND_CONN);
+        bls_pm_setAppWakeupLowPower(wakeup_tick, 1);
+    }
+#else
+    ts02n_key_wake_up();        /* never suspended: every pass reads the keys */
+#endif
+}
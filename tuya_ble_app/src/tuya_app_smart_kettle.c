@@ -10,12 +10,14 @@
  */
 
 #include "tuya_app_smart_kettle.h"
+#include "tuya_app_timer.h"
 #include "tuya_app_driver_led.h"
 #include "tuya_app_driver_key.h"
 #include "tuya_app_driver_ntc.h"
 #include "tuya_app_driver_relay.h"
 #include "tuya_app_driver_buzzer.h"
 #include "tuya_ble_common.h"
+#include "tuya_ble_port.h"
 #include "tuya_ble_log.h"
 
 /***********************************************************
@@ -35,15 +37,78 @@
 #define DP_TYPE_TEMP_SET        DT_VALUE
 #define DP_TYPE_WATER_TYPE      DT_ENUM
 #define DP_TYPE_FAULT           DT_ENUM
+/* DP scale of TEMP_CUR: 0-1 degree, 1-0.1 degree (must match the product DP definition) */
+#define DP_TEMP_CUR_SCALE       0
+/* DP number */
+#define DP_NUM                  6
+#define DP_ID_BASE              DP_ID_BOIL
+#define DP_IDX(id)              ((id) - DP_ID_BASE)
+#define DP_ALL_MASK             ((1 << DP_NUM) - 1)
+/* DP frame: id(1) + type(1) + len(1) + value(len, big endian) */
+#define DP_HEAD_LEN             3
+#define DP_VALUE_LEN_MAX        4
+#define DP_TYPE_LEN(type)       (((type) == DT_VALUE) ? 4 : 1)
+#define DP_REPORT_BUF_SIZE      (DP_NUM * (DP_HEAD_LEN + DP_VALUE_LEN_MAX))
+/* DP descriptor: id, type and len come from one name so they can not disagree */
+#define DP_DESC(dp, min, max, get, set) \
+    [DP_IDX(DP_ID_##dp)] = {DP_ID_##dp, DP_TYPE_##dp, DP_TYPE_LEN(DP_TYPE_##dp), min, max, get, set}
+/* Compile time check */
+#define DP_STATIC_ASSERT(cond, name)    typedef char dp_static_assert_##name[(cond) ? 1 : -1]
 
 /* Temperature */
-#define TEMP_BOILED             97
+#define TEMP_BOILED             100             /* default boil point, learned by plateau */
 #define TEMP_KEEP_WARM_DEFAULT  55
 #define TEMP_UPPER_LIMIT        105
 #define TEMP_KEEP_RANGE         3
+#define TEMP_SET_MIN            45
+#define TEMP_SET_MAX            90
+#define TEMP_X10(temp)          ((temp) * 10)   /* degree to 0.1 degree */
+#define TEMP_NEAR_RANGE         TEMP_X10(3)     /* sample fast this close to a threshold */
+#define TEMP_STABLE_RANGE       2               /* 0.2 degree */
+#define TEMP_FALL_RANGE         2               /* 0.2 degree below the peak is falling */
+#define TEMP_HIST_SIZE          8               /* samples kept for the heating rate */
+/* Dry boil: a water load cannot rise this fast, an empty kettle does */
+#define TEMP_DRY_RISE_RATE      TEMP_X10(2)     /* 2 degree per second */
+#define TEMP_DRY_RECOVER        TEMP_X10(5)     /* cool this far below the fault peak */
+/* Boil point: flat within the band for TIME_BOIL_PLATEAU with the relay on */
+#define TEMP_BOIL_POINT_MIN     TEMP_X10(80)    /* lowest plateau taken as boiling */
+#define TEMP_BOIL_POINT_MAX     TEMP_X10(102)   /* with sensor offset */
+#define TEMP_PLATEAU_BAND       5               /* 0.5 degree */
+#define TEMP_BOIL_POINT_MARGIN  5               /* cut 0.5 degree below a found plateau */
+#define TEMP_BOIL_POINT_DRIFT   1               /* raise 0.1 degree each boil without plateau */
+#define TEMP_BOIL_POINT_SAVE    5               /* save a drift of 0.5 degree, not every boil */
 /* Time */
 #define TIME_GET_TEMP           2000        /* 2s */
+#define TIME_GET_TEMP_FAST      200         /* 0.2s, near a threshold */
+#define TIME_GET_TEMP_IDLE      10000       /* 10s, idle and stable */
 #define TIME_ALLOW_CONNECT      (3*60*1000) /* 3min */
+#define TIME_DP_REPORT_TIMEOUT  5000        /* 5s */
+
+/* Keep warm2 control */
+#define KEEP_WARM2_CTRL_BANG_BANG   0       /* relay on below the dead band, off in or above it */
+#define KEEP_WARM2_CTRL_PI          1       /* time-proportioned PI */
+#ifndef KEEP_WARM2_CTRL
+#define KEEP_WARM2_CTRL             KEEP_WARM2_CTRL_PI
+#endif
+/* PI controller: error in 0.1 degree, duty in 0.1% */
+#define PI_DUTY_MAX             1000
+#define PI_KP                   4           /* 25 degrees below temp_set is full duty */
+#define PI_KI                   1           /* added per window and 0.1 degree of error */
+#define PI_ERR_BAND             TEMP_X10(TEMP_KEEP_RANGE)   /* integrate within 3 degree of temp_set */
+#define TIME_PI_WINDOW          60000       /* 60s time-proportioning window */
+#define TIME_PI_PULSE_MIN       1000        /* 1s, shorter relay pulses are dropped */
+
+/* Predictive boil cutoff: cut when temp_cur + rate * lag reaches the boil point */
+#define TIME_BOIL_LAG_DEFAULT   4000        /* 4s, heater lag and sample delay */
+#define TIME_BOIL_LAG_MAX       15000       /* 15s */
+#define TIME_BOIL_OBSERVE       60000       /* 60s, longest overshoot watch after a cut */
+#define TIME_RATE_SPAN_MIN      1000        /* 1s, shortest span for a heating rate */
+#define BOIL_LAG_LEARN_SHIFT    2           /* learn 1/4 of the error each boil */
+#define TIME_BOIL_PLATEAU       20000       /* 20s */
+
+/* NV */
+#define KETTLE_NV_ADDR          APP_NV_START_ADDR
+#define KETTLE_NV_MAGIC         0x4B544C31  /* "KTL1" */
 
 /***********************************************************
 ***********************typedef define***********************
@@ -54,6 +119,17 @@ typedef BYTE_T MODE_E;
 #define MODE_BOIL               0x01
 #define MODE_KEEP_WARM1         0x02
 #define MODE_KEEP_WARM2         0x03
+#define MODE_FAULT              0x04
+#define MODE_NUM                5
+#define MODE_NONE               0xFF    /* transition: stay */
+#define MODE_BY_SETTING         0xFE    /* transition: by boil / keep warm turn and water type */
+/* Kettle event, also the dispatch order */
+typedef BYTE_T KETTLE_EVT_E;
+#define EVT_FAULT_SET           0x00
+#define EVT_FAULT_CLEAR         0x01
+#define EVT_SETTING             0x02    /* boil / keep warm turn or water type changed */
+#define EVT_TEMP_SAMPLE         0x03    /* new temperature sample */
+#define EVT_NUM                 4
 /* Water type */
 typedef BYTE_T WATER_TYPE_E;
 #define WATER_TYPE_TAP          0x00
@@ -63,19 +139,86 @@ typedef BYTE_T FAULT_E;
 #define FAULT_NORMAL            0x00
 #define FAULT_LACK_WATER        0x01
 
-/* DP data struct */
+/* DP descriptor struct */
 typedef struct {
     uint8_t id;
     dp_type type;
-    uint8_t len;
-    uint8_t value;
-} DP_DATA_T;
+    uint8_t len;                /* value length */
+    uint32_t min;               /* valid range of written value */
+    uint32_t max;
+    uint32_t (*get)(void);
+    void (*set)(uint32_t value);    /* NULL: report only */
+} DP_DESC_T;
+
+/* DP report struct */
+typedef struct {
+    uint32_t shadow[DP_NUM];    /* last value acknowledged by the app */
+    uint32_t sent[DP_NUM];      /* value waiting for the report response */
+    uint8_t shadow_valid;       /* bitmap: shadow holds an acknowledged value */
+    uint8_t dirty;              /* bitmap: changed since the last report */
+    uint8_t force;              /* bitmap: report even if equal to the shadow */
+    uint8_t inflight;           /* bitmap: waiting for the report response */
+    uint16_t sn;                /* sn of the report in flight */
+    uint32_t sent_tm;           /* time of the report in flight */
+    uint32_t report_cnt;        /* number of reports sent */
+} DP_REPORT_T;
+
+/* PI controller struct */
+typedef struct {
+    int32_t integral;           /* integral term (0.1%) */
+    uint16_t duty;              /* relay duty of this window (0.1%) */
+    uint32_t window_tm;         /* start of this window */
+} PI_CTRL_T;
+
+/* Kettle state struct */
+typedef struct {
+    void (*enter)(void);
+    void (*exit)(void);
+    void (*sample)(void);       /* new temperature sample */
+} KETTLE_STATE_T;
+
+/* Temperature history struct */
+typedef struct {
+    uint16_t temp[TEMP_HIST_SIZE];  /* 0.1 degree */
+    uint32_t tm[TEMP_HIST_SIZE];    /* sample time */
+    uint8_t head;                   /* next slot */
+    uint8_t num;
+} TEMP_HIST_T;
+
+/* Boil cutoff struct */
+typedef struct {
+    uint32_t lag;               /* learned lag between relay cut and temperature peak (ms) */
+    uint8_t observe;            /* watching the overshoot after a predicted cut */
+    uint16_t cut_temp;          /* temperature at the cut (0.1 degree) */
+    uint16_t peak_temp;         /* highest temperature after the cut (0.1 degree) */
+    int32_t cut_rise;           /* heating rate at the cut: cut_rise / cut_span */
+    uint32_t cut_span;          /* ms */
+    uint32_t cut_tm;
+} BOIL_CUT_T;
+
+/* Boil point struct */
+typedef struct {
+    uint16_t point;             /* learned boil point (0.1 degree) */
+    uint16_t saved;             /* boil point in flash (0.1 degree) */
+    uint16_t ref_temp;          /* plateau reference temperature (0.1 degree) */
+    uint32_t ref_tm;
+    uint8_t tracking;
+    uint8_t found;
+} BOIL_POINT_T;
+
+/* NV data struct, a multiple of TUYA_NV_WRITE_GRAN */
+typedef struct {
+    uint32_t magic;
+    uint16_t boil_point;        /* 0.1 degree */
+    uint16_t reserved;
+    uint32_t boil_lag;          /* ms */
+} KETTLE_NV_T;
 
 /* Kettle struct */
 typedef struct {
     MODE_E mode;
     uint8_t boil_turn;
-    uint8_t temp_cur;
+    uint16_t temp_cur;          /* 0.1 degree */
     uint8_t temp_set;
     uint8_t keep_warm_turn;
     WATER_TYPE_E water_type;
@@ -91,78 +234,266 @@ void key_keep_short_press_cb_fun();
 void key_keep_long_press_cb_fun();
 
 /* User key define */
-TS02N_KEY_DEF_T user_ts02n_key_def_s = {
-    .key1_pin = P_KEY_BOIL,         /* P7 */
-    .key2_pin = P_KEY_KEEP,         /* P8 */
-    .key1_short_press_cb = key_boil_short_press_cb_fun,
-    .key2_short_press_cb = key_keep_short_press_cb_fun,
-    .key1_long_press_cb = NULL,
-    .key2_long_press_cb = key_keep_long_press_cb_fun,
-    .key1_long_press_time = 0,      /* none */
-    .key2_long_press_time = 5000,   /* 5s */
+static const KEY_DEF_T sg_key_def[] = {
+    {                               /* boil, P7 */
+        .pin = P_KEY_BOIL,
+        .short_press_cb = key_boil_short_press_cb_fun,
+        .long_press_cb = NULL,
+        .double_click_cb = NULL,
+        .long_press_time = 0,       /* none */
+    },
+    {                               /* keep warm, P8 */
+        .pin = P_KEY_KEEP,
+        .short_press_cb = key_keep_short_press_cb_fun,
+        .long_press_cb = key_keep_long_press_cb_fun,
+        .double_click_cb = NULL,
+        .long_press_time = 5000,    /* 5s */
+    },
+};
+const TS02N_KEY_DEF_T user_ts02n_key_def_s = {
+    .key = sg_key_def,
+    .key_num = sizeof(sg_key_def) / sizeof(sg_key_def[0]),
+    .combo = NULL,
+    .combo_num = 0,
     .scan_time = 10,                /* 10ms */
 };
 
+/* DP accessor function */
+static uint32_t dp_get_boil(void);
+static uint32_t dp_get_keep_warm(void);
+static uint32_t dp_get_temp_cur(void);
+static uint32_t dp_get_temp_set(void);
+static uint32_t dp_get_water_type(void);
+static uint32_t dp_get_fault(void);
+static void dp_set_boil(uint32_t value);
+static void dp_set_keep_warm(uint32_t value);
+static void dp_set_temp_set(uint32_t value);
+static void dp_set_water_type(uint32_t value);
+
+/* DP schema, indexed by DP_IDX(id) */
+static const DP_DESC_T sg_dp_desc[DP_NUM] = {
+    DP_DESC(BOIL,       OFF,                ON,                 dp_get_boil,        dp_set_boil),
+    DP_DESC(KEEP_WARM,  OFF,                ON,                 dp_get_keep_warm,   dp_set_keep_warm),
+    DP_DESC(TEMP_CUR,   0,                  0,                  dp_get_temp_cur,    NULL),
+    DP_DESC(TEMP_SET,   TEMP_SET_MIN,       TEMP_SET_MAX,       dp_get_temp_set,    dp_set_temp_set),
+    DP_DESC(WATER_TYPE, WATER_TYPE_TAP,     WATER_TYPE_PURE,    dp_get_water_type,  dp_set_water_type),
+    DP_DESC(FAULT,      0,                  0,                  dp_get_fault,       NULL),
+};
+DP_STATIC_ASSERT((DP_ID_FAULT - DP_ID_BASE + 1) == DP_NUM, dp_id_continuous);
+DP_STATIC_ASSERT((sizeof(sg_dp_desc) / sizeof(sg_dp_desc[0])) == DP_NUM, dp_desc_num);
+DP_STATIC_ASSERT(DP_TYPE_LEN(DT_VALUE) <= DP_VALUE_LEN_MAX, dp_value_len);
+DP_STATIC_ASSERT(DP_NUM <= 8, dp_bitmap_width);
+
 KETTLE_T g_kettle;
 
+/* DP report: every DP changed in one loop pass is sent in one frame at the end of the pass */
+static DP_REPORT_T sg_dp_report;
+
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+/* Keep warm2 PI controller */
+static void pi_window_timeout_handler(void);
+static PI_CTRL_T sg_pi_ctrl;
+static APP_TIMER_T sg_pi_timer;
+#endif
+
+/* Kettle state action function */
+static void kettle_mode_nature(void);
+static void kettle_mode_boil(void);
+static void kettle_mode_keep_warm1(void);
+static void kettle_mode_keep_warm2(void);
+static void enter_keep_warm2(void);
+static void exit_keep_warm2(void);
+static void enter_fault(void);
+static void exit_fault(void);
+
+/* Kettle states, indexed by mode */
+static const KETTLE_STATE_T sg_kettle_state[MODE_NUM] = {
+    [MODE_NATURE]       = {kettle_mode_nature,      NULL,               NULL},
+    [MODE_BOIL]         = {kettle_mode_boil,        NULL,               kettle_mode_boil},
+    [MODE_KEEP_WARM1]   = {kettle_mode_keep_warm1,  NULL,               kettle_mode_keep_warm1},
+    [MODE_KEEP_WARM2]   = {enter_keep_warm2,        exit_keep_warm2,    kettle_mode_keep_warm2},
+    [MODE_FAULT]        = {enter_fault,             exit_fault,         NULL},
+};
+
+/* Kettle transitions, indexed by mode and event */
+static const MODE_E sg_kettle_trans[MODE_NUM][EVT_NUM] = {
+    /*                     FAULT_SET    FAULT_CLEAR  SETTING          TEMP_SAMPLE */
+    [MODE_NATURE]       = {MODE_FAULT,  MODE_NONE,   MODE_BY_SETTING, MODE_NONE},
+    [MODE_BOIL]         = {MODE_FAULT,  MODE_NONE,   MODE_BY_SETTING, MODE_NONE},
+    [MODE_KEEP_WARM1]   = {MODE_FAULT,  MODE_NONE,   MODE_BY_SETTING, MODE_NONE},
+    [MODE_KEEP_WARM2]   = {MODE_FAULT,  MODE_NONE,   MODE_BY_SETTING, MODE_NONE},
+    [MODE_FAULT]        = {MODE_NONE,   MODE_NATURE, MODE_NONE,       MODE_NONE},
+};
+
+/* Kettle events waiting for dispatch, bitmap */
+static uint8_t sg_kettle_evt = 0;
+
+/* Temperature history and predictive boil cutoff */
+static TEMP_HIST_T sg_temp_hist;
+static BOIL_CUT_T sg_boil_cut;
+static void reset_boil_plateau(void);
+static BOIL_POINT_T sg_boil_point;
+/* Highest temperature since the lack water fault was raised (0.1 degree) */
+static uint16_t sg_fault_temp;
+
 /* BLE connect wait timer */
-static uint32_t sg_ble_tm = 0;
+static void wait_ble_connect_timeout_handler(void);
+static APP_TIMER_T sg_ble_timer;
+
+/* Temperature sample timer */
+static void update_cur_temp(void);
+static void restart_temp_sample_timer(void);
+static APP_TIMER_T sg_temp_timer;
+static uint32_t sg_temp_sample_ms = 0;  /* last sample deadline */
 
 /* Kettle flag */
 FLAG_BIT g_kettle_flag;
     #define F_BLE_BONDING       g_kettle_flag.bit0
     #define F_WAIT_BLE_CONN     g_kettle_flag.bit1
+    #define F_TEMP_STABLE       g_kettle_flag.bit2
 
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
 /**
- * @brief get dp type
+ * @brief get dp descriptor
  * @param[in] dp_id: DP ID
- * @return type: DP type
+ * @return dp descriptor, NULL if the DP is unknown
  */
-static uint8_t get_dp_type(uint8_t dp_id)
+static const DP_DESC_T *get_dp_desc(uint8_t dp_id)
 {
-    dp_type type = 0;
-    switch (dp_id) {
-    case DP_ID_BOIL:
-        type = DP_TYPE_BOIL;
-        break;
-    case DP_ID_TEMP_CUR:
-        type = DP_TYPE_TEMP_CUR;
-        break;
-    case DP_ID_TEMP_SET:
-        type = DP_TYPE_TEMP_SET;
-        break;
-    case DP_ID_KEEP_WARM:
-        type = DP_TYPE_KEEP_WARM;
-        break;
-    case DP_ID_WATER_TYPE:
-        type = DP_TYPE_WATER_TYPE;
-        break;
-    case DP_ID_FAULT:
-        type = DP_TYPE_FAULT;
-        break;
-    default:
-        break;
+    if ((dp_id < DP_ID_BASE) || (dp_id >= (DP_ID_BASE + DP_NUM))) {
+        return NULL;
     }
-    return type;
+    return &sg_dp_desc[DP_IDX(dp_id)];
 }
 
 /**
- * @brief report one dp data
+ * @brief encode dp value (big endian)
+ * @param[out] buf: value buffer
+ * @param[in] len: value length
+ * @param[in] value: DP value
+ * @return none
+ */
+static void encode_dp_value(uint8_t *buf, uint8_t len, uint32_t value)
+{
+    while (len--) {
+        buf[len] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief decode dp value (big endian)
+ * @param[in] buf: value buffer
+ * @param[in] len: value length
+ * @return DP value
+ */
+static uint32_t decode_dp_value(const uint8_t *buf, uint8_t len)
+{
+    uint32_t value = 0;
+    while (len--) {
+        value = (value << 8) | *buf++;
+    }
+    return value;
+}
+
+/**
+ * @brief encode one dp data
+ * @param[out] buf: dp data buffer
+ * @param[in] desc: dp descriptor
+ * @param[in] value: DP value
+ * @return encoded length
+ */
+static uint8_t encode_dp_data(uint8_t *buf, const DP_DESC_T *desc, uint32_t value)
+{
+    buf[0] = desc->id;
+    buf[1] = desc->type;
+    buf[2] = desc->len;
+    encode_dp_value(&buf[DP_HEAD_LEN], desc->len, value);
+    return (DP_HEAD_LEN + desc->len);
+}
+
+/**
+ * @brief mark one dp data for reporting
  * @param[in] dp_id: DP ID
- * @param[in] dp_value: DP value
  * @return none
  */
-static void report_one_dp_data(uint8_t dp_id, uint8_t dp_value)
+static void report_one_dp_data(uint8_t dp_id)
+{
+    sg_dp_report.dirty |= (1 << DP_IDX(dp_id));
+}
+
+/**
+ * @brief put the dp data in flight back for reporting
+ * @param[in] none
+ * @return none
+ */
+static void requeue_dp_data_report(void)
 {
-    DP_DATA_T dp_data_s;
-    dp_data_s.id = dp_id;
-    dp_data_s.type = get_dp_type(dp_id);
-    dp_data_s.len = 0x01;
-    dp_data_s.value = dp_value;
-    tuya_ble_dp_data_report((uint8_t *)&dp_data_s, sizeof(DP_DATA_T));
+    sg_dp_report.dirty |= sg_dp_report.inflight;
+    sg_dp_report.force |= sg_dp_report.inflight;
+    sg_dp_report.inflight = 0;
+}
+
+/**
+ * @brief send the changed dp data as one report
+ * @param[in] none
+ * @return none
+ */
+static void send_dp_data_report(void)
+{
+    uint8_t dp_data[DP_REPORT_BUF_SIZE];
+    uint8_t dp_len = 0;
+    uint8_t dp_num = 0;
+    uint8_t mask = 0;
+    uint32_t value;
+    uint8_t i;
+
+    /* only one report in flight, the next one waits for its response */
+    if (sg_dp_report.inflight) {
+        if (!clock_time_exceed(sg_dp_report.sent_tm, TIME_DP_REPORT_TIMEOUT*1000)) {
+            return;
+        }
+        requeue_dp_data_report();
+    }
+    if ((sg_dp_report.dirty == 0) || (tuya_ble_connect_status_get() != BONDING_CONN)) {
+        return;
+    }
+
+    for (i = 0; i < DP_NUM; i++) {
+        if (!(sg_dp_report.dirty & (1 << i))) {
+            continue;
+        }
+        value = sg_dp_desc[i].get();
+        /* skip the value the app already has */
+        if (!(sg_dp_report.force & (1 << i)) &&
+            (sg_dp_report.shadow_valid & (1 << i)) &&
+            (sg_dp_report.shadow[i] == value)) {
+            continue;
+        }
+        dp_len += encode_dp_data(&dp_data[dp_len], &sg_dp_desc[i], value);
+        sg_dp_report.sent[i] = value;
+        mask |= (1 << i);
+        dp_num++;
+    }
+    sg_dp_report.dirty = 0;
+    sg_dp_report.force = 0;
+    if (dp_num == 0) {
+        return;
+    }
+
+    /* sent with our own sn, so only the response to this report acks it */
+    if (tuya_ble_dp_data_with_flag_report(sg_dp_report.sn + 1, REPORT_FOR_CLOUD_PANEL, dp_data, dp_len) != TUYA_BLE_SUCCESS) {
+        sg_dp_report.dirty = mask;  /* try again in the next pass */
+        sg_dp_report.force = mask;
+        return;
+    }
+    sg_dp_report.sn++;
+    sg_dp_report.inflight = mask;
+    sg_dp_report.sent_tm = clock_time();
+    sg_dp_report.report_cnt++;
+    TUYA_APP_LOG_DEBUG("dp report: %d dp, total reports: %d", dp_num, sg_dp_report.report_cnt);
 }
 
 /**
@@ -172,12 +503,8 @@ static void report_one_dp_data(uint8_t dp_id, uint8_t dp_value)
  */
 static void report_all_dp_data(void)
 {
-    report_one_dp_data(DP_ID_BOIL, g_kettle.boil_turn);
-    report_one_dp_data(DP_ID_KEEP_WARM, g_kettle.keep_warm_turn);
-    report_one_dp_data(DP_ID_TEMP_CUR, g_kettle.temp_cur);
-    report_one_dp_data(DP_ID_TEMP_SET, g_kettle.temp_set);
-    report_one_dp_data(DP_ID_WATER_TYPE, g_kettle.water_type);
-    report_one_dp_data(DP_ID_FAULT, g_kettle.fault);
+    sg_dp_report.dirty = DP_ALL_MASK;
+    sg_dp_report.force = DP_ALL_MASK;
 }
 
 /**
@@ -190,9 +517,23 @@ static void set_work_mode(uint8_t mode)
     if (mode != g_kettle.mode) {
         g_kettle.mode = mode;
         TUYA_APP_LOG_DEBUG("mode: %d", g_kettle.mode);
+        if ((mode != MODE_BOIL) && (mode != MODE_KEEP_WARM1)) {
+            reset_boil_plateau();               /* a plateau is only learned while boiling */
+        }
+        restart_temp_sample_timer();            /* the sample period follows the mode */
     }
 }
 
+/**
+ * @brief post kettle event, handled by dispatch_kettle_event in the main loop
+ * @param[in] evt: kettle event
+ * @return none
+ */
+static void post_kettle_event(KETTLE_EVT_E evt)
+{
+    sg_kettle_evt |= (1 << evt);
+}
+
 /**
  * @brief set boil turn on or off
  * @param[in] on_off: 0-off, 1-on
@@ -204,9 +545,10 @@ static void set_boil_turn(uint8_t on_off)
         return;
     }
     g_kettle.boil_turn = on_off;
-    report_one_dp_data(DP_ID_BOIL, g_kettle.boil_turn);
+    report_one_dp_data(DP_ID_BOIL);
+    post_kettle_event(EVT_SETTING);
     TUYA_APP_LOG_DEBUG("boil turn: %d", g_kettle.boil_turn);
-    set_led_red(on_off);
+    set_led(LED_RED, on_off);
 }
 
 /**
@@ -234,9 +576,10 @@ static void set_keep_warm_turn(uint8_t on_off)
         return;
     }
     g_kettle.keep_warm_turn = on_off;
-    report_one_dp_data(DP_ID_KEEP_WARM, g_kettle.keep_warm_turn);
+    report_one_dp_data(DP_ID_KEEP_WARM);
+    post_kettle_event(EVT_SETTING);
     TUYA_APP_LOG_DEBUG("keep warm turn: %d", g_kettle.keep_warm_turn);
-    set_led_orange(on_off);
+    set_led(LED_ORANGE, on_off);
 }
 
 /**
@@ -260,11 +603,7 @@ static void switch_keep_warm_turn(void)
  */
 static void set_keep_warm_temp(uint8_t temp)
 {
-    if (g_kettle.temp_set != temp) {
-        if ((temp >= 45) && (temp <= 90)) {
-            g_kettle.temp_set = temp;
-        }
-    }
+    g_kettle.temp_set = temp;
 }
 
 /**
@@ -275,6 +614,7 @@ static void set_keep_warm_temp(uint8_t temp)
 static void set_water_type(WATER_TYPE_E type)
 {
     g_kettle.water_type = type;
+    post_kettle_event(EVT_SETTING);
 }
 
 /**
@@ -285,10 +625,67 @@ static void set_water_type(WATER_TYPE_E type)
 static void update_fault(FAULT_E fault)
 {
     g_kettle.fault = fault;
-    report_one_dp_data(DP_ID_FAULT, g_kettle.fault);
+    report_one_dp_data(DP_ID_FAULT);
     TUYA_APP_LOG_DEBUG("fault: %d", g_kettle.fault);
 }
 
+/**
+ * @brief dp accessor functions of the dp schema
+ */
+static uint32_t dp_get_boil(void)
+{
+    return g_kettle.boil_turn;
+}
+
+static uint32_t dp_get_keep_warm(void)
+{
+    return g_kettle.keep_warm_turn;
+}
+
+static uint32_t dp_get_temp_cur(void)
+{
+#if (DP_TEMP_CUR_SCALE == 1)
+    return g_kettle.temp_cur;
+#else
+    return ((g_kettle.temp_cur + 5) / 10);
+#endif
+}
+
+static uint32_t dp_get_temp_set(void)
+{
+    return g_kettle.temp_set;
+}
+
+static uint32_t dp_get_water_type(void)
+{
+    return g_kettle.water_type;
+}
+
+static uint32_t dp_get_fault(void)
+{
+    return g_kettle.fault;
+}
+
+static void dp_set_boil(uint32_t value)
+{
+    set_boil_turn((uint8_t)value);
+}
+
+static void dp_set_keep_warm(uint32_t value)
+{
+    set_keep_warm_turn((uint8_t)value);
+}
+
+static void dp_set_temp_set(uint32_t value)
+{
+    set_keep_warm_temp((uint8_t)value);
+}
+
+static void dp_set_water_type(uint32_t value)
+{
+    set_water_type((WATER_TYPE_E)value);
+}
+
 /**
  * @brief update ble status and data
  * @param[in] none
@@ -306,11 +703,12 @@ static void ble_connect_status_init(void)
         (ble_conn_sta == BONDING_UNAUTH_CONN)) {
         F_BLE_BONDING = SET;
         F_WAIT_BLE_CONN = CLR;
-        set_led_green_mode(LED_MODE_FIX);
+        set_led_pattern(LED_GREEN, NULL);
     } else {
         F_BLE_BONDING = CLR;
         F_WAIT_BLE_CONN = SET;
-        set_led_green_mode(LED_MODE_TWINKLE);
+        set_led_pattern(LED_GREEN, &g_led_pattern_twinkle);
+        app_timer_start(&sg_ble_timer, TIME_ALLOW_CONNECT, 0, wait_ble_connect_timeout_handler);
     }
 }
 
@@ -322,38 +720,271 @@ static void ble_connect_status_init(void)
 static void try_to_connect_ble(void)
 {
     F_WAIT_BLE_CONN = SET;                  /* set the waiting for ble connection flag */
-    set_led_green_mode(LED_MODE_TWINKLE);   /* set led green to twinkle mode */
+    set_led_pattern(LED_GREEN, &g_led_pattern_twinkle);   /* set led green to twinkle mode */
     bls_ll_setAdvEnable(1);                 /* start advertising */
-    sg_ble_tm = clock_time();               /* save current time */
+    app_timer_start(&sg_ble_timer, TIME_ALLOW_CONNECT, 0, wait_ble_connect_timeout_handler);
 }
 
 /**
- * @brief wait ble connect
+ * @brief ble connect wait timer handler
  * @param[in] none
  * @return none
  */
-static void wait_ble_connect(void)
+static void wait_ble_connect_timeout_handler(void)
 {
-    if (!clock_time_exceed(sg_ble_tm, TIME_ALLOW_CONNECT*1000)) {
+    if ((F_BLE_BONDING == SET) || (F_WAIT_BLE_CONN == CLR)) {
         return;
     }
     F_WAIT_BLE_CONN = CLR;                  /* clear the waiting for ble connection flag */
-    set_led_green_mode(LED_MODE_FIX);       /* stop twinkling */
+    set_led_pattern(LED_GREEN, NULL);       /* stop twinkling */
     bls_ll_setAdvEnable(0);                 /* stop advertising */
 }
 
 /**
- * @brief update ble status
+ * @brief add temperature sample to history
+ * @param[in] temp: temperature value (0.1 degree)
+ * @return none
+ */
+static void add_temp_history(uint16_t temp)
+{
+    sg_temp_hist.temp[sg_temp_hist.head] = temp;
+    sg_temp_hist.tm[sg_temp_hist.head] = clock_time();
+    sg_temp_hist.head = (sg_temp_hist.head + 1) % TEMP_HIST_SIZE;
+    if (sg_temp_hist.num < TEMP_HIST_SIZE) {
+        sg_temp_hist.num++;
+    }
+}
+
+/**
+ * @brief get temperature rise over the latest samples
+ * @param[in] num: number of samples, 2 ~ TEMP_HIST_SIZE
+ * @param[out] rise: temperature rise (0.1 degree)
+ * @param[out] span: time span of the rise (ms)
+ * @return 0-not enough history 1-ok
+ */
+static uint8_t get_temp_rise(uint8_t num, int32_t *rise, uint32_t *span)
+{
+    uint8_t newest, oldest;
+
+    if (num > sg_temp_hist.num) {
+        num = sg_temp_hist.num;
+    }
+    if (num < 2) {
+        return 0;
+    }
+    newest = (sg_temp_hist.head + TEMP_HIST_SIZE - 1) % TEMP_HIST_SIZE;
+    oldest = (sg_temp_hist.head + TEMP_HIST_SIZE - num) % TEMP_HIST_SIZE;
+    *span = (sg_temp_hist.tm[newest] - sg_temp_hist.tm[oldest]) / CLOCK_16M_SYS_TIMER_CLK_1MS;
+    if (*span < TIME_RATE_SPAN_MIN) {
+        return 0;
+    }
+    *rise = (int32_t)sg_temp_hist.temp[newest] - sg_temp_hist.temp[oldest];
+    return 1;
+}
+
+/**
+ * @brief get temperature rise over the shortest recent span of at least TIME_RATE_SPAN_MIN
+ * @param[out] rise: temperature rise (0.1 degree)
+ * @param[out] span: time span (ms)
+ * @return 0-not enough history 1-ok
+ */
+static uint8_t get_recent_temp_rise(int32_t *rise, uint32_t *span)
+{
+    uint8_t num;
+
+    /* by time, not a sample count: the sample period changes with the thermal state */
+    for (num = 2; num <= sg_temp_hist.num; num++) {
+        if (get_temp_rise(num, rise, span)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief load learned boil data from flash
+ * @param[in] none
+ * @return none
+ */
+static void load_kettle_nv(void)
+{
+    KETTLE_NV_T nv;
+
+    if ((tuya_ble_nv_read(KETTLE_NV_ADDR, (uint8_t *)&nv, sizeof(nv)) != TUYA_BLE_SUCCESS) ||
+        (nv.magic != KETTLE_NV_MAGIC)) {
+        return;
+    }
+    if ((nv.boil_point >= TEMP_BOIL_POINT_MIN) && (nv.boil_point <= TEMP_BOIL_POINT_MAX)) {
+        sg_boil_point.point = nv.boil_point;
+        sg_boil_point.saved = nv.boil_point;
+    }
+    if (nv.boil_lag <= TIME_BOIL_LAG_MAX) {
+        sg_boil_cut.lag = nv.boil_lag;
+    }
+    TUYA_APP_LOG_DEBUG("nv boil point: %d, lag: %dms", sg_boil_point.point, sg_boil_cut.lag);
+}
+
+/**
+ * @brief save learned boil data to flash
+ * @param[in] none
+ * @return none
+ */
+static void save_kettle_nv(void)
+{
+    KETTLE_NV_T nv;
+
+    memset(&nv, 0, sizeof(nv));
+    nv.magic = KETTLE_NV_MAGIC;
+    nv.boil_point = sg_boil_point.point;
+    nv.boil_lag = sg_boil_cut.lag;
+    sg_boil_point.saved = sg_boil_point.point;
+    if ((tuya_ble_nv_erase(KETTLE_NV_ADDR, TUYA_NV_ERASE_MIN_SIZE) != TUYA_BLE_SUCCESS) ||
+        (tuya_ble_nv_write(KETTLE_NV_ADDR, (uint8_t *)&nv, sizeof(nv)) != TUYA_BLE_SUCCESS)) {
+        TUYA_APP_LOG_ERROR("save kettle nv failed");
+    }
+}
+
+/**
+ * @brief set boil point
+ * @param[in] point: boil point (0.1 degree)
+ * @return none
+ */
+static void set_boil_point(uint16_t point)
+{
+    if (point < TEMP_BOIL_POINT_MIN) {
+        point = TEMP_BOIL_POINT_MIN;
+    } else if (point > TEMP_BOIL_POINT_MAX) {
+        point = TEMP_BOIL_POINT_MAX;
+    }
+    sg_boil_point.point = point;
+    TUYA_APP_LOG_DEBUG("boil point: %d", sg_boil_point.point);
+}
+
+/**
+ * @brief raise the boil point after a boil without plateau, saved in steps to spare the flash
+ * @param[in] none
+ * @return none
+ */
+static void drift_boil_point(void)
+{
+    set_boil_point(sg_boil_point.point + TEMP_BOIL_POINT_DRIFT);
+    if (sg_boil_point.point >= sg_boil_point.saved + TEMP_BOIL_POINT_SAVE) {
+        save_kettle_nv();
+    }
+}
+
+/**
+ * @brief drop the plateau tracked or found, it belongs to the heating that ended
+ * @param[in] none
+ * @return none
+ */
+static void reset_boil_plateau(void)
+{
+    sg_boil_point.tracking = 0;
+    sg_boil_point.found = 0;
+}
+
+/**
+ * @brief detect the boiling plateau: flat temperature with the relay on
  * @param[in] none
  * @return none
  */
-static void update_ble_status(void)
+static void update_boil_plateau(void)
+{
+    if ((get_relay() == OFF) || (g_kettle.temp_cur < TEMP_BOIL_POINT_MIN) ||
+        ((g_kettle.mode != MODE_BOIL) && (g_kettle.mode != MODE_KEEP_WARM1))) {
+        reset_boil_plateau();
+        return;
+    }
+    if ((sg_boil_point.tracking == 0) ||
+        (g_kettle.temp_cur > sg_boil_point.ref_temp + TEMP_PLATEAU_BAND) ||
+        (g_kettle.temp_cur + TEMP_PLATEAU_BAND < sg_boil_point.ref_temp)) {
+        sg_boil_point.tracking = 1;
+        sg_boil_point.ref_temp = g_kettle.temp_cur;
+        sg_boil_point.ref_tm = clock_time();
+        return;
+    }
+    if (clock_time_exceed(sg_boil_point.ref_tm, TIME_BOIL_PLATEAU*1000)) {
+        sg_boil_point.found = 1;
+    }
+}
+
+/**
+ * @brief is the water boiled, or will it boil on the heat left in the heater
+ * @param[in] none
+ * @return 0-false 1-true
+ */
+static uint8_t is_water_boiled(void)
 {
-    if (F_BLE_BONDING == CLR) {
-        if (F_WAIT_BLE_CONN == SET) {
-            wait_ble_connect();
+    int32_t rise;
+    uint32_t span;
+
+    if (sg_boil_point.found) {
+        /* boiling below the learned point: learn it, cutting a margin early next time */
+        reset_boil_plateau();
+        set_boil_point(g_kettle.temp_cur - TEMP_BOIL_POINT_MARGIN);
+        save_kettle_nv();
+        return 1;
+    }
+    if (g_kettle.temp_cur >= sg_boil_point.point) {
+        if (get_relay() == ON) {
+            /* no plateau on the way: creep up in case the real boil point is higher */
+            drift_boil_point();
         }
+        return 1;
+    }
+    if ((get_relay() == OFF) || !get_temp_rise(TEMP_HIST_SIZE, &rise, &span) || (rise <= 0)) {
+        return 0;
+    }
+    if ((g_kettle.temp_cur + rise * (int32_t)sg_boil_cut.lag / (int32_t)span) < sg_boil_point.point) {
+        return 0;
+    }
+    drift_boil_point();
+    /* predicted: watch the overshoot to learn the lag */
+    sg_boil_cut.observe = 1;
+    sg_boil_cut.cut_temp = g_kettle.temp_cur;
+    sg_boil_cut.peak_temp = g_kettle.temp_cur;
+    sg_boil_cut.cut_rise = rise;
+    sg_boil_cut.cut_span = span;
+    sg_boil_cut.cut_tm = clock_time();
+    TUYA_APP_LOG_DEBUG("boil predicted at %d, rise %d in %dms", g_kettle.temp_cur, rise, span);
+    return 1;
+}
+
+/**
+ * @brief learn boil lag from the overshoot after a predicted cut
+ * @param[in] none
+ * @return none
+ */
+static void update_boil_lag(void)
+{
+    int32_t lag;
+
+    if (sg_boil_cut.observe == 0) {
+        return;
+    }
+    if (get_relay() == ON) {            /* heating again, the overshoot is lost */
+        sg_boil_cut.observe = 0;
+        return;
+    }
+    if (g_kettle.temp_cur > sg_boil_cut.peak_temp) {
+        sg_boil_cut.peak_temp = g_kettle.temp_cur;
+    }
+    if ((g_kettle.temp_cur + TEMP_FALL_RANGE > sg_boil_cut.peak_temp) &&
+        !clock_time_exceed(sg_boil_cut.cut_tm, TIME_BOIL_OBSERVE*1000)) {
+        return;
+    }
+    /* lag that would have predicted the observed peak */
+    lag = (int32_t)(sg_boil_cut.peak_temp - sg_boil_cut.cut_temp) * (int32_t)sg_boil_cut.cut_span / sg_boil_cut.cut_rise;
+    lag = (int32_t)sg_boil_cut.lag + ((lag - (int32_t)sg_boil_cut.lag) >> BOIL_LAG_LEARN_SHIFT);
+    if (lag < 0) {
+        lag = 0;
+    } else if (lag > TIME_BOIL_LAG_MAX) {
+        lag = TIME_BOIL_LAG_MAX;
     }
+    sg_boil_cut.lag = (uint32_t)lag;
+    sg_boil_cut.observe = 0;
+    TUYA_APP_LOG_DEBUG("boil overshoot: %d, lag: %dms", sg_boil_cut.peak_temp - sg_boil_cut.cut_temp, sg_boil_cut.lag);
 }
 
 /**
@@ -363,9 +994,9 @@ static void update_ble_status(void)
  */
 static void kettle_mode_nature(void)
 {
-    set_led_red(OFF);
-    set_led_orange(OFF);
-    set_led_green_status(OFF);
+    set_led(LED_RED, OFF);
+    set_led(LED_ORANGE, OFF);
+    set_led(LED_GREEN, OFF);
     set_relay(OFF);
 }
 
@@ -376,7 +1007,7 @@ static void kettle_mode_nature(void)
  */
 static void kettle_mode_boil(void)
 {
-    if (g_kettle.temp_cur >= TEMP_BOILED) {
+    if (is_water_boiled()) {
         set_water_type(WATER_TYPE_PURE);
         set_boil_turn(OFF);
         set_relay(OFF);
@@ -392,7 +1023,7 @@ static void kettle_mode_boil(void)
  */
 static void kettle_mode_keep_warm1(void)
 {
-    if (g_kettle.temp_cur >= TEMP_BOILED) {
+    if (is_water_boiled()) {
         set_water_type(WATER_TYPE_PURE);
         set_relay(OFF);
     } else {
@@ -400,6 +1031,170 @@ static void kettle_mode_keep_warm1(void)
     }
 }
 
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+/**
+ * @brief PI output at an error, the integral as it is
+ * @param[in] err: temp_set - temp_cur (0.1 degree)
+ * @return out: relay duty (0.1%)
+ */
+static int32_t get_pi_out(int32_t err)
+{
+    int32_t out;
+
+    out = PI_KP * err + sg_pi_ctrl.integral;
+    if (out > PI_DUTY_MAX) {
+        out = PI_DUTY_MAX;
+    } else if (out < 0) {
+        out = 0;
+    }
+    return out;
+}
+
+/**
+ * @brief calculate relay duty of the next window
+ * @param[in] none
+ * @return duty: relay duty (0.1%)
+ */
+static uint16_t get_pi_duty(void)
+{
+    int32_t err;
+    int32_t out;
+
+    err = (int32_t)TEMP_X10(g_kettle.temp_set) - g_kettle.temp_cur;
+    out = PI_KP * err + sg_pi_ctrl.integral + PI_KI * err;
+    /* anti-windup: stop integrating while the output is saturated in the error direction,
+       and away from temp_set, where a heat-up from cold or a cool-down after a boil winds it up */
+    if (!(((out >= PI_DUTY_MAX) && (err > 0)) || ((out <= 0) && (err < 0))) &&
+        (err <= PI_ERR_BAND) && (err >= -PI_ERR_BAND)) {
+        sg_pi_ctrl.integral += PI_KI * err;
+    }
+    if (sg_pi_ctrl.integral > PI_DUTY_MAX) {
+        sg_pi_ctrl.integral = PI_DUTY_MAX;
+    } else if (sg_pi_ctrl.integral < 0) {
+        sg_pi_ctrl.integral = 0;
+    }
+
+    out = get_pi_out(err);
+    /* no relay pulse shorter than TIME_PI_PULSE_MIN */
+    if ((out * TIME_PI_WINDOW / PI_DUTY_MAX) < TIME_PI_PULSE_MIN) {
+        out = 0;
+    } else if (((PI_DUTY_MAX - out) * TIME_PI_WINDOW / PI_DUTY_MAX) < TIME_PI_PULSE_MIN) {
+        out = PI_DUTY_MAX;
+    }
+    return (uint16_t)out;
+}
+
+/**
+ * @brief start a PI window, relay on for the first duty part of it
+ * @param[in] none
+ * @return none
+ */
+static void start_pi_window(void)
+{
+    uint32_t on_time;
+
+    if ((g_kettle.mode != MODE_KEEP_WARM2) || (g_kettle.fault != FAULT_NORMAL)) {
+        return;
+    }
+    sg_pi_ctrl.duty = get_pi_duty();
+    TUYA_APP_LOG_DEBUG("keep warm duty: %d", sg_pi_ctrl.duty);
+    on_time = (uint32_t)sg_pi_ctrl.duty * TIME_PI_WINDOW / PI_DUTY_MAX;
+    sg_pi_ctrl.window_tm = app_timer_get_ms();
+    if (on_time == 0) {
+        set_relay(OFF);
+        app_timer_start(&sg_pi_timer, TIME_PI_WINDOW, 0, pi_window_timeout_handler);
+    } else {
+        set_relay(ON);
+        app_timer_start(&sg_pi_timer, on_time, 0, pi_window_timeout_handler);
+    }
+}
+
+/**
+ * @brief PI window timer handler: end of the on part, or end of the window
+ * @param[in] none
+ * @return none
+ */
+static void pi_window_timeout_handler(void)
+{
+    uint32_t on_time;
+
+    /* a fault found earlier in the same timer pass has not left the mode yet */
+    if ((g_kettle.mode != MODE_KEEP_WARM2) || (g_kettle.fault != FAULT_NORMAL)) {
+        return;
+    }
+    on_time = (uint32_t)sg_pi_ctrl.duty * TIME_PI_WINDOW / PI_DUTY_MAX;
+    if ((get_relay() == ON) && (on_time < TIME_PI_WINDOW)) {
+        set_relay(OFF);
+        app_timer_start(&sg_pi_timer, TIME_PI_WINDOW - on_time, 0, pi_window_timeout_handler);
+        return;
+    }
+    start_pi_window();
+}
+
+/**
+ * @brief end the on part early once the duty at this sample is used up: the window duty was set
+ *        on the reading at its start, and a small fill heats several degrees within a window
+ * @param[in] none
+ * @return none
+ */
+static void check_pi_window(void)
+{
+    uint32_t elapsed, on_time;
+
+    if ((get_relay() != ON) || !app_timer_is_active(&sg_pi_timer)) {
+        return;
+    }
+    elapsed = app_timer_get_ms() - sg_pi_ctrl.window_tm;
+    on_time = (uint32_t)get_pi_out((int32_t)TEMP_X10(g_kettle.temp_set) - g_kettle.temp_cur) *
+              TIME_PI_WINDOW / PI_DUTY_MAX;
+    if ((elapsed < TIME_PI_PULSE_MIN) || (elapsed < on_time) || (elapsed + TIME_PI_PULSE_MIN > TIME_PI_WINDOW)) {
+        return;
+    }
+    sg_pi_ctrl.duty = (uint16_t)(elapsed * PI_DUTY_MAX / TIME_PI_WINDOW);
+    set_relay(OFF);
+    app_timer_start(&sg_pi_timer, TIME_PI_WINDOW - elapsed, 0, pi_window_timeout_handler);
+}
+
+/**
+ * @brief smart kettle enter keep warm2 mode
+ * @param[in] none
+ * @return none
+ */
+static void enter_keep_warm2(void)
+{
+    memset(&sg_pi_ctrl, 0, sizeof(sg_pi_ctrl));  /* start a new window with a clean integral */
+    kettle_mode_keep_warm2();
+    start_pi_window();
+}
+
+/**
+ * @brief smart kettle exit keep warm2 mode
+ * @param[in] none
+ * @return none
+ */
+static void exit_keep_warm2(void)
+{
+    app_timer_stop(&sg_pi_timer);
+}
+
+/**
+ * @brief smart kettle work in keep warm2 mode (time-proportioned PI), relay run by the PI window
+ * @param[in] none
+ * @return none
+ */
+static void kettle_mode_keep_warm2(void)
+{
+    check_pi_window();
+    if ((g_kettle.temp_cur <= TEMP_X10(g_kettle.temp_set)) &&
+        (g_kettle.temp_cur >= TEMP_X10(g_kettle.temp_set - TEMP_KEEP_RANGE))) {
+        set_led(LED_ORANGE, OFF);
+        set_led(LED_GREEN, ON);
+    } else {
+        set_led(LED_ORANGE, ON);
+        set_led(LED_GREEN, OFF);
+    }
+}
+#else
 /**
  * @brief smart kettle work in keep warm2 mode
  * @param[in] none
@@ -407,21 +1202,41 @@ static void kettle_mode_keep_warm1(void)
  */
 static void kettle_mode_keep_warm2(void)
 {
-    if (g_kettle.temp_cur > g_kettle.temp_set) {
-        set_led_orange(ON);
-        set_led_green_status(OFF);
+    if (g_kettle.temp_cur > TEMP_X10(g_kettle.temp_set)) {
+        set_led(LED_ORANGE, ON);
+        set_led(LED_GREEN, OFF);
         set_relay(OFF);
-    } else if (g_kettle.temp_cur < (g_kettle.temp_set - TEMP_KEEP_RANGE)) {
-        set_led_orange(ON);
-        set_led_green_status(OFF);
+    } else if (g_kettle.temp_cur < TEMP_X10(g_kettle.temp_set - TEMP_KEEP_RANGE)) {
+        set_led(LED_ORANGE, ON);
+        set_led(LED_GREEN, OFF);
         set_relay(ON);
     } else {
-        set_led_orange(OFF);
-        set_led_green_status(ON);
+        set_led(LED_ORANGE, OFF);
+        set_led(LED_GREEN, ON);
         set_relay(OFF);
     }
 }
 
+/**
+ * @brief smart kettle enter keep warm2 mode
+ * @param[in] none
+ * @return none
+ */
+static void enter_keep_warm2(void)
+{
+    kettle_mode_keep_warm2();
+}
+
+/**
+ * @brief smart kettle exit keep warm2 mode
+ * @param[in] none
+ * @return none
+ */
+static void exit_keep_warm2(void)
+{
+}
+#endif
+
 /**
  * @brief smart kettle stop
  * @param[in] none
@@ -431,59 +1246,118 @@ static void stop_kettle(void)
 {
     set_boil_turn(OFF);
     set_keep_warm_turn(OFF);
-    set_led_red(OFF);
-    set_led_orange(OFF);
-    set_led_green_status(OFF);
+    set_led(LED_RED, OFF);
+    set_led(LED_ORANGE, OFF);
+    set_led(LED_GREEN, OFF);
     set_relay(OFF);
 }
 
 /**
- * @brief smart kettle run
+ * @brief smart kettle enter fault mode
  * @param[in] none
  * @return none
  */
-static void run_kettle(void)
+static void enter_fault(void)
 {
-    if (g_kettle.fault != FAULT_NORMAL) {
+    /* the heater stays off in this state, whatever was pending */
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+    app_timer_stop(&sg_pi_timer);
+#endif
+    set_relay(OFF);
+    set_led(LED_RED, OFF);
+    set_led(LED_ORANGE, OFF);
+    set_led(LED_GREEN, OFF);
+    set_buzzer_mode(BUZZER_MODE_FAULT);
+}
+
+/**
+ * @brief smart kettle exit fault mode
+ * @param[in] none
+ * @return none
+ */
+static void exit_fault(void)
+{
+    set_buzzer_mode(BUZZER_MODE_STOP);
+}
+
+/**
+ * @brief get smart kettle mode by setting
+ * @param[in] none
+ * @return mode: work mode
+ */
+static MODE_E get_setting_mode(void)
+{
+    if (g_kettle.boil_turn == ON) {
+        return MODE_BOIL;
+    }
+    if (g_kettle.keep_warm_turn == ON) {
+        return (g_kettle.water_type == WATER_TYPE_TAP) ? MODE_KEEP_WARM1 : MODE_KEEP_WARM2;
+    }
+    return MODE_NATURE;
+}
+
+/**
+ * @brief handle kettle event: run the sample action, then the transition
+ * @param[in] evt: kettle event
+ * @return none
+ */
+static void handle_kettle_event(KETTLE_EVT_E evt)
+{
+    MODE_E next;
+
+    if ((evt == EVT_TEMP_SAMPLE) && (sg_kettle_state[g_kettle.mode].sample != NULL)) {
+        sg_kettle_state[g_kettle.mode].sample();
+    }
+    next = sg_kettle_trans[g_kettle.mode][evt];
+    if (next == MODE_BY_SETTING) {
+        next = get_setting_mode();
+    }
+    if ((next == MODE_NONE) || (next == g_kettle.mode)) {
         return;
     }
-    switch (g_kettle.mode) {
-    case MODE_NATURE:
-        kettle_mode_nature();
-        break;
-    case MODE_BOIL:
-        kettle_mode_boil();
-        break;
-    case MODE_KEEP_WARM1:
-        kettle_mode_keep_warm1();
-        break;
-    case MODE_KEEP_WARM2:
-        kettle_mode_keep_warm2();
-        break;
-    default:
-        break;
+    if (sg_kettle_state[g_kettle.mode].exit != NULL) {
+        sg_kettle_state[g_kettle.mode].exit();
+    }
+    set_work_mode(next);
+    if (sg_kettle_state[g_kettle.mode].enter != NULL) {
+        sg_kettle_state[g_kettle.mode].enter();
     }
 }
 
 /**
- * @brief update smart kettle mode
+ * @brief dispatch kettle events, actions may post new ones
  * @param[in] none
  * @return none
  */
-static void update_kettle_mode(void)
+static void dispatch_kettle_event(void)
 {
-    if (g_kettle.boil_turn == ON) {
-        set_work_mode(MODE_BOIL);
-    } else if (g_kettle.keep_warm_turn == ON){
-        if (g_kettle.water_type == WATER_TYPE_TAP) {
-            set_work_mode(MODE_KEEP_WARM1);
-        } else {
-            set_work_mode(MODE_KEEP_WARM2);
+    KETTLE_EVT_E evt;
+
+    while (sg_kettle_evt != 0) {
+        for (evt = 0; evt < EVT_NUM; evt++) {
+            if (sg_kettle_evt & (1 << evt)) {
+                sg_kettle_evt &= ~(1 << evt);
+                handle_kettle_event(evt);
+                break;                          /* rescan: keep the dispatch order */
+            }
         }
-    } else {
-        set_work_mode(MODE_NATURE);
     }
-    run_kettle();
+}
+
+/**
+ * @brief is the kettle heating dry, a rise steeper than a water load can produce
+ * @param[in] none
+ * @return 0-false 1-true
+ */
+static uint8_t is_dry_heating(void)
+{
+    int32_t rise;
+    uint32_t span;
+
+    if ((get_relay() == OFF) || !get_recent_temp_rise(&rise, &span)) {
+        return 0;
+    }
+    return (rise * 1000 >= (int32_t)(TEMP_DRY_RISE_RATE * span));
 }
 
 /**
@@ -494,18 +1368,72 @@ static void update_kettle_mode(void)
 static void detect_and_handle_fault_event(void)
 {
     if (g_kettle.fault == FAULT_NORMAL) {
-        if (g_kettle.temp_cur >= TEMP_UPPER_LIMIT) {
+        if ((g_kettle.temp_cur >= TEMP_X10(TEMP_UPPER_LIMIT)) || is_dry_heating()) {
+            sg_fault_temp = g_kettle.temp_cur;
+            stop_kettle();                      /* before the fault locks the turns */
             update_fault(FAULT_LACK_WATER);
-            set_buzzer_mode(BUZZER_MODE_FAULT);
-            stop_kettle();
+            post_kettle_event(EVT_FAULT_SET);
         }
     } else {
-        if (g_kettle.temp_cur < TEMP_UPPER_LIMIT) {
+        if (g_kettle.temp_cur > sg_fault_temp) {
+            sg_fault_temp = g_kettle.temp_cur;
+        }
+        /* raised by the rate below the limit: wait until it has cooled off its peak */
+        if ((g_kettle.temp_cur < TEMP_X10(TEMP_UPPER_LIMIT)) &&
+            ((sg_fault_temp >= TEMP_X10(TEMP_UPPER_LIMIT)) || (g_kettle.temp_cur + TEMP_DRY_RECOVER < sg_fault_temp))) {
             update_fault(FAULT_NORMAL);
-            set_buzzer_mode(BUZZER_MODE_STOP);
-            set_work_mode(MODE_NATURE);
+            post_kettle_event(EVT_FAULT_CLEAR);
+        }
+    }
+}
+
+/**
+ * @brief is current temperature near the threshold
+ * @param[in] threshold: temperature threshold (0.1 degree)
+ * @return 0-false 1-true
+ */
+static uint8_t is_temp_near(uint16_t threshold)
+{
+    return ((g_kettle.temp_cur + TEMP_NEAR_RANGE >= threshold) &&
+            (g_kettle.temp_cur <= threshold + TEMP_NEAR_RANGE));
+}
+
+/**
+ * @brief get temperature sample period by thermal state
+ * @param[in] none
+ * @return period: sample period (ms)
+ */
+static uint32_t get_temp_sample_period(void)
+{
+    if (g_kettle.fault != FAULT_NORMAL) {
+        return TIME_GET_TEMP;
+    }
+    if (g_kettle.temp_cur + TEMP_NEAR_RANGE >= TEMP_X10(TEMP_UPPER_LIMIT)) {
+        return TIME_GET_TEMP_FAST;
+    }
+    switch (g_kettle.mode) {
+    case MODE_BOIL:
+    case MODE_KEEP_WARM1:
+        if (is_temp_near(sg_boil_point.point)) {
+            return TIME_GET_TEMP_FAST;
         }
+        break;
+    case MODE_KEEP_WARM2:
+        /* bang-bang cuts the relay at temp_set while heating, the PI window cuts it by time */
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_BANG_BANG)
+        if ((get_relay() == ON) && is_temp_near(TEMP_X10(g_kettle.temp_set))) {
+            return TIME_GET_TEMP_FAST;
+        }
+#endif
+        break;
+    case MODE_NATURE:
+    default:
+        if (F_TEMP_STABLE == SET) {
+            return TIME_GET_TEMP_IDLE;
+        }
+        break;
     }
+    return TIME_GET_TEMP;
 }
 
 /**
@@ -515,20 +1443,41 @@ static void detect_and_handle_fault_event(void)
  */
 static void update_cur_temp(void)
 {
-    uint8_t temp;
-    static uint32_t s_get_temp_tm = 0;
+    uint16_t temp;
 
-    if (!clock_time_exceed(s_get_temp_tm, TIME_GET_TEMP*1000)) {
-        return;
+    /* the schedule, not the run time, so the loop latency does not slip the period */
+    sg_temp_sample_ms = sg_temp_timer.deadline;
+    temp = get_cur_temp_x10();
+    add_temp_history(temp);
+    if ((temp + TEMP_STABLE_RANGE >= g_kettle.temp_cur) && (temp <= g_kettle.temp_cur + TEMP_STABLE_RANGE)) {
+        F_TEMP_STABLE = SET;
+    } else {
+        F_TEMP_STABLE = CLR;
     }
-    s_get_temp_tm = clock_time();
-
-    temp = get_cur_temp();
     if (g_kettle.temp_cur != temp) {
         g_kettle.temp_cur = temp;
-        report_one_dp_data(DP_ID_TEMP_CUR, g_kettle.temp_cur);
+        report_one_dp_data(DP_ID_TEMP_CUR);
         detect_and_handle_fault_event();
     }
+    update_boil_lag();
+    update_boil_plateau();
+    post_kettle_event(EVT_TEMP_SAMPLE);
+    app_timer_start_at(&sg_temp_timer, app_timer_next_deadline(sg_temp_sample_ms, get_temp_sample_period()),
+                       0, update_cur_temp);
+}
+
+/**
+ * @brief restart temperature sample timer with the period of the current state
+ * @param[in] none
+ * @return none
+ */
+static void restart_temp_sample_timer(void)
+{
+    if (!app_timer_is_active(&sg_temp_timer)) {
+        return;
+    }
+    /* a new period already passed samples on the next run */
+    app_timer_start_at(&sg_temp_timer, sg_temp_sample_ms + get_temp_sample_period(), 0, update_cur_temp);
 }
 
 /**
@@ -582,6 +1531,15 @@ void tuya_app_kettle_init(void)
 {
     memset(&g_kettle, 0, sizeof(g_kettle));
     memset(&g_kettle_flag, 0, sizeof(g_kettle_flag));
+    memset(&sg_dp_report, 0, sizeof(sg_dp_report));
+    app_timer_init();
+    memset(&sg_temp_hist, 0, sizeof(sg_temp_hist));
+    memset(&sg_boil_cut, 0, sizeof(sg_boil_cut));
+    sg_boil_cut.lag = TIME_BOIL_LAG_DEFAULT;
+    memset(&sg_boil_point, 0, sizeof(sg_boil_point));
+    sg_boil_point.point = TEMP_X10(TEMP_BOILED);
+    sg_boil_point.saved = sg_boil_point.point;
+    load_kettle_nv();
     set_keep_warm_temp(TEMP_KEEP_WARM_DEFAULT);
 
     led_init();
@@ -590,52 +1548,60 @@ void tuya_app_kettle_init(void)
     ntc_adc_init();
     ts02n_key_init(&user_ts02n_key_def_s);
     ble_connect_status_init();
+    app_timer_start(&sg_temp_timer, 0, 0, update_cur_temp);
 }
 
 /**
  * @brief main loop of smart kettle
  * @param[in] none
- * @return none
+ * @return time: ms the kettle may sleep, APP_TIMER_NO_DEADLINE-no timer running
  */
-void tuya_app_kettle_loop(void)
+uint32_t tuya_app_kettle_loop(void)
 {
-    update_ble_status();
-    update_cur_temp();
-    ts02n_key_loop();
-    update_kettle_mode();
-    update_led_green_status();
-    update_buzzer_status();
+    uint32_t next_ms;
+
+    ts02n_key_wake_check();
+    next_ms = app_timer_run();
+    dispatch_kettle_event();
+    send_dp_data_report();
+    if ((get_buzzer() == ON) || (get_led_pwm() == ON)) {
+        return 0;                               /* PWM stops in suspend */
+    }
+    return next_ms;
 }
 
 /**
  * @brief dp data handler of smart kettle
- * @param[in] dp_data: dp data array
+ * @param[in] dp_data: dp data array, one or more DPs (read only, SDK buffer)
+ * @param[in] dp_len: dp data length
  * @return none
  */
-void tuya_app_kettle_dp_data_handler(uint8_t *dp_data)
+void tuya_app_kettle_dp_data_handler(const uint8_t *dp_data, uint16_t dp_len)
 {
-    switch (dp_data[0]) {
-    case DP_ID_BOIL:
-        set_boil_turn(dp_data[3]);
-        *(dp_data + 3) = g_kettle.boil_turn;
-        break;
-    case DP_ID_KEEP_WARM:
-        set_keep_warm_turn(dp_data[3]);
-        *(dp_data + 3) = g_kettle.keep_warm_turn;
-        break;
-    case DP_ID_TEMP_SET:
-        set_keep_warm_temp(dp_data[6]);
-        *(dp_data + 6) = g_kettle.temp_set;
-        break;
-    case DP_ID_WATER_TYPE:
-        set_water_type(dp_data[3]);
-        *(dp_data + 3) = g_kettle.water_type;
-        break;
-    case DP_ID_TEMP_CUR:
-    case DP_ID_FAULT:
-    default:
-        break;
+    const DP_DESC_T *desc;
+    uint32_t value;
+    uint16_t offset = 0;
+
+    while ((offset + DP_HEAD_LEN) <= dp_len) {
+        if ((offset + DP_HEAD_LEN + dp_data[offset+2]) > dp_len) {
+            TUYA_APP_LOG_ERROR("dp data truncated at %d", offset);
+            break;
+        }
+        desc = get_dp_desc(dp_data[offset]);
+        if ((desc != NULL) && (desc->set != NULL) &&
+            (dp_data[offset+1] == desc->type) && (dp_data[offset+2] == desc->len)) {
+            value = decode_dp_value(&dp_data[offset+DP_HEAD_LEN], desc->len);
+            if ((value >= desc->min) && (value <= desc->max)) {
+                desc->set(value);
+            }
+            /* echo back the value in effect, even if it did not change */
+            sg_dp_report.dirty |= (1 << DP_IDX(desc->id));
+            sg_dp_report.force |= (1 << DP_IDX(desc->id));
+        }
+        offset += DP_HEAD_LEN + dp_data[offset+2];
     }
+    /* one echo report for all DPs of this write */
+    send_dp_data_report();
 }
 
 /**
@@ -645,12 +1611,14 @@ void tuya_app_kettle_dp_data_handler(uint8_t *dp_data)
  */
 void tuya_app_kettle_ble_connect_status_change_handler(tuya_ble_connect_status_t status)
 {
+    requeue_dp_data_report();                   /* no response will come for the report in flight */
     if (status == BONDING_CONN) {               /* when ble is connected */
         report_all_dp_data();                   /* report all dp information */
         if (F_WAIT_BLE_CONN == SET) {           /* when the waiting for ble connection flag is set */
             F_BLE_BONDING = SET;                /* set the ble bonding flag */
             F_WAIT_BLE_CONN = CLR;              /* clear the waiting for ble connection flag */
-            set_led_green_mode(LED_MODE_FIX);   /* stop twinkling */
+            app_timer_stop(&sg_ble_timer);
+            set_led_pattern(LED_GREEN, NULL);   /* stop twinkling */
         }
     }
     if (status == UNBONDING_UNCONN) {           /* when ble is unbonding */
@@ -658,3 +1626,31 @@ void tuya_app_kettle_ble_connect_status_change_handler(tuya_ble_connect_status_t
         bls_ll_setAdvEnable(0);                 /* stop advertising */
     }
 }
+
+/**
+ * @brief dp data report response handler of smart kettle
+ * @param[in] sn: sn of the report
+ * @param[in] status: response status, 0-success
+ * @return none
+ */
+void tuya_app_kettle_dp_report_response_handler(uint16_t sn, uint8_t status)
+{
+    uint8_t i;
+
+    /* a response to another report (e.g. from the MCU over UART) is not ours */
+    if ((sg_dp_report.inflight == 0) || (sn != sg_dp_report.sn)) {
+        return;
+    }
+    if (status == 0) {
+        for (i = 0; i < DP_NUM; i++) {
+            if (sg_dp_report.inflight & (1 << i)) {
+                sg_dp_report.shadow[i] = sg_dp_report.sent[i];
+            }
+        }
+        sg_dp_report.shadow_valid |= sg_dp_report.inflight;
+        sg_dp_report.inflight = 0;
+    } else {
+        TUYA_APP_LOG_DEBUG("dp report failed: %d", status);
+        requeue_dp_data_report();                       /* resend in the next pass */
+    }
+}
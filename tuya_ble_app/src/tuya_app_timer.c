@@ -0,0 +1,207 @@
+/**
+ * @file tuya_app_timer.c
+ * @author lifan
+ * @brief app software timer source file
+ * @version 1.0
+ * @date 2021-07-06
+ *
+ * @copyright Copyright (c) tuya.inc 2021
+ *
+ */
+
+#include "tuya_app_timer.h"
+#include "timer.h"
+
+/***********************************************************
+************************micro define************************
+***********************************************************/
+/* deadline a is before or at b, wrap safe */
+#define IS_TIME_BEFORE_EQ(a, b)     ((int32_t)((a) - (b)) <= 0)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static APP_TIMER_T *sg_timer_head = NULL;   /* running timers, earliest deadline first */
+static uint32_t sg_timer_ms = 0;            /* time base (ms) */
+static uint32_t sg_timer_tick = 0;          /* clock_time() of sg_timer_ms */
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/**
+ * @brief app timer init
+ * @param[in] none
+ * @return none
+ */
+void app_timer_init(void)
+{
+    sg_timer_head = NULL;
+    sg_timer_ms = 0;
+    sg_timer_tick = clock_time();
+}
+
+/**
+ * @brief get app timer time base
+ * @param[in] none
+ * @return time: ms since init, call at least once every 268s
+ */
+uint32_t app_timer_get_ms(void)
+{
+    uint32_t ms;
+
+    /* clock_time() wraps every 268s, carry whole ms into a 32-bit ms count */
+    ms = (clock_time() - sg_timer_tick) / CLOCK_16M_SYS_TIMER_CLK_1MS;
+    sg_timer_tick += ms * CLOCK_16M_SYS_TIMER_CLK_1MS;
+    sg_timer_ms += ms;
+    return sg_timer_ms;
+}
+
+/**
+ * @brief remove timer from the running list
+ * @param[in] timer: timer
+ * @return none
+ */
+static void remove_timer(APP_TIMER_T *timer)
+{
+    APP_TIMER_T **pp = &sg_timer_head;
+
+    while (*pp != NULL) {
+        if (*pp == timer) {
+            *pp = timer->next;
+            break;
+        }
+        pp = &(*pp)->next;
+    }
+    timer->next = NULL;
+    timer->active = 0;
+}
+
+/**
+ * @brief insert timer into the running list by deadline
+ * @param[in] timer: timer
+ * @return none
+ */
+static void insert_timer(APP_TIMER_T *timer)
+{
+    APP_TIMER_T **pp = &sg_timer_head;
+
+    /* equal deadlines keep start order */
+    while ((*pp != NULL) && IS_TIME_BEFORE_EQ((*pp)->deadline, timer->deadline)) {
+        pp = &(*pp)->next;
+    }
+    timer->next = *pp;
+    *pp = timer;
+    timer->active = 1;
+}
+
+/**
+ * @brief start or restart a timer
+ * @param[in] timer: timer
+ * @param[in] timeout: first timeout (ms)
+ * @param[in] period: period after the first timeout (ms), 0-one shot
+ * @param[in] cb: timeout callback function
+ * @return none
+ */
+void app_timer_start(APP_TIMER_T *timer, uint32_t timeout, uint32_t period, APP_TIMER_CALLBACK cb)
+{
+    app_timer_start_at(timer, app_timer_get_ms() + timeout, period, cb);
+}
+
+/**
+ * @brief start or restart a timer at an absolute deadline
+ * @param[in] timer: timer
+ * @param[in] deadline: first timeout (ms of app_timer_get_ms()), a passed one times out on the next run
+ * @param[in] period: period after the first timeout (ms), 0-one shot
+ * @param[in] cb: timeout callback function
+ * @return none
+ */
+void app_timer_start_at(APP_TIMER_T *timer, uint32_t deadline, uint32_t period, APP_TIMER_CALLBACK cb)
+{
+    if (timer->active) {
+        remove_timer(timer);
+    }
+    timer->cb = cb;
+    timer->period = period;
+    timer->deadline = deadline;
+    insert_timer(timer);
+}
+
+/**
+ * @brief get the next deadline on the grid of base + n * period
+ * @param[in] base: last deadline (ms)
+ * @param[in] period: period (ms)
+ * @return deadline: first grid point after now, missed periods are skipped
+ */
+uint32_t app_timer_next_deadline(uint32_t base, uint32_t period)
+{
+    uint32_t now, deadline;
+
+    now = app_timer_get_ms();
+    deadline = base + period;
+    if ((period != 0) && IS_TIME_BEFORE_EQ(deadline, now)) {
+        /* late by one or more periods: keep the phase, do not fire a burst */
+        deadline += ((now - deadline) / period + 1) * period;
+    }
+    return deadline;
+}
+
+/**
+ * @brief stop a timer
+ * @param[in] timer: timer
+ * @return none
+ */
+void app_timer_stop(APP_TIMER_T *timer)
+{
+    if (timer->active) {
+        remove_timer(timer);
+    }
+}
+
+/**
+ * @brief is the timer running
+ * @param[in] timer: timer
+ * @return 0-false 1-true
+ */
+uint8_t app_timer_is_active(const APP_TIMER_T *timer)
+{
+    return timer->active;
+}
+
+/**
+ * @brief run the due timers
+ * @param[in] none
+ * @return time: ms until the next deadline, APP_TIMER_NO_DEADLINE-no timer running
+ */
+uint32_t app_timer_run(void)
+{
+    APP_TIMER_T *timer;
+    uint32_t now;
+
+    now = app_timer_get_ms();
+    while ((sg_timer_head != NULL) && IS_TIME_BEFORE_EQ(sg_timer_head->deadline, now)) {
+        timer = sg_timer_head;
+        remove_timer(timer);
+        /* re-arm before the callback, so the callback may stop or restart it,
+           from the deadline rather than now, so the run latency does not add up */
+        if (timer->period != 0) {
+            timer->deadline = app_timer_next_deadline(timer->deadline, timer->period);
+            insert_timer(timer);
+        }
+        if (timer->cb != NULL) {
+            timer->cb();
+        }
+    }
+    if (sg_timer_head == NULL) {
+        return APP_TIMER_NO_DEADLINE;
+    }
+    /* the callbacks may have taken past the next deadline */
+    now = app_timer_get_ms();
+    if (IS_TIME_BEFORE_EQ(sg_timer_head->deadline, now)) {
+        return 0;
+    }
+    return (sg_timer_head->deadline - now);
+}
@@ -18,6 +18,8 @@
 
 #include "tuya_ble_common.h"
 #include "tuya_app_smart_kettle.h"
+#include "tuya_app_pm.h"
+#include "custom_app_uart_common_handler.h"
 
 static tuya_ble_device_param_t device_param = {0};
 
@@ -32,8 +34,6 @@ static const uint8_t mac_test[6] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB}; // The
 #define APP_CUSTOM_EVENT_5  5
 
 static uint8_t dp_data_test[8] = {0x6A, 0x05, 0x05, 0x00, 0x00, 0x00, 0x80, 0x02};
-static uint8_t dp_data_array[255+3];
-static uint16_t dp_data_len = 0;
 
 typedef struct {
     uint8_t data[50];
@@ -81,8 +81,6 @@ void tuya_ble_get_mac(uint8_t mac[6])
 	memcpy(mac, tuya_ble_current_para.auth_settings.mac, 6);
 }
 
-static uint16_t sn = 0;
-static uint32_t time_stamp = 1587795793;
 static void tuya_cb_handler(tuya_ble_cb_evt_param_t* event)
 {
     int16_t result = 0;
@@ -93,21 +91,15 @@ static void tuya_cb_handler(tuya_ble_cb_evt_param_t* event)
         TUYA_APP_LOG_INFO("received tuya ble conncet status update event, current connect status = %d", event->connect_status);
         break;
     case TUYA_BLE_CB_EVT_DP_WRITE:
-        dp_data_len = event->dp_write_data.data_len;
-        memset(dp_data_array, 0, sizeof(dp_data_array));
-        memcpy(dp_data_array, event->dp_write_data.p_data, dp_data_len);
-        tuya_app_kettle_dp_data_handler(dp_data_array);
-        TUYA_APP_LOG_HEXDUMP_DEBUG("received dp write data :", dp_data_array, dp_data_len);
-        sn = 0;
-        tuya_ble_dp_data_report(dp_data_array, dp_data_len);//1
-        //custom_evt_1_send_test(dp_data_len);
+        TUYA_APP_LOG_HEXDUMP_DEBUG("received dp write data :", event->dp_write_data.p_data, event->dp_write_data.data_len);
+        /* decoded straight from the SDK buffer, applies and echoes all DPs */
+        tuya_app_kettle_dp_data_handler(event->dp_write_data.p_data, event->dp_write_data.data_len);
+        //custom_evt_1_send_test(event->dp_write_data.data_len);
         //tuya_ble_dp_data_report(dp_data_test, sizeof(dp_data_test));
-        ///tuya_uart_send_ble_dpdata(dp_data_array, dp_data_len);
+        ///tuya_uart_send_ble_dpdata(event->dp_write_data.p_data, event->dp_write_data.data_len);
         break;
     case TUYA_BLE_CB_EVT_DP_DATA_REPORT_RESPONSE:
         TUYA_APP_LOG_INFO("received dp data report response result code =%d", event->dp_response_data.status);
-        //tuya_ble_dp_data_with_flag_report(sn, REPORT_FOR_CLOUD_PANEL, dp_data_array, dp_data_len); //2
-        //sn++;
         break;
     case TUYA_BLE_CB_EVT_DP_DATA_WTTH_TIME_REPORT_RESPONSE:
         TUYA_APP_LOG_INFO("received dp data report response result code =%d", event->dp_response_data.status);
@@ -117,34 +109,14 @@ static void tuya_cb_handler(tuya_ble_cb_evt_param_t* event)
                           event->dp_with_flag_response_data.sn,
                           event->dp_with_flag_response_data.mode,
                           event->dp_with_flag_response_data.status);
-        if (event->dp_with_flag_response_data.mode == REPORT_FOR_CLOUD_PANEL) {
-            tuya_ble_dp_data_with_flag_report(sn, REPORT_FOR_CLOUD, dp_data_array, dp_data_len);//3
-        } else if(event->dp_with_flag_response_data.mode == REPORT_FOR_CLOUD) {
-            tuya_ble_dp_data_with_flag_report(sn, REPORT_FOR_PANEL, dp_data_array, dp_data_len);//4
-        } else if(event->dp_with_flag_response_data.mode == REPORT_FOR_PANEL) {
-            tuya_ble_dp_data_with_flag_report(sn, REPORT_FOR_NONE, dp_data_array, dp_data_len);//5
-        } else if(event->dp_with_flag_response_data.mode == REPORT_FOR_NONE) {
-            tuya_ble_dp_data_with_flag_and_time_report(sn, REPORT_FOR_CLOUD_PANEL, time_stamp, dp_data_array, dp_data_len);//6
-        } else {
-
-        }
-        sn++;
+        tuya_app_kettle_dp_report_response_handler(event->dp_with_flag_response_data.sn,
+                                                   event->dp_with_flag_response_data.status);
         break;
     case TUYA_BLE_CB_EVT_DP_DATA_WITH_FLAG_AND_TIME_REPORT_RESPONSE:
         TUYA_APP_LOG_INFO("received dp data with flag and time report response sn = %d , flag = %d , result code =%d",
                           event->dp_with_flag_and_time_response_data.sn,
                           event->dp_with_flag_and_time_response_data.mode,
                           event->dp_with_flag_and_time_response_data.status);
-        if(event->dp_with_flag_and_time_response_data.mode == REPORT_FOR_CLOUD_PANEL) {
-            tuya_ble_dp_data_with_flag_and_time_report(sn, REPORT_FOR_CLOUD,time_stamp, dp_data_array,dp_data_len);//7
-        } else if(event->dp_with_flag_and_time_response_data.mode == REPORT_FOR_CLOUD) {
-            tuya_ble_dp_data_with_flag_and_time_report(sn, REPORT_FOR_PANEL, time_stamp, dp_data_array, dp_data_len);//8
-        } else if(event->dp_with_flag_and_time_response_data.mode == REPORT_FOR_PANEL) {
-            tuya_ble_dp_data_with_flag_and_time_report(sn, REPORT_FOR_NONE, time_stamp, dp_data_array, dp_data_len);//9
-        } else {
-
-        }
-        sn++;
         break;
     case TUYA_BLE_CB_EVT_UNBOUND:
         TUYA_APP_LOG_INFO("received unbound req");
@@ -154,13 +126,14 @@ static void tuya_cb_handler(tuya_ble_cb_evt_param_t* event)
         break;
     case TUYA_BLE_CB_EVT_DEVICE_RESET:
         TUYA_APP_LOG_INFO("received device reset req");
+        tuya_uart_tx_flush();
         break;
     case TUYA_BLE_CB_EVT_DP_QUERY:
         TUYA_APP_LOG_INFO("received TUYA_BLE_CB_EVT_DP_QUERY event");
         uart_to_ble_enable = 1;
-        //tuya_ble_dp_data_report(dp_data_array, dp_data_len);
         break;
     case TUYA_BLE_CB_EVT_OTA_DATA:
+        tuya_uart_tx_flush();           /* the last OTA packet reboots the chip */
         tuya_ota_proc(event->ota_data.type, event->ota_data.p_data, event->ota_data.data_len);
         break;
     case TUYA_BLE_CB_EVT_NETWORK_INFO:
@@ -219,9 +192,16 @@ void tuya_ble_app_init(void)
     TUYA_APP_LOG_INFO("app version : "TY_APP_VER_STR);
 
     tuya_app_kettle_init();
+    app_pm_init();
 }
 
 void app_exe()
 {
-    tuya_app_kettle_loop();
+    uint32_t sleep_ms;
+
+    sleep_ms = tuya_app_kettle_loop();
+    if (tuya_uart_tx_process() != 0) {
+        sleep_ms = 0;                   /* keep sending the queued frames */
+    }
+    app_pm_idle(sleep_ms);
 }
@@ -0,0 +1,53 @@
+/**
+ * @file gen_ntc_table.c
+ * @brief print the NTC tables of tuya_app_driver_ntc.c as C rows to paste in it:
+ *        gen_ntc_table        temp_data_of_vol from the driver's vol_data_of_temp
+ *        gen_ntc_table model  vol_data_of_temp from the part in ntc_table.h, for another NTC
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ntc_table.h"
+
+#define ROW_NUM     20
+
+extern const uint16_t vol_data_of_temp[NTC_TABLE_TEMP_NUM];
+
+static void print_temp_of_vol(void)
+{
+    uint8_t temp_of_vol[NTC_TABLE_VOL_MAX];
+    uint16_t num, i, vol;
+
+    num = ntc_table_make_temp_of_vol(vol_data_of_temp, temp_of_vol);
+    for (i = 0; i < num; i++) {
+        printf("%s%3u%s", (i % ROW_NUM == 0) ? "    " : " ", temp_of_vol[i], (i == num - 1) ? " " : ",");
+        if ((i % ROW_NUM == ROW_NUM - 1) || (i == num - 1)) {
+            vol = vol_data_of_temp[0] + ((i - i % ROW_NUM) << NTC_TABLE_STEP_SHIFT);
+            printf(" /* %4u ~ %4u mV */\n", vol, (i == num - 1) ? vol_data_of_temp[NTC_TABLE_TEMP_NUM - 1] :
+                   (vol + (ROW_NUM << NTC_TABLE_STEP_SHIFT) - 1));
+        }
+    }
+}
+
+static void print_vol_of_temp(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < NTC_TABLE_TEMP_NUM; i++) {
+        printf("%s%4.0f%s", (i % ROW_NUM == 0) ? "    " : " ", ntc_table_get_mv(i),
+               (i == NTC_TABLE_TEMP_NUM - 1) ? " " : ",");
+        if (i % ROW_NUM == ROW_NUM - 1) {
+            printf(" /* %u ~ %u */\n", i - (ROW_NUM - 1), i);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc > 1) && (strcmp(argv[1], "model") == 0)) {
+        print_vol_of_temp();
+    } else {
+        print_temp_of_vol();
+    }
+    return 0;
+}
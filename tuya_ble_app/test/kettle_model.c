@@ -0,0 +1,61 @@
+/**
+ * @file kettle_model.c
+ * @brief thermal model of the kettle on the bench, see kettle_model.h
+ */
+
+#include "kettle_model.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+
+#define ELEMENT_J_K     400.0           /* heat capacity of the heater element and base */
+#define ELEMENT_W_K     150.0           /* element to water */
+#define ELEMENT_LOSS_W_K 1.0            /* element to room, what cools an empty kettle */
+#define LOSS_W_K        3.0             /* water to room */
+#define WATER_J_KG_K    4186.0
+#define SENSOR_TAU      3.0             /* s */
+
+KETTLE_MODEL_T g_model;
+
+static uint32_t get_rand(void)
+{
+    g_model.seed = g_model.seed * 1103515245u + 12345u;
+    return (g_model.seed >> 16) & 0x7FFF;
+}
+
+void model_fill(double boil_temp, double water_kg)
+{
+    g_model.boil_temp = boil_temp;
+    g_model.water_kg = water_kg;
+    g_model.water = MODEL_ROOM_TEMP;
+    g_model.element = MODEL_ROOM_TEMP;
+    g_model.sensor = MODEL_ROOM_TEMP;
+    if (g_model.seed == 0) {
+        g_model.seed = 1;
+    }
+}
+
+void model_step(uint32_t ms)
+{
+    const double dt = ms / 1000.0;
+    double heat, to_water;
+    int32_t temp;
+
+    heat = stub_relay ? MODEL_HEATER_W : 0;
+    g_model.energy += heat * dt;
+    if (g_model.water_kg > 0) {
+        to_water = ELEMENT_W_K * (g_model.element - g_model.water);
+        g_model.water += (to_water - LOSS_W_K * (g_model.water - MODEL_ROOM_TEMP)) * dt /
+                         (WATER_J_KG_K * g_model.water_kg);
+        if (g_model.water > g_model.boil_temp) {
+            g_model.water = g_model.boil_temp;      /* the rest goes into steam */
+        }
+    } else {
+        to_water = 0;
+        g_model.water = g_model.element;            /* the sensor sits on the bare base */
+    }
+    g_model.element += (heat - to_water - ELEMENT_LOSS_W_K * (g_model.element - MODEL_ROOM_TEMP)) * dt /
+                       ELEMENT_J_K;
+    g_model.sensor += (g_model.water - g_model.sensor) * dt / SENSOR_TAU;
+    temp = (int32_t)(g_model.sensor * 10 + 0.5) + (int32_t)(get_rand() % 3) - 1;
+    stub_temp_x10 = (temp < 0) ? 0 : (uint16_t)temp;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file kettle_model.h
+ * @brief thermal model of the kettle on the bench for the host tests: heater element, water and
+ *        the NTC under the base; it reads the relay of driver_stub.c and sets its temperature
+ */
+
+#ifndef __KETTLE_MODEL_H__
+#define __KETTLE_MODEL_H__
+
+#include <stdint.h>
+
+#define MODEL_ROOM_TEMP     25.0        /* degree */
+#define MODEL_HEATER_W      1800.0
+
+/* the kettle on the bench */
+typedef struct {
+    double boil_temp;                   /* degree, the boil point at this altitude */
+    double water_kg;                    /* 0-empty: the heater only warms the base */
+    double water;                       /* degree */
+    double element;
+    double sensor;
+    double energy;                      /* J put in by the heater */
+    uint32_t seed;                      /* reading noise */
+} KETTLE_MODEL_T;
+
+extern KETTLE_MODEL_T g_model;
+
+/**
+ * @brief fill the kettle with water at room temperature, heater and sensor cold
+ * @param[in] boil_temp: boil point of the water
+ * @param[in] water_kg: fill level
+ * @return none
+ */
+void model_fill(double boil_temp, double water_kg);
+
+/**
+ * @brief one model step with the relay as the kettle set it, the reading has 0.1 degree of noise
+ * @param[in] ms: step
+ * @return none
+ */
+void model_step(uint32_t ms);
+
+#endif /* __KETTLE_MODEL_H__ */
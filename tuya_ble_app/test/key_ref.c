@@ -0,0 +1,12 @@
+/**
+ * @file key_ref.c
+ * @brief the key driver as it was before its state moved to static storage (ref/), renamed ref_*,
+ *        the reference of the heap check in test_key; the header comes first, its init is const now
+ */
+
+#include "tuya_app_driver_key.h"
+
+#define ts02n_key_init                          ref_ts02n_key_init
+#define ts02n_key_wake_check                    ref_ts02n_key_wake_check
+
+#include "ref/tuya_app_driver_key.c"
@@ -0,0 +1,14 @@
+/**
+ * @file key_ref.h
+ * @brief the key driver before its state moved to static storage, see key_ref.c
+ */
+
+#ifndef __KEY_REF_H__
+#define __KEY_REF_H__
+
+#include "tuya_app_driver_key.h"
+
+uint8_t ref_ts02n_key_init(TS02N_KEY_DEF_T *key_def);
+void ref_ts02n_key_wake_check(void);
+
+#endif /* __KEY_REF_H__ */
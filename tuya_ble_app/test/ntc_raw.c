@@ -0,0 +1,15 @@
+/**
+ * @file ntc_raw.c
+ * @brief the NTC driver built again with one sample and no IIR, the unfiltered reference of test_ntc
+ */
+
+#define NTC_SAMPLE_NUM          1
+#define NTC_IIR_SHIFT           0
+#define ntc_adc_init            raw_ntc_adc_init
+#define ntc_adc_session_reset   raw_ntc_adc_session_reset
+#define get_cur_temp            raw_get_cur_temp
+#define get_cur_temp_x10        raw_get_cur_temp_x10
+#define vol_data_of_temp        raw_vol_data_of_temp
+#define temp_data_of_vol        raw_temp_data_of_vol
+
+#include "../src/driver/tuya_app_driver_ntc.c"
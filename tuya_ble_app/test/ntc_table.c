@@ -0,0 +1,87 @@
+/**
+ * @file ntc_table.c
+ * @brief the NTC tables worked out from the part, see ntc_table.h
+ */
+
+#include <math.h>
+#include "ntc_table.h"
+
+#define KELVIN              273.15
+
+/**
+ * @brief NTC resistance of a temperature with a B value from 25 degree
+ */
+static double get_b_kohm(double b, double temp)
+{
+    return NTC_R25_KOHM * exp(b * (1.0 / (temp + KELVIN) - 1.0 / (25.0 + KELVIN)));
+}
+
+/**
+ * @brief determinant of a 3x3 matrix
+ */
+static double get_det(const double m[3][3])
+{
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+           m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+           m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+/**
+ * @brief Steinhart-Hart coefficients, 1/T = a + b*ln(R) + c*ln(R)^3, through 25, 50 and 100 degree
+ */
+static void get_coef(double coef[3])
+{
+    const double temp[3] = {25.0, 50.0, 100.0};
+    const double kohm[3] = {NTC_R25_KOHM, get_b_kohm(NTC_B25_50, 50.0), get_b_kohm(NTC_B25_100, 100.0)};
+    double m[3][3], col[3][3], det, x;
+    uint8_t i, j;
+
+    for (i = 0; i < 3; i++) {
+        x = log(kohm[i]);
+        m[i][0] = 1.0;
+        m[i][1] = x;
+        m[i][2] = x * x * x;
+    }
+    det = get_det(m);
+    /* Cramer's rule */
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < 3; i++) {
+            col[i][0] = m[i][0];
+            col[i][1] = m[i][1];
+            col[i][2] = m[i][2];
+            col[i][j] = 1.0 / (temp[i] + KELVIN);
+        }
+        coef[j] = get_det(col) / det;
+    }
+}
+
+double ntc_table_get_mv(double temp)
+{
+    double coef[3], x, f;
+    uint8_t i;
+
+    get_coef(coef);
+    /* ln(R) by Newton from R25, the curve is smooth and monotonic */
+    x = log(NTC_R25_KOHM);
+    for (i = 0; i < 20; i++) {
+        f = coef[0] + coef[1] * x + coef[2] * x * x * x - 1.0 / (temp + KELVIN);
+        x -= f / (coef[1] + 3.0 * coef[2] * x * x);
+    }
+    return NTC_VREF_MV * NTC_PULL_DOWN_KOHM / (exp(x) + NTC_PULL_DOWN_KOHM);
+}
+
+uint16_t ntc_table_make_temp_of_vol(const uint16_t *vol_of_temp, uint8_t *temp_of_vol)
+{
+    uint16_t num = ((vol_of_temp[NTC_TABLE_TEMP_NUM - 1] - vol_of_temp[0]) >> NTC_TABLE_STEP_SHIFT) + 1;
+    uint16_t i, vol;
+    uint8_t temp = 0;
+
+    for (i = 0; (i < num) && (i < NTC_TABLE_VOL_MAX); i++) {
+        vol = vol_of_temp[0] + (i << NTC_TABLE_STEP_SHIFT);
+        while ((temp < NTC_TABLE_TEMP_NUM - 1) && (vol * 2 >= vol_of_temp[temp] + vol_of_temp[temp + 1])) {
+            temp++;
+        }
+        temp_of_vol[i] = temp;
+    }
+    return i;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file ntc_table.h
+ * @brief the NTC tables of tuya_app_driver_ntc.c worked out from the part: the divider voltage of
+ *        each temperature, and the 8mV direct-index table from the voltage table
+ */
+
+#ifndef __NTC_TABLE_H__
+#define __NTC_TABLE_H__
+
+#include <stdint.h>
+
+/* NTC(B3950/100K) from 3.3V to the ADC pin, 20K to ground: the divider vol_data_of_temp fits */
+#define NTC_R25_KOHM        100.0
+#define NTC_B25_50          3950.0
+#define NTC_B25_100         4028.0      /* not on the label, read back from vol_data_of_temp */
+#define NTC_PULL_DOWN_KOHM  20.0
+#define NTC_VREF_MV         3300.0
+#define NTC_TABLE_ERR_MV    3           /* vol_data_of_temp is the vendor R-T table, this far off the curve */
+
+#define NTC_TABLE_TEMP_NUM  120         /* 0 ~ 119 degree */
+#define NTC_TABLE_STEP_SHIFT 3          /* 8mV per step */
+#define NTC_TABLE_VOL_MAX   512         /* steps at most */
+
+/**
+ * @brief divider voltage of a temperature, Steinhart-Hart through 25, 50 and 100 degree
+ * @param[in] temp: degree
+ * @return mV
+ */
+double ntc_table_get_mv(double temp);
+
+/**
+ * @brief the direct-index table: the nearest temperature at the first voltage of each 8mV step
+ *        from vol_of_temp[0] to vol_of_temp[NTC_TABLE_TEMP_NUM-1], a midpoint goes to the next one
+ * @param[in] vol_of_temp: mV of each degree
+ * @param[out] temp_of_vol: temperature of each step
+ * @return steps
+ */
+uint16_t ntc_table_make_temp_of_vol(const uint16_t *vol_of_temp, uint8_t *temp_of_vol);
+
+#endif /* __NTC_TABLE_H__ */
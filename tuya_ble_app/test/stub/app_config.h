@@ -0,0 +1,2 @@
+/* host stand-in for the SDK header of the same name */
+#include "tuya_sdk_stub.h"
@@ -0,0 +1,109 @@
+/**
+ * @file driver_stub.c
+ * @brief host fake of the app drivers, see driver_stub.h
+ */
+
+#include "driver_stub.h"
+
+uint16_t stub_temp_x10 = 250;
+uint32_t stub_temp_read_cnt = 0;
+bool stub_relay = OFF;
+uint32_t stub_relay_set_cnt = 0;
+uint32_t stub_relay_toggle_cnt = 0;
+bool stub_led[LED_NUM];
+const LED_PATTERN_T *stub_led_pattern[LED_NUM];
+uint32_t stub_led_set_cnt = 0;
+BUZZER_MODE_E stub_buzzer_mode = BUZZER_MODE_STOP;
+
+const LED_PATTERN_T g_led_pattern_twinkle = {
+    .type = LED_PATTERN_BLINK,
+    .on_time = 200,
+    .off_time = 200,
+};
+
+void stub_driver_reset(void)
+{
+    stub_temp_x10 = 250;
+    stub_temp_read_cnt = 0;
+    stub_relay = OFF;
+    stub_relay_set_cnt = 0;
+    stub_relay_toggle_cnt = 0;
+    memset(stub_led, 0, sizeof(stub_led));
+    memset(stub_led_pattern, 0, sizeof(stub_led_pattern));
+    stub_led_set_cnt = 0;
+    stub_buzzer_mode = BUZZER_MODE_STOP;
+}
+
+/* led */
+void led_init(void) {}
+
+void set_led(LED_ID_E id, bool b_on_off)
+{
+    stub_led_set_cnt++;
+    stub_led[id] = b_on_off;
+}
+
+void set_led_pattern(LED_ID_E id, const LED_PATTERN_T *pattern)
+{
+    stub_led_set_cnt++;
+    stub_led_pattern[id] = pattern;
+}
+
+bool get_led_pwm(void)
+{
+    return OFF;
+}
+
+/* relay */
+void relay_init(void) {}
+
+void set_relay(bool b_on_off)
+{
+    stub_relay_set_cnt++;
+    if (stub_relay != b_on_off) {
+        stub_relay_toggle_cnt++;
+    }
+    stub_relay = b_on_off;
+}
+
+bool get_relay(void)
+{
+    return stub_relay;
+}
+
+/* buzzer */
+void buzzer_pwm_init(void) {}
+
+void set_buzzer_mode(BUZZER_MODE_E mode)
+{
+    stub_buzzer_mode = mode;
+}
+
+bool get_buzzer(void)
+{
+    return OFF;
+}
+
+/* ntc */
+void ntc_adc_init(void) {}
+void ntc_adc_session_reset(void) {}
+
+uint8_t get_cur_temp(void)
+{
+    return (uint8_t)((stub_temp_x10 + 5) / 10);
+}
+
+uint16_t get_cur_temp_x10(void)
+{
+    stub_temp_read_cnt++;
+    return stub_temp_x10;
+}
+
+/* key: the tests call the key callbacks */
+uint8_t ts02n_key_init(const TS02N_KEY_DEF_T *user_key_def)
+{
+    return KEY_INIT_OK;
+}
+
+void ts02n_key_wake_up(void) {}
+void ts02n_key_wake_check(void) {}
@@ -0,0 +1,32 @@
+/**
+ * @file driver_stub.h
+ * @brief host fake of the app drivers, for the tests of tuya_app_smart_kettle.c
+ */
+
+#ifndef __DRIVER_STUB_H__
+#define __DRIVER_STUB_H__
+
+#include "tuya_app_driver_led.h"
+#include "tuya_app_driver_key.h"
+#include "tuya_app_driver_ntc.h"
+#include "tuya_app_driver_relay.h"
+#include "tuya_app_driver_buzzer.h"
+
+extern uint16_t stub_temp_x10;              /* returned by get_cur_temp_x10() */
+extern uint32_t stub_temp_read_cnt;         /* get_cur_temp_x10() calls */
+extern bool stub_relay;
+extern uint32_t stub_relay_set_cnt;         /* set_relay() calls */
+extern uint32_t stub_relay_toggle_cnt;      /* set_relay() calls that changed the relay */
+extern bool stub_led[LED_NUM];
+extern const LED_PATTERN_T *stub_led_pattern[LED_NUM];
+extern uint32_t stub_led_set_cnt;           /* set_led() and set_led_pattern() calls */
+extern BUZZER_MODE_E stub_buzzer_mode;
+
+/**
+ * @brief reset the fake driver state
+ * @param[in] none
+ * @return none
+ */
+void stub_driver_reset(void);
+
+#endif /* __DRIVER_STUB_H__ */
@@ -0,0 +1,405 @@
+/**
+ * @file tuya_sdk_stub.c
+ * @brief host fake of the Tuya BLE SDK and Telink drivers, see tuya_sdk_stub.h
+ */
+
+#include <stdlib.h>
+#include "tuya_sdk_stub.h"
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+uint32_t stub_tick = 0;
+volatile uint8_t stub_regs[0x100];
+uint32_t stub_gpio_read_cnt = 0;
+uint32_t stub_gpio_out_access_cnt[STUB_GPIO_PORT_NUM];
+uint32_t (*stub_adc_sample)(void) = NULL;
+uint32_t stub_adc_init_cnt = 0;
+uint16_t stub_pwm_cycle[PWM_NUM];
+uint16_t stub_pwm_cmp[PWM_NUM];
+uint8_t stub_pwm_on[PWM_NUM];
+tuya_ble_connect_status_t stub_ble_status = BONDING_CONN;
+tuya_ble_status_t stub_dp_report_ret = TUYA_BLE_SUCCESS;
+uint32_t stub_dp_report_cnt = 0;
+uint16_t stub_dp_report_sn = 0;
+uint8_t stub_dp_report_buf[256];
+uint32_t stub_dp_report_len = 0;
+uint8_t stub_nv[0x1000];
+uint32_t stub_nv_write_cnt = 0;
+uint32_t stub_heap_used = 0;
+uint32_t stub_heap_max = 0;
+uint8_t stub_ll_state = BLS_LINK_STATE_CONN;
+uint8_t stub_suspend_mask = SUSPEND_DISABLE;
+uint32_t stub_app_wakeup_tick = 0;
+uint32_t stub_suspend_cnt = 0;
+uint32_t (*stub_wakeup)(uint32_t wakeup_tick) = NULL;
+void (*stub_uart_send)(u8 *p_data, u16 len) = NULL;
+void (*stub_uart_factory)(u8 *p_data, u16 len) = NULL;
+
+u8 ty_ble_state = 0;
+u8 uart_to_ble_enable = 1;
+u8 ty_factory_flag = 1;
+
+static blt_event_callback_t sg_suspend_exit_cb = NULL;
+static blt_event_callback_t sg_gpio_wakeup_cb = NULL;
+/* pad wake-up sources */
+static uint32_t sg_pad_pin[8];
+static uint8_t sg_pad_level[8];
+static uint8_t sg_pad_num = 0;
+
+/***********************************************************
+***********************test control*************************
+***********************************************************/
+void stub_reset(void)
+{
+    stub_tick = 0;
+    memset((void *)stub_regs, 0xFF, sizeof(stub_regs));
+    stub_gpio_read_cnt = 0;
+    memset(stub_gpio_out_access_cnt, 0, sizeof(stub_gpio_out_access_cnt));
+    stub_adc_sample = NULL;
+    stub_adc_init_cnt = 0;
+    memset(stub_pwm_cycle, 0, sizeof(stub_pwm_cycle));
+    memset(stub_pwm_cmp, 0, sizeof(stub_pwm_cmp));
+    memset(stub_pwm_on, 0, sizeof(stub_pwm_on));
+    stub_ble_status = BONDING_CONN;
+    stub_dp_report_ret = TUYA_BLE_SUCCESS;
+    stub_dp_report_cnt = 0;
+    stub_dp_report_sn = 0;
+    stub_dp_report_len = 0;
+    memset(stub_nv, 0xFF, sizeof(stub_nv));
+    stub_nv_write_cnt = 0;
+    stub_heap_used = 0;
+    stub_heap_max = 0;
+    stub_ll_state = BLS_LINK_STATE_CONN;
+    stub_suspend_mask = SUSPEND_DISABLE;
+    stub_app_wakeup_tick = 0;
+    stub_suspend_cnt = 0;
+    stub_wakeup = NULL;
+    sg_suspend_exit_cb = NULL;
+    sg_gpio_wakeup_cb = NULL;
+    sg_pad_num = 0;
+    stub_uart_send = NULL;
+    stub_uart_factory = NULL;
+    ty_ble_state = 0;
+    uart_to_ble_enable = 1;
+    ty_factory_flag = 1;
+}
+
+void stub_delay_ms(uint32_t ms)
+{
+    stub_tick += ms * CLOCK_16M_SYS_TIMER_CLK_1MS;
+}
+
+/**
+ * @brief an armed pad at its wake-up level, read without counting a gpio read
+ * @param[in] none
+ * @return 0-none 1-active
+ */
+static uint8_t stub_pad_active(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < sg_pad_num; i++) {
+        if (((reg_gpio_in(sg_pad_pin[i]) & (uint8_t)sg_pad_pin[i]) != 0) == sg_pad_level[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief sleep to the wake-up tick, or to the earlier one stub_wakeup picks
+ * @param[in] wakeup_tick: timer wake-up
+ * @return wake-up status, as cpu_sleep_wakeup()
+ */
+static int stub_sleep(uint32_t wakeup_tick)
+{
+    if (stub_pad_active()) {
+        return STATUS_GPIO_ERR_NO_ENTER_PM;
+    }
+    if (stub_wakeup != NULL) {
+        wakeup_tick = stub_wakeup(wakeup_tick);
+    }
+    if ((int32_t)(wakeup_tick - stub_tick) > 0) {
+        stub_tick = wakeup_tick;
+    }
+    stub_suspend_cnt++;
+    return stub_pad_active() ? WAKEUP_STATUS_PAD : WAKEUP_STATUS_TIMER;
+}
+
+uint8_t stub_stack_suspend(void)
+{
+    int status;
+
+    if (stub_suspend_mask == SUSPEND_DISABLE) {
+        return 0;
+    }
+    status = stub_sleep(stub_app_wakeup_tick);
+    if ((status & (WAKEUP_STATUS_PAD | STATUS_GPIO_ERR_NO_ENTER_PM)) && (sg_gpio_wakeup_cb != NULL)) {
+        sg_gpio_wakeup_cb(BLT_EV_FLAG_GPIO_EARLY_WAKEUP, NULL, 0);
+    }
+    if (status & STATUS_GPIO_ERR_NO_ENTER_PM) {
+        return 0;
+    }
+    if (sg_suspend_exit_cb != NULL) {
+        sg_suspend_exit_cb(BLT_EV_FLAG_SUSPEND_EXIT, NULL, 0);
+    }
+    return 1;
+}
+
+void stub_set_gpio_in(uint32_t pin, int value)
+{
+    if (value) {
+        reg_gpio_in(pin) |= (uint8_t)pin;
+    } else {
+        reg_gpio_in(pin) &= (uint8_t)~pin;
+    }
+}
+
+/***********************************************************
+***********************telink driver************************
+***********************************************************/
+uint32_t clock_time(void)
+{
+    return stub_tick;
+}
+
+uint32_t clock_time_exceed(uint32_t ref, uint32_t span_us)
+{
+    return ((uint32_t)(stub_tick - ref) > span_us * CLOCK_16M_SYS_TIMER_CLK_1US);
+}
+
+void gpio_set_func(uint32_t pin, int func) {}
+void gpio_set_input_en(uint32_t pin, int en) {}
+void gpio_set_output_en(uint32_t pin, int en) {}
+void gpio_setup_up_down_resistor(uint32_t pin, int res) {}
+
+volatile uint8_t *stub_gpio_out_reg(uint32_t pin)
+{
+    stub_gpio_out_access_cnt[(pin >> 8) % STUB_GPIO_PORT_NUM]++;
+    return &stub_regs[0x10 + (pin >> 8)];
+}
+
+int gpio_read(uint32_t pin)
+{
+    stub_gpio_read_cnt++;
+    return ((reg_gpio_in(pin) & (uint8_t)pin) != 0);
+}
+
+void gpio_write(uint32_t pin, int value)
+{
+    if (value) {
+        reg_gpio_out(pin) |= (uint8_t)pin;
+    } else {
+        reg_gpio_out(pin) &= (uint8_t)~pin;
+    }
+}
+
+void adc_init(void)
+{
+    stub_adc_init_cnt++;
+}
+void adc_base_init(uint32_t pin) {}
+void adc_power_on_sar_adc(int on) {}
+
+uint32_t adc_sample_and_get_result(void)
+{
+    return (stub_adc_sample != NULL) ? stub_adc_sample() : 1000;
+}
+
+void pwm_set_clk(int sys_clk, int pwm_clk) {}
+void pwm_set_mode(int id, int mode) {}
+void pwm_set_cycle(int id, uint16_t cycle)
+{
+    stub_pwm_cycle[id] = cycle;
+}
+
+void pwm_set_cycle_and_duty(int id, uint16_t cycle, uint16_t duty)
+{
+    stub_pwm_cycle[id] = cycle;
+    stub_pwm_cmp[id] = duty;
+}
+
+void pwm_set_cmp(int id, uint16_t cmp)
+{
+    stub_pwm_cmp[id] = cmp;
+}
+
+void pwm_start(int id)
+{
+    stub_pwm_on[id] = 1;
+}
+
+void pwm_stop(int id)
+{
+    stub_pwm_on[id] = 0;
+}
+
+void cpu_set_gpio_wakeup(uint32_t pin, int level, int en)
+{
+    uint8_t i;
+
+    for (i = 0; (i < sg_pad_num) && (sg_pad_pin[i] != pin); i++) {
+    }
+    if (!en) {
+        if (i < sg_pad_num) {
+            sg_pad_num--;
+            sg_pad_pin[i] = sg_pad_pin[sg_pad_num];
+            sg_pad_level[i] = sg_pad_level[sg_pad_num];
+        }
+        return;
+    }
+    if (i == sg_pad_num) {
+        if (sg_pad_num == sizeof(sg_pad_pin) / sizeof(sg_pad_pin[0])) {
+            return;
+        }
+        sg_pad_num++;
+    }
+    sg_pad_pin[i] = pin;
+    sg_pad_level[i] = (uint8_t)level;
+}
+
+void bls_ll_setAdvEnable(int en) {}
+
+int cpu_sleep_wakeup(int sleep_mode, int wakeup_src, uint32_t wakeup_tick)
+{
+    return stub_sleep(wakeup_tick);
+}
+
+void blc_ll_initPowerManagement_module(void) {}
+
+uint8_t blc_ll_getCurrentState(void)
+{
+    return stub_ll_state;
+}
+
+void bls_app_registerEventCallback(u8 e, blt_event_callback_t p)
+{
+    if (e == BLT_EV_FLAG_SUSPEND_EXIT) {
+        sg_suspend_exit_cb = p;
+    } else if (e == BLT_EV_FLAG_GPIO_EARLY_WAKEUP) {
+        sg_gpio_wakeup_cb = p;
+    }
+}
+
+void bls_pm_setSuspendMask(u8 mask)
+{
+    stub_suspend_mask = mask;
+}
+
+void bls_pm_setWakeupSource(u8 source) {}
+
+void bls_pm_setAppWakeupLowPower(u32 wakeup_tick, u8 enable)
+{
+    stub_app_wakeup_tick = wakeup_tick;
+}
+
+/***********************************************************
+***********************tuya ble sdk*************************
+***********************************************************/
+tuya_ble_connect_status_t tuya_ble_connect_status_get(void)
+{
+    return stub_ble_status;
+}
+
+tuya_ble_status_t tuya_ble_dp_data_report(uint8_t *p_data, uint32_t len)
+{
+    if (stub_dp_report_ret == TUYA_BLE_SUCCESS) {
+        stub_dp_report_cnt++;
+        memcpy(stub_dp_report_buf, p_data, len);
+        stub_dp_report_len = len;
+    }
+    return stub_dp_report_ret;
+}
+
+tuya_ble_status_t tuya_ble_dp_data_with_flag_report(uint16_t sn, tuya_ble_report_mode_t mode, uint8_t *p_data, uint32_t len)
+{
+    if (stub_dp_report_ret == TUYA_BLE_SUCCESS) {
+        stub_dp_report_sn = sn;
+    }
+    return tuya_ble_dp_data_report(p_data, len);
+}
+
+tuya_ble_status_t tuya_ble_nv_read(uint32_t addr, uint8_t *p_data, uint32_t size)
+{
+    memcpy(p_data, &stub_nv[addr - APP_NV_START_ADDR], size);
+    return TUYA_BLE_SUCCESS;
+}
+
+tuya_ble_status_t tuya_ble_nv_write(uint32_t addr, const uint8_t *p_data, uint32_t size)
+{
+    stub_nv_write_cnt++;
+    memcpy(&stub_nv[addr - APP_NV_START_ADDR], p_data, size);
+    return TUYA_BLE_SUCCESS;
+}
+
+tuya_ble_status_t tuya_ble_nv_erase(uint32_t addr, uint32_t size)
+{
+    memset(&stub_nv[addr - APP_NV_START_ADDR], 0xFF, size);
+    return TUYA_BLE_SUCCESS;
+}
+
+/* each block keeps its size in front of it */
+typedef union {
+    uint32_t size;
+    long double align;
+} STUB_HEAP_HEAD_T;
+
+void *tuya_ble_malloc(uint16_t size)
+{
+    STUB_HEAP_HEAD_T *head = malloc(sizeof(STUB_HEAP_HEAD_T) + size);
+
+    if (head == NULL) {
+        return NULL;
+    }
+    head->size = size;
+    stub_heap_used += size;
+    if (stub_heap_used > stub_heap_max) {
+        stub_heap_max = stub_heap_used;
+    }
+    return head + 1;
+}
+
+tuya_ble_status_t tuya_ble_free(void *buf)
+{
+    STUB_HEAP_HEAD_T *head = (STUB_HEAP_HEAD_T *)buf - 1;
+
+    if (buf == NULL) {
+        return TUYA_BLE_ERR_INVALID_PARAM;
+    }
+    stub_heap_used -= head->size;
+    free(head);
+    return TUYA_BLE_SUCCESS;
+}
+
+uint8_t check_sum(uint8_t *p_data, uint32_t len)
+{
+    uint8_t sum = 0;
+
+    while (len--) {
+        sum += *p_data++;
+    }
+    return sum;
+}
+
+int tuya_get_ota_status(void)
+{
+    return TUYA_OTA_STATUS_NONE;
+}
+
+void tuya_uart_factory_test(u8 *p_data, u16 len)
+{
+    if (stub_uart_factory != NULL) {
+        stub_uart_factory(p_data, len);
+    }
+}
+
+void tuya_bsp_uart_send_bytes(u8 *p_data, u16 len)
+{
+    if (stub_uart_send != NULL) {
+        stub_uart_send(p_data, len);
+    }
+}
+
+void tuya_timer_start(int id, int ms) {}
+void tuya_timer_delete(int id) {}
@@ -0,0 +1,268 @@
+/**
+ * @file tuya_sdk_stub.h
+ * @brief host stand-in for the Tuya BLE SDK and Telink driver headers
+ *
+ * Only what the app sources use. The SDK header names (tuya_ble_type.h,
+ * gpio_8258.h, ...) in this directory all include this file.
+ * The fake implementation and its stub_* test controls are in tuya_sdk_stub.c.
+ */
+
+#ifndef __TUYA_SDK_STUB_H__
+#define __TUYA_SDK_STUB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/***********************************************************
+***********************tuya ble sdk*************************
+***********************************************************/
+typedef uint8_t     u8;
+typedef uint16_t    u16;
+typedef uint32_t    u32;
+typedef int16_t     s16;
+typedef int32_t     s32;
+
+/* names, order and values as in the SDK's tuya_ble_type.h */
+typedef enum {
+    TUYA_BLE_SUCCESS = 0x00,
+    TUYA_BLE_ERR_INTERNAL,
+    TUYA_BLE_ERR_NOT_FOUND,
+    TUYA_BLE_ERR_NO_EVENT,
+    TUYA_BLE_ERR_NO_MEM,
+    TUYA_BLE_ERR_INVALID_ADDR,
+    TUYA_BLE_ERR_INVALID_PARAM,
+    TUYA_BLE_ERR_INVALID_STATE,
+    TUYA_BLE_ERR_INVALID_LENGTH,
+    TUYA_BLE_ERR_DATA_SIZE,
+    TUYA_BLE_ERR_TIMEOUT,
+    TUYA_BLE_ERR_BUSY,
+    TUYA_BLE_ERR_COMMON,
+    TUYA_BLE_ERR_RESOURCES,
+    TUYA_BLE_ERR_UNKNOWN,
+} tuya_ble_status_t;
+
+#define DT_RAW                          0
+#define DT_BOOL                         1
+#define DT_VALUE                        2
+#define DT_STRING                       3
+#define DT_ENUM                         4
+#define DT_BITMAP                       5
+typedef uint8_t dp_type;
+
+typedef enum {
+    UNBONDING_UNCONN = 0,
+    UNBONDING_CONN,
+    BONDING_UNCONN,
+    BONDING_CONN,
+    BONDING_UNAUTH_CONN,
+    UNBONDING_UNAUTH_CONN,
+    UNKNOW_STATUS,
+} tuya_ble_connect_status_t;
+
+typedef enum {
+    REPORT_FOR_CLOUD_PANEL = 0,
+    REPORT_FOR_CLOUD,
+    REPORT_FOR_PANEL,
+    REPORT_FOR_NONE,
+} tuya_ble_report_mode_t;
+
+tuya_ble_connect_status_t tuya_ble_connect_status_get(void);
+tuya_ble_status_t tuya_ble_dp_data_report(uint8_t *p_data, uint32_t len);
+tuya_ble_status_t tuya_ble_dp_data_with_flag_report(uint16_t sn, tuya_ble_report_mode_t mode, uint8_t *p_data, uint32_t len);
+tuya_ble_status_t tuya_ble_nv_read(uint32_t addr, uint8_t *p_data, uint32_t size);
+tuya_ble_status_t tuya_ble_nv_write(uint32_t addr, const uint8_t *p_data, uint32_t size);
+tuya_ble_status_t tuya_ble_nv_erase(uint32_t addr, uint32_t size);
+uint8_t check_sum(uint8_t *p_data, uint32_t len);
+void *tuya_ble_malloc(uint16_t size);
+tuya_ble_status_t tuya_ble_free(void *buf);
+
+/* log: compiled out */
+#define TUYA_APP_LOG_DEBUG(...)         do {} while (0)
+#define TUYA_APP_LOG_INFO(...)          do {} while (0)
+#define TUYA_APP_LOG_WARNING(...)       do {} while (0)
+#define TUYA_APP_LOG_ERROR(...)         do {} while (0)
+#define TUYA_APP_LOG_HEXDUMP_DEBUG(...) do {} while (0)
+#define tuya_log_d(...)                 do {} while (0)
+#define tuya_log_dumpHex(...)           do {} while (0)
+
+/* uart common protocol */
+#define TY_REPORT_BT_STATE              0x03
+#define TY_SEND_CMD_TYPE                0x06
+#define TY_SEND_STATUS_TYPE             0x07
+#define TUYA_OTA_STATUS_NONE            0
+#define TIMER_UART_RX_TIMEOUT           3
+extern u8 ty_ble_state;
+extern u8 uart_to_ble_enable;
+extern u8 ty_factory_flag;
+int tuya_get_ota_status(void);
+void tuya_uart_factory_test(u8 *p_data, u16 len);
+void tuya_bsp_uart_send_bytes(u8 *p_data, u16 len);
+void tuya_timer_start(int id, int ms);
+void tuya_timer_delete(int id);
+
+/***********************************************************
+***********************telink driver************************
+***********************************************************/
+/* clock: the system timer runs at 16MHz */
+#define CLOCK_SYS_CLOCK_HZ              16000000
+#define CLOCK_SYS_CLOCK_1US             16
+#define CLOCK_16M_SYS_TIMER_CLK_1US     16
+#define CLOCK_16M_SYS_TIMER_CLK_1MS     16000
+uint32_t clock_time(void);
+uint32_t clock_time_exceed(uint32_t ref, uint32_t span_us);
+
+/* gpio: port in the high byte, pin bit in the low byte */
+enum {
+    GPIO_PB4 = 0x110,
+    GPIO_PB5 = 0x120,
+    GPIO_PB6 = 0x140,
+    GPIO_PC2 = 0x204,
+    GPIO_PC3 = 0x208,
+    GPIO_PD2 = 0x304,
+    GPIO_PD3 = 0x308,
+    GPIO_PD4 = 0x310,
+};
+#define AS_GPIO                         0
+#define AS_PWM2_N                       1
+#define AS_PWM3                         2
+#define AS_PWM4                         3
+#define AS_PWM5                         4
+#define PM_PIN_PULLUP_10K               1
+#define Level_Low                       0
+#define Level_High                      1
+extern volatile uint8_t stub_regs[0x100];
+#define reg_gpio_in(pin)                (stub_regs[0x00 + ((pin) >> 8)])
+#define reg_gpio_out(pin)               (*stub_gpio_out_reg(pin))
+volatile uint8_t *stub_gpio_out_reg(uint32_t pin);
+void gpio_set_func(uint32_t pin, int func);
+void gpio_set_input_en(uint32_t pin, int en);
+void gpio_set_output_en(uint32_t pin, int en);
+void gpio_setup_up_down_resistor(uint32_t pin, int res);
+int gpio_read(uint32_t pin);
+void gpio_write(uint32_t pin, int value);
+
+/* adc */
+void adc_init(void);
+void adc_base_init(uint32_t pin);
+void adc_power_on_sar_adc(int on);
+uint32_t adc_sample_and_get_result(void);
+
+/* pwm */
+enum {
+    PWM0_ID,
+    PWM1_ID,
+    PWM2_ID,
+    PWM3_ID,
+    PWM4_ID,
+    PWM5_ID,
+    PWM_NUM,
+};
+#define PWM_NORMAL_MODE                 0
+void pwm_set_clk(int sys_clk, int pwm_clk);
+void pwm_set_mode(int id, int mode);
+void pwm_set_cycle_and_duty(int id, uint16_t cycle, uint16_t duty);
+void pwm_set_cycle(int id, uint16_t cycle);
+void pwm_set_cmp(int id, uint16_t cmp);
+void pwm_start(int id);
+void pwm_stop(int id);
+
+/* power management */
+#define SUSPEND_DISABLE                 0
+#define SUSPEND_ADV                     1
+#define SUSPEND_CONN                    2
+#define SUSPEND_MODE                    0
+#define PM_WAKEUP_PAD                   0x10
+#define PM_WAKEUP_TIMER                 0x20
+#define WAKEUP_STATUS_TIMER             0x02
+#define WAKEUP_STATUS_PAD               0x08
+#define STATUS_GPIO_ERR_NO_ENTER_PM     0x80
+#define BLS_LINK_STATE_IDLE             0
+#define BLS_LINK_STATE_ADV              1
+#define BLS_LINK_STATE_CONN             8
+#define BLT_EV_FLAG_GPIO_EARLY_WAKEUP   9
+#define BLT_EV_FLAG_SUSPEND_EXIT        11
+typedef void (*blt_event_callback_t)(u8 e, u8 *p, int n);
+void cpu_set_gpio_wakeup(uint32_t pin, int level, int en);
+int cpu_sleep_wakeup(int sleep_mode, int wakeup_src, uint32_t wakeup_tick);
+void bls_ll_setAdvEnable(int en);
+void blc_ll_initPowerManagement_module(void);
+uint8_t blc_ll_getCurrentState(void);
+void bls_app_registerEventCallback(u8 e, blt_event_callback_t p);
+void bls_pm_setSuspendMask(u8 mask);
+void bls_pm_setWakeupSource(u8 source);
+void bls_pm_setAppWakeupLowPower(u32 wakeup_tick, u8 enable);
+
+/***********************************************************
+***********************test control*************************
+***********************************************************/
+/* time */
+extern uint32_t stub_tick;
+void stub_delay_ms(uint32_t ms);
+
+/* gpio in, per pin, 1 after stub_reset() */
+void stub_set_gpio_in(uint32_t pin, int value);
+extern uint32_t stub_gpio_read_cnt;
+
+/* gpio out, per port: accesses of the out register, a read-modify-write is 2 */
+#define STUB_GPIO_PORT_NUM              4
+extern uint32_t stub_gpio_out_access_cnt[STUB_GPIO_PORT_NUM];
+
+/* adc, returns 1000mV if not set */
+extern uint32_t (*stub_adc_sample)(void);
+extern uint32_t stub_adc_init_cnt;
+
+/* pwm */
+extern uint16_t stub_pwm_cycle[PWM_NUM];
+extern uint16_t stub_pwm_cmp[PWM_NUM];
+extern uint8_t stub_pwm_on[PWM_NUM];
+
+/* ble */
+extern tuya_ble_connect_status_t stub_ble_status;
+extern tuya_ble_status_t stub_dp_report_ret;    /* returned by the dp report calls */
+extern uint32_t stub_dp_report_cnt;
+extern uint16_t stub_dp_report_sn;
+extern uint8_t stub_dp_report_buf[256];     /* dp data of the last report */
+extern uint32_t stub_dp_report_len;
+
+/* nv, one sector at APP_NV_START_ADDR */
+extern uint8_t stub_nv[0x1000];
+extern uint32_t stub_nv_write_cnt;
+
+/* heap, tuya_ble_malloc() */
+extern uint32_t stub_heap_used;             /* bytes allocated and not freed */
+extern uint32_t stub_heap_max;              /* high-water since stub_reset() */
+
+/* power management */
+extern uint8_t stub_ll_state;               /* blc_ll_getCurrentState(), BLS_LINK_STATE_CONN after stub_reset() */
+extern uint8_t stub_suspend_mask;           /* last bls_pm_setSuspendMask() */
+extern uint32_t stub_app_wakeup_tick;       /* last bls_pm_setAppWakeupLowPower() */
+extern uint32_t stub_suspend_cnt;           /* suspends of the stack and of cpu_sleep_wakeup() */
+extern uint32_t (*stub_wakeup)(uint32_t wakeup_tick);   /* tick a suspend ends at, NULL-wakeup_tick */
+/* a pin armed by cpu_set_gpio_wakeup() at its level keeps the chip out of suspend, or ends one
+   as a pad wake when stub_wakeup set it there */
+
+/**
+ * @brief the stack's suspend at the end of its main loop: as far as the app wake-up, if the
+ *        suspend mask allows it, then the GPIO early wake-up callback on a pad wake and the
+ *        suspend exit callback
+ * @param[in] none
+ * @return 0-no suspend 1-suspended
+ */
+uint8_t stub_stack_suspend(void);
+
+/* uart */
+extern void (*stub_uart_send)(u8 *p_data, u16 len);
+extern void (*stub_uart_factory)(u8 *p_data, u16 len);
+
+/**
+ * @brief reset all of the fake hardware and stack state
+ * @param[in] none
+ * @return none
+ */
+void stub_reset(void);
+
+/* product config of the app: flash layout */
+#include "custom_tuya_ble_config.h"
+
+#endif /* __TUYA_SDK_STUB_H__ */
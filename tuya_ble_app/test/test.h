@@ -0,0 +1,60 @@
+/**
+ * @file test.h
+ * @brief host test helpers: checks and a cycle counter for the benchmarks
+ */
+
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* failed checks of this test program */
+static int sg_test_fail = 0;
+
+#define TEST_CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        sg_test_fail++; \
+    } \
+} while (0)
+
+#define TEST_CHECK_EQ(a, b) do { \
+    long long test_a_ = (long long)(a), test_b_ = (long long)(b); \
+    if (test_a_ != test_b_) { \
+        printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, test_a_, test_b_); \
+        sg_test_fail++; \
+    } \
+} while (0)
+
+/**
+ * @brief print the result of the test program
+ * @param[in] name: test program name
+ * @return exit code, 0-all checks passed
+ */
+static inline int test_result(const char *name)
+{
+    printf("%s: %s\n", name, (sg_test_fail == 0) ? "PASS" : "FAIL");
+    return (sg_test_fail == 0) ? 0 : 1;
+}
+
+/**
+ * @brief read a cycle counter, nanoseconds where the CPU has none
+ * @param[in] none
+ * @return cycles
+ */
+static inline uint64_t test_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+#endif /* __TEST_H__ */
@@ -0,0 +1,267 @@
+/**
+ * @file test_boil.c
+ * @brief host simulation of boils at altitude and fill levels: the kettle model drives the
+ *        kettle source, built with it to see the learned boil point
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "kettle_model.h"
+#include "../src/tuya_app_smart_kettle.c"
+
+#define LOOP_MS         10          /* main loop pass, the model step */
+#define BOIL_TIME_MAX   (20 * 60 * 1000)
+#define BOIL_FIND_MAX   15000       /* ms, the reading settles on the plateau after the water */
+#define BOIL_REPEAT     6
+#define BOIL_LEARNED_MAX (TIME_BOIL_PLATEAU / 2)   /* average once learned: most boils skip the plateau */
+
+/* what a boil did */
+typedef struct {
+    uint32_t cut_ms;                /* key press to relay off */
+    uint32_t boiling_ms;            /* time the water boiled with the relay on */
+    double peak;                    /* water temperature peak, after the cut too */
+    double wh;                      /* heater energy */
+} BOIL_T;
+
+static void run_ms(uint32_t ms)
+{
+    while (ms >= LOOP_MS) {
+        model_step(LOOP_MS);
+        stub_delay_ms(LOOP_MS);
+        tuya_app_kettle_loop();
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief a fresh kettle at an altitude, the learned point and lag kept in the stub NV
+ * @param[in] boil_temp: boil point of the water
+ */
+static void start_kettle(double boil_temp)
+{
+    stub_reset();
+    stub_driver_reset();
+    memset(&g_model, 0, sizeof(g_model));
+    model_fill(boil_temp, 1.0);
+    tuya_app_kettle_init();
+    run_ms(TIME_GET_TEMP_IDLE);
+}
+
+/**
+ * @brief fill with cold water, boil and watch the overshoot
+ * @param[in] water_kg: fill level
+ * @param[out] boil: what the boil did
+ */
+static void boil_once(double water_kg, BOIL_T *boil)
+{
+    uint32_t ms;
+    double energy;
+
+    memset(boil, 0, sizeof(BOIL_T));
+    model_fill(g_model.boil_temp, water_kg);
+    run_ms(TIME_GET_TEMP_IDLE);
+    energy = g_model.energy;
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    for (ms = LOOP_MS; (ms < BOIL_TIME_MAX) && (g_kettle.mode == MODE_BOIL); ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        if (stub_relay && (g_model.water >= g_model.boil_temp)) {
+            boil->boiling_ms += LOOP_MS;
+        }
+    }
+    boil->cut_ms = ms;
+    for (ms = 0; ms < TIME_BOIL_OBSERVE; ms += LOOP_MS) {
+        if (g_model.water > boil->peak) {
+            boil->peak = g_model.water;
+        }
+        run_ms(LOOP_MS);
+    }
+    boil->wh = (g_model.energy - energy) / 3600.0;
+}
+
+/**
+ * @brief check what every boil must do: end, reach the boil point within a degree, and not boil
+ *        longer than the plateau takes to find
+ */
+static void check_boil(const BOIL_T *boil, double boil_temp)
+{
+    TEST_CHECK(boil->cut_ms < BOIL_TIME_MAX);
+    TEST_CHECK(boil->peak >= boil_temp - 1.0);
+    TEST_CHECK(boil->boiling_ms <= TIME_BOIL_PLATEAU + BOIL_FIND_MAX);
+}
+
+/**
+ * @brief a kettle taken to altitude boils on the plateau once, learns it and cuts short of it after
+ * @param[in] altitude: m, for the log
+ * @param[in] boil_temp: boil point of the water
+ */
+static void test_altitude(uint32_t altitude, double boil_temp)
+{
+    BOIL_T first, boil;
+    uint32_t nv_write, boiling_ms, i;
+
+    start_kettle(boil_temp);
+    nv_write = stub_nv_write_cnt;
+    boil_once(1.0, &first);
+    check_boil(&first, boil_temp);
+    if (boil_temp * 10 < TEMP_X10(TEMP_BOILED) - TEMP_NEAR_RANGE) {
+        /* boiled on the plateau and learned it */
+        TEST_CHECK(first.boiling_ms >= TIME_BOIL_PLATEAU);
+        TEST_CHECK(stub_nv_write_cnt > nv_write);
+        TEST_CHECK(sg_boil_point.point + TEMP_BOIL_POINT_MARGIN + TEMP_PLATEAU_BAND >= (uint16_t)(boil_temp * 10));
+        TEST_CHECK(sg_boil_point.point <= (uint16_t)(boil_temp * 10));
+    }
+    boiling_ms = 0;
+    for (i = 0; i < BOIL_REPEAT; i++) {
+        boil_once(1.0, &boil);
+        check_boil(&boil, boil_temp);
+        boiling_ms += boil.boiling_ms;
+    }
+    TEST_CHECK(boiling_ms / BOIL_REPEAT < BOIL_LEARNED_MAX);
+    printf("boil at %4u m (%.1f degree), 1l: first %.0f s with %.1f s boiling, then %.1f s boiling on average; "
+           "point %.1f, lag %u ms\n", altitude, boil_temp, first.cut_ms / 1000.0, first.boiling_ms / 1000.0,
+           boiling_ms / 1000.0 / BOIL_REPEAT, sg_boil_point.point / 10.0, sg_boil_cut.lag);
+}
+
+/**
+ * @brief fill levels heat at different rates, the learned lag follows them: the predictive cut
+ *        boils most without waiting on the plateau
+ */
+static void test_fill_level(void)
+{
+    const double fill[] = {0.3, 0.6, 1.0, 1.7};
+    BOIL_T boil;
+    uint32_t boiling_ms, i, j;
+
+    start_kettle(95.0);
+    boil_once(1.0, &boil);                  /* learn the point */
+    for (i = 0; i < sizeof(fill) / sizeof(fill[0]); i++) {
+        boiling_ms = 0;
+        for (j = 0; j < BOIL_REPEAT; j++) {
+            boil_once(fill[i], &boil);
+            check_boil(&boil, 95.0);
+            boiling_ms += boil.boiling_ms;
+        }
+        TEST_CHECK(boiling_ms / BOIL_REPEAT < BOIL_LEARNED_MAX);
+        printf("boil at 95.0 degree, %.1fl: %.0f s, %.1f s boiling on average, peak %.1f, lag %u ms\n", fill[i],
+               boil.cut_ms / 1000.0, boiling_ms / 1000.0 / BOIL_REPEAT, boil.peak, sg_boil_cut.lag);
+    }
+}
+
+/**
+ * @brief boils with the predictive cut, the lag learned, or the threshold one, the lag held at 0
+ * @param[in] point: cut point, 0-the learned one
+ * @param[in] threshold: cut when the reading reaches the point
+ * @param[out] boil: the average of the boils after the first
+ */
+static void boil_avg(double water_kg, uint16_t point, uint8_t threshold, BOIL_T *boil)
+{
+    BOIL_T one;
+    uint32_t i;
+
+    memset(boil, 0, sizeof(BOIL_T));
+    for (i = 0; i <= BOIL_REPEAT; i++) {
+        if (point != 0) {
+            sg_boil_point.point = point;
+        }
+        if (threshold) {
+            sg_boil_cut.lag = 0;
+        }
+        boil_once(water_kg, &one);
+        if (i == 0) {
+            continue;                       /* learns the lag of this fill */
+        }
+        boil->cut_ms += one.cut_ms;
+        boil->boiling_ms += one.boiling_ms;
+        boil->peak += one.peak;
+        boil->wh += one.wh;
+    }
+    boil->cut_ms /= BOIL_REPEAT;
+    boil->boiling_ms /= BOIL_REPEAT;
+    boil->peak /= BOIL_REPEAT;
+    boil->wh /= BOIL_REPEAT;
+}
+
+/**
+ * @brief the predictive cut against the threshold one: the overshoot past a cut point the water
+ *        still heats through, and the energy and steam of boils at a learned point
+ */
+static void test_predictive_cut(void)
+{
+    const double fill[] = {0.5, 1.0, 1.7};
+    BOIL_T pred, thr;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(fill) / sizeof(fill[0]); i++) {
+        start_kettle(100.0);
+        boil_avg(fill[i], TEMP_X10(90), 1, &thr);
+        start_kettle(100.0);
+        boil_avg(fill[i], TEMP_X10(90), 0, &pred);
+        printf("boil cut at 90, %.1fl: %.2f degree over, %.1f Wh predictive; %.2f degree, %.1f Wh threshold\n",
+               fill[i], pred.peak - 90, pred.wh, thr.peak - 90, thr.wh);
+        TEST_CHECK(pred.peak < thr.peak);
+        TEST_CHECK(pred.peak - 90 < 1.0);
+        TEST_CHECK(pred.wh < thr.wh);
+    }
+
+    for (i = 0; i < sizeof(fill) / sizeof(fill[0]); i++) {
+        start_kettle(95.0);
+        boil_once(1.0, &thr);                   /* learn the point */
+        boil_avg(fill[i], 0, 1, &thr);
+        start_kettle(95.0);
+        boil_once(1.0, &pred);
+        boil_avg(fill[i], 0, 0, &pred);
+        printf("boil at 95.0 degree, %.1fl: %.1f s boiling, %.1f Wh predictive; %.1f s, %.1f Wh threshold\n",
+               fill[i], pred.boiling_ms / 1000.0, pred.wh, thr.boiling_ms / 1000.0, thr.wh);
+        check_boil(&pred, 95.0);
+        TEST_CHECK(pred.boiling_ms <= thr.boiling_ms);
+        TEST_CHECK(pred.wh <= thr.wh);
+    }
+}
+
+/**
+ * @brief a plateau found in the pass a key leaves the boil is not used by the next boil
+ */
+static void test_stale_plateau(void)
+{
+    BOIL_T boil;
+    uint16_t point;
+
+    start_kettle(95.0);
+    sg_boil_point.point = TEMP_BOIL_POINT_MAX;  /* no cut before the plateau */
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    while (g_kettle.mode == MODE_BOIL) {
+        model_step(LOOP_MS);
+        stub_delay_ms(LOOP_MS);
+        /* the key lands in the pass whose sample finds the plateau */
+        if (sg_boil_point.tracking && app_timer_is_active(&sg_temp_timer) &&
+            ((int32_t)(app_timer_get_ms() - sg_temp_timer.deadline) >= 0) &&
+            clock_time_exceed(sg_boil_point.ref_tm, TIME_BOIL_PLATEAU*1000)) {
+            key_boil_short_press_cb_fun();
+        }
+        tuya_app_kettle_loop();
+    }
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+    TEST_CHECK_EQ(sg_boil_point.found, 0);
+    TEST_CHECK_EQ(sg_boil_point.point, TEMP_BOIL_POINT_MAX);
+
+    /* the next boil heats cold water instead of stopping on the old plateau */
+    point = sg_boil_point.point;
+    boil_once(1.0, &boil);
+    TEST_CHECK(boil.cut_ms > 60000);
+    TEST_CHECK(boil.boiling_ms >= TIME_BOIL_PLATEAU);
+    TEST_CHECK(sg_boil_point.point < point);
+}
+
+int main(void)
+{
+    test_altitude(0, 100.0);
+    test_altitude(1500, 95.0);
+    test_altitude(3000, 90.0);
+    test_fill_level();
+    test_predictive_cut();
+    test_stale_plateau();
+    return test_result("test_boil");
+}
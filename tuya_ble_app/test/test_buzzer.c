@@ -0,0 +1,218 @@
+/**
+ * @file test_buzzer.c
+ * @brief host test and benchmark of the buzzer sequencer: the stub PWM records the timeline of
+ *        tones, the fault alarm preempts a key click, one loop pass per note whatever the length
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_timer.h"
+#include "tuya_app_driver_buzzer.h"
+
+#define PWM_ID          PWM2_ID
+#define TONE_MAX        64
+#define LONG_NOTE_NUM   200
+
+/* a change of the buzzer output */
+typedef struct {
+    uint32_t ms;                    /* since the start */
+    uint16_t freq;                  /* Hz, 0-off */
+} TONE_T;
+
+/* what the buzzer did */
+typedef struct {
+    TONE_T tone[TONE_MAX];
+    uint32_t tone_num;
+    uint32_t passes;                /* loop passes woken by the timer deadline */
+    uint8_t half_duty;              /* every tone at 50% */
+} BUZZER_RUN_T;
+
+static BUZZER_RUN_T sg_run;
+static uint32_t sg_start_ms;
+
+static const BUZZER_NOTE_T sg_note_tune[] = {
+    {1000, 100}, {0, 50}, {2000, 100}, {4000, 200},
+};
+static const BUZZER_MELODY_T sg_tune = {sg_note_tune, 4, 2, BUZZER_PRIORITY_KEY};
+static BUZZER_NOTE_T sg_note_long[LONG_NOTE_NUM];
+static const BUZZER_MELODY_T sg_long = {sg_note_long, LONG_NOTE_NUM, 1, BUZZER_PRIORITY_KEY};
+
+/**
+ * @brief the PWM as a tone, recorded when it changed
+ */
+static void record_tone(void)
+{
+    uint16_t freq = 0;
+    TONE_T *last = (sg_run.tone_num == 0) ? NULL : &sg_run.tone[sg_run.tone_num - 1];
+
+    if (stub_pwm_on[PWM_ID]) {
+        freq = CLOCK_SYS_CLOCK_HZ / stub_pwm_cycle[PWM_ID];
+        if (stub_pwm_cmp[PWM_ID] != stub_pwm_cycle[PWM_ID] / 2) {
+            sg_run.half_duty = 0;
+        }
+    }
+    if (((last == NULL) || (last->freq != freq)) && (sg_run.tone_num < TONE_MAX)) {
+        sg_run.tone[sg_run.tone_num].ms = app_timer_get_ms() - sg_start_ms;
+        sg_run.tone[sg_run.tone_num].freq = freq;
+        sg_run.tone_num++;
+    }
+}
+
+/**
+ * @brief fresh timers and buzzer, off
+ */
+static void start_buzzer(void)
+{
+    stub_reset();
+    app_timer_init();
+    buzzer_pwm_init();
+    memset(&sg_run, 0, sizeof(sg_run));
+    sg_run.half_duty = 1;
+    sg_start_ms = app_timer_get_ms();
+}
+
+/**
+ * @brief tickless main loop: sleeps until the timer deadline, records the tones
+ */
+static void run_ms(uint32_t ms)
+{
+    uint32_t end = app_timer_get_ms() + ms;
+    uint32_t sleep, left;
+
+    sleep = app_timer_run();
+    while ((left = end - app_timer_get_ms()) != 0) {
+        if (sleep > left) {
+            stub_delay_ms(left);
+            sleep = app_timer_run();
+            continue;
+        }
+        stub_delay_ms(sleep);
+        sleep = app_timer_run();
+        sg_run.passes++;
+        record_tone();
+    }
+}
+
+/**
+ * @brief check the timeline against the tones expected
+ */
+static void check_tone(const TONE_T *tone, uint32_t tone_num)
+{
+    uint32_t i;
+
+    TEST_CHECK_EQ(sg_run.tone_num, tone_num);
+    for (i = 0; (i < sg_run.tone_num) && (i < tone_num); i++) {
+        TEST_CHECK_EQ(sg_run.tone[i].ms, tone[i].ms);
+        TEST_CHECK_EQ(sg_run.tone[i].freq, tone[i].freq);
+    }
+}
+
+/**
+ * @brief a tune with a rest played twice: each note at its frequency and 50%, on the ms, then off
+ */
+static void test_tune(void)
+{
+    const TONE_T tone[] = {
+        {0, 1000}, {100, 0}, {150, 2000}, {250, 4000},
+        {450, 1000}, {550, 0}, {600, 2000}, {700, 4000},
+        {900, 0},
+    };
+
+    start_buzzer();
+    play_buzzer_melody(&sg_tune);
+    record_tone();
+    TEST_CHECK(get_buzzer());
+    run_ms(2000);
+    check_tone(tone, sizeof(tone) / sizeof(tone[0]));
+    TEST_CHECK(sg_run.half_duty);
+    TEST_CHECK_EQ(sg_run.passes, 8);
+    TEST_CHECK(!get_buzzer());
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+}
+
+/**
+ * @brief the fault alarm cuts a key click short, a click does not cut the alarm, stop ends it
+ */
+static void test_priority(void)
+{
+    const TONE_T tone[] = {
+        {0, 2000}, {3000, 0},
+    };
+
+    start_buzzer();
+    set_buzzer_mode(BUZZER_MODE_ONCE);
+    record_tone();
+    run_ms(30);
+    set_buzzer_mode(BUZZER_MODE_FAULT);
+    run_ms(100);
+    TEST_CHECK(get_buzzer());                   /* on past the end of the click */
+    run_ms(400);
+    set_buzzer_mode(BUZZER_MODE_ONCE);
+    run_ms(2470);
+    TEST_CHECK(get_buzzer());
+    set_buzzer_mode(BUZZER_MODE_STOP);
+    record_tone();
+    check_tone(tone, sizeof(tone) / sizeof(tone[0]));
+    TEST_CHECK(!get_buzzer());
+
+    /* a click after the alarm plays again */
+    set_buzzer_mode(BUZZER_MODE_ONCE);
+    TEST_CHECK(get_buzzer());
+    run_ms(100);
+    TEST_CHECK(!get_buzzer());
+}
+
+/**
+ * @brief a long melody: one loop pass per note, as a short one
+ */
+static void test_long(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < LONG_NOTE_NUM; i++) {
+        sg_note_long[i].freq = 1000 + (i % 8) * 250;
+        sg_note_long[i].time = 10;
+    }
+    start_buzzer();
+    play_buzzer_melody(&sg_long);
+    run_ms(LONG_NOTE_NUM * 10 + 100);
+    TEST_CHECK_EQ(sg_run.passes, LONG_NOTE_NUM);
+    TEST_CHECK(!get_buzzer());
+}
+
+/**
+ * @brief cycles of a loop pass that plays a note, in a short and in a long melody of the test_long notes
+ */
+static void bench_note(void)
+{
+    const BUZZER_MELODY_T short_tune = {sg_note_long, 4, 0, BUZZER_PRIORITY_KEY};
+    const BUZZER_MELODY_T long_tune = {sg_note_long, LONG_NOTE_NUM, 0, BUZZER_PRIORITY_KEY};
+    const BUZZER_MELODY_T *melody[] = {&short_tune, &long_tune};
+    const uint32_t pass_num = 1000000;
+    uint64_t start, cycles[2];
+    uint32_t i, j;
+
+    for (j = 0; j < 2; j++) {
+        start_buzzer();
+        play_buzzer_melody(melody[j]);
+        start = test_cycles();
+        for (i = 0; i < pass_num; i++) {
+            stub_delay_ms(10);
+            app_timer_run();
+        }
+        cycles[j] = test_cycles() - start;
+    }
+    printf("buzzer, loop pass with a note: %.1f cycles in a 4 note melody, %.1f in a %d note one\n",
+           (double)cycles[0] / pass_num, (double)cycles[1] / pass_num, LONG_NOTE_NUM);
+}
+
+int main(int argc, char *argv[])
+{
+    test_tune();
+    test_priority();
+    test_long();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_note();
+    }
+    return test_result("test_buzzer");
+}
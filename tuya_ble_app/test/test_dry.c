@@ -0,0 +1,151 @@
+/**
+ * @file test_dry.c
+ * @brief host traces of boils on the kettle model with a full, a low and no fill: the rate of rise
+ *        finds a dry kettle before the 105 degree limit would, and a fill is not taken for one;
+ *        built with the kettle source to read its fault
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "kettle_model.h"
+#include "../src/tuya_app_smart_kettle.c"
+
+#define LOOP_MS         10          /* main loop pass, the model step */
+#define BOIL_TIME_MAX   (20 * 60 * 1000)
+#define DRY_SAMPLE_MAX  5           /* readings from the steep rise to the fault */
+
+/* what a boil did */
+typedef struct {
+    uint32_t fault_ms;              /* key press to the fault, 0-none */
+    uint32_t end_ms;                /* key press to the end of the boil or the fault */
+    uint32_t limit_ms;              /* relay on to a 105 degree reading, the limit alone */
+    uint32_t readings;              /* readings to the fault */
+    double element;                 /* degree, the element at the fault */
+    double reading;                 /* degree, the reading at the fault */
+} DRY_T;
+
+static void run_ms(uint32_t ms)
+{
+    while (ms >= LOOP_MS) {
+        model_step(LOOP_MS);
+        stub_delay_ms(LOOP_MS);
+        tuya_app_kettle_loop();
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief the relay held on without the kettle source: when the reading reaches the limit
+ * @return ms, 0-not within BOIL_TIME_MAX
+ */
+static uint32_t get_limit_ms(double water_kg)
+{
+    uint32_t ms;
+
+    stub_driver_reset();
+    memset(&g_model, 0, sizeof(g_model));
+    model_fill(100.0, water_kg);
+    stub_relay = ON;
+    for (ms = LOOP_MS; ms < BOIL_TIME_MAX; ms += LOOP_MS) {
+        model_step(LOOP_MS);
+        if (stub_temp_x10 >= TEMP_X10(TEMP_UPPER_LIMIT)) {
+            return ms;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief boil a fill from cold until the boil ends or the fault is raised
+ * @param[in] water_kg: fill level, 0-empty
+ * @param[out] dry: what the boil did
+ */
+static void boil_dry(double water_kg, DRY_T *dry)
+{
+    uint32_t ms;
+
+    memset(dry, 0, sizeof(DRY_T));
+    dry->limit_ms = get_limit_ms(water_kg);
+
+    stub_reset();
+    stub_driver_reset();
+    memset(&g_model, 0, sizeof(g_model));
+    model_fill(100.0, water_kg);
+    tuya_app_kettle_init();
+    run_ms(TIME_GET_TEMP_IDLE);
+    stub_temp_read_cnt = 0;
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    for (ms = LOOP_MS; (ms < BOIL_TIME_MAX) && (g_kettle.mode != MODE_NATURE); ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        if (g_kettle.fault != FAULT_NORMAL) {
+            dry->fault_ms = ms + LOOP_MS;
+            dry->readings = stub_temp_read_cnt;
+            dry->element = g_model.element;
+            dry->reading = g_kettle.temp_cur / 10.0;
+            break;
+        }
+    }
+    dry->end_ms = ms;
+    TEST_CHECK(ms < BOIL_TIME_MAX);
+}
+
+/**
+ * @brief a full and a low fill boil without the fault
+ */
+static void test_fill(double water_kg, const char *name)
+{
+    DRY_T dry;
+
+    boil_dry(water_kg, &dry);
+    printf("dry, %s %.1fl: no fault, boiled in %.0f s\n", name, water_kg, dry.end_ms / 1000.0);
+    TEST_CHECK_EQ(dry.fault_ms, 0);
+    TEST_CHECK_EQ(g_kettle.fault, FAULT_NORMAL);
+    TEST_CHECK_EQ(dry.limit_ms, 0);
+}
+
+/**
+ * @brief an empty kettle is caught within a few readings of its steep rise, before the limit
+ */
+static void test_empty(void)
+{
+    DRY_T dry;
+
+    boil_dry(0, &dry);
+    printf("dry, empty: fault in %.1f s after %u readings at %.1f degree (element %.1f); "
+           "the 105 degree limit alone: %.1f s\n", dry.fault_ms / 1000.0, dry.readings, dry.reading, dry.element,
+           dry.limit_ms / 1000.0);
+    TEST_CHECK(dry.fault_ms != 0);
+    TEST_CHECK(dry.fault_ms < dry.limit_ms);
+    TEST_CHECK(dry.readings <= DRY_SAMPLE_MAX);
+    TEST_CHECK(dry.reading < TEMP_UPPER_LIMIT);
+    TEST_CHECK_EQ(stub_relay, OFF);
+}
+
+/**
+ * @brief the largest fill the rate takes for dry, below the low fill
+ */
+static void test_fill_margin(void)
+{
+    DRY_T dry;
+    uint32_t ml, dry_ml = 0;
+
+    for (ml = 50; ml <= 300; ml += 25) {
+        boil_dry(ml / 1000.0, &dry);
+        if (dry.fault_ms != 0) {
+            dry_ml = ml;
+        }
+    }
+    printf("dry, up to %u ml of water is taken for a dry kettle\n", dry_ml);
+    TEST_CHECK(dry_ml < 300);
+}
+
+int main(void)
+{
+    test_fill(1.0, "full");
+    test_fill(0.3, "low");
+    test_empty();
+    test_fill_margin();
+    return test_result("test_dry");
+}
@@ -0,0 +1,134 @@
+/**
+ * @file test_keep_warm.c
+ * @brief host simulation of keep warm 2 on the kettle model: ripple, relay switches and energy
+ *        holding 55 degree; built once per KEEP_WARM2_CTRL, with the kettle source to start it
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "kettle_model.h"
+#include "../src/tuya_app_smart_kettle.c"
+
+#define LOOP_MS         10          /* main loop pass, the model step */
+#define HOUR_MS         (3600 * 1000)
+#define SETTLE_MS       HOUR_MS     /* heat up or cool down to temp_set, not counted */
+
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+#define CTRL_NAME       "pi"
+#define TEST_NAME       "test_keep_warm"
+#else
+#define CTRL_NAME       "bang-bang"
+#define TEST_NAME       "test_keep_warm_bb"
+#endif
+
+/* what an hour held at temp_set did */
+typedef struct {
+    double overshoot;               /* degree, water above temp_set while heating up to it */
+    double water_min;               /* degree, held hour */
+    double water_max;
+    double water_avg;
+    uint32_t switches;              /* relay on and off, held hour */
+    double wh;                      /* heater energy, held hour */
+} KEEP_RUN_T;
+
+static void run_ms(uint32_t ms)
+{
+    while (ms >= LOOP_MS) {
+        model_step(LOOP_MS);
+        stub_delay_ms(LOOP_MS);
+        tuya_app_kettle_loop();
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief keep warm 2 at the default 55 degree: settle, then watch an hour
+ * @param[in] water_kg: fill level
+ * @param[in] water_temp: degree, water put in
+ * @param[out] run: what the held hour did
+ */
+static void run_keep_warm(double water_kg, double water_temp, KEEP_RUN_T *run)
+{
+    const uint8_t water_pure[] = {DP_ID_WATER_TYPE, DT_ENUM, 1, WATER_TYPE_PURE};
+    double sum = 0;
+    uint32_t ms, n = 0;
+    uint8_t relay;
+
+    memset(run, 0, sizeof(KEEP_RUN_T));
+    stub_reset();
+    stub_driver_reset();
+    memset(&g_model, 0, sizeof(g_model));
+    model_fill(100.0, water_kg);
+    g_model.water = water_temp;
+    g_model.element = water_temp;
+    g_model.sensor = water_temp;
+    tuya_app_kettle_init();
+    run_ms(LOOP_MS);
+    tuya_app_kettle_dp_data_handler(water_pure, sizeof(water_pure));
+    key_keep_short_press_cb_fun();
+
+    for (ms = 0; ms < SETTLE_MS; ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        if ((water_temp < TEMP_KEEP_WARM_DEFAULT) && (g_model.water - TEMP_KEEP_WARM_DEFAULT > run->overshoot)) {
+            run->overshoot = g_model.water - TEMP_KEEP_WARM_DEFAULT;
+        }
+    }
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM2);
+
+    run->water_min = run->water_max = g_model.water;
+    g_model.energy = 0;
+    relay = stub_relay;
+    for (ms = 0; ms < HOUR_MS; ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        if (stub_relay != relay) {
+            relay = stub_relay;
+            run->switches++;
+        }
+        if (g_model.water < run->water_min) {
+            run->water_min = g_model.water;
+        }
+        if (g_model.water > run->water_max) {
+            run->water_max = g_model.water;
+        }
+        sum += g_model.water;
+        n++;
+    }
+    run->water_avg = sum / n;
+    run->wh = g_model.energy / 3600.0;
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM2);
+}
+
+/**
+ * @brief the water is held close to temp_set, from cold and after a boil
+ */
+static void test_hold(double water_kg, double water_temp)
+{
+    KEEP_RUN_T run;
+
+    run_keep_warm(water_kg, water_temp, &run);
+    printf("keep warm %s, %.1fl from %.0f degree: %.2f degree over while settling, held %.2f ~ %.2f (avg %.2f), "
+           "%u relay switches and %.1f Wh in an hour\n", CTRL_NAME, water_kg, water_temp, run.overshoot,
+           run.water_min, run.water_max, run.water_avg, run.switches, run.wh);
+    TEST_CHECK(run.water_min >= TEMP_KEEP_WARM_DEFAULT - TEMP_KEEP_RANGE - 0.5);
+    TEST_CHECK(run.water_max <= TEMP_KEEP_WARM_DEFAULT + TEMP_KEEP_RANGE + 0.5);
+    TEST_CHECK(run.overshoot <= TEMP_KEEP_RANGE + 0.5);
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+    /* around temp_set, at most one relay pulse per window */
+    TEST_CHECK((run.water_avg >= TEMP_KEEP_WARM_DEFAULT - TEMP_KEEP_RANGE / 2.0) &&
+               (run.water_avg <= TEMP_KEEP_WARM_DEFAULT + TEMP_KEEP_RANGE / 2.0));
+    TEST_CHECK(run.switches <= 2 * HOUR_MS / TIME_PI_WINDOW);
+#else
+    /* in the dead band under temp_set */
+    TEST_CHECK((run.water_avg >= TEMP_KEEP_WARM_DEFAULT - TEMP_KEEP_RANGE) && (run.water_avg <= TEMP_KEEP_WARM_DEFAULT));
+#endif
+}
+
+int main(void)
+{
+    test_hold(1.0, MODEL_ROOM_TEMP);
+    test_hold(0.5, MODEL_ROOM_TEMP);
+    test_hold(1.7, MODEL_ROOM_TEMP);
+    test_hold(1.0, 95.0);
+    return test_result(TEST_NAME);
+}
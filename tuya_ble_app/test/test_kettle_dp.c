@@ -0,0 +1,423 @@
+/**
+ * @file test_kettle_dp.c
+ * @brief host test and benchmark of the kettle DP write and report path
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "tuya_app_smart_kettle.h"
+
+/* DP ID and type, as in tuya_app_smart_kettle.c */
+#define DP_BOIL         101
+#define DP_KEEP_WARM    102
+#define DP_TEMP_CUR     103
+#define DP_TEMP_SET     104
+#define DP_WATER_TYPE   105
+#define DP_FAULT        106
+#define LOOP_MS         10          /* main loop pass */
+#define TIME_IDLE_MS    10000       /* TIME_GET_TEMP_IDLE */
+
+void key_boil_short_press_cb_fun(void);
+void key_keep_short_press_cb_fun(void);
+
+/* reports sent by run_acked() and the DPs in them */
+static uint32_t sg_report_num;
+static uint32_t sg_report_dp_num;
+
+/* the DP write of tuya_cb_handler() before it passed the SDK buffer through */
+static uint8_t sg_ref_dp_data_array[255+3];
+
+static void ref_dp_write(const uint8_t *p_data, uint16_t data_len)
+{
+    memset(sg_ref_dp_data_array, 0, sizeof(sg_ref_dp_data_array));
+    memcpy(sg_ref_dp_data_array, p_data, data_len);
+    tuya_app_kettle_dp_data_handler(sg_ref_dp_data_array, data_len);
+}
+
+/**
+ * @brief init the kettle, take the first temperature sample and ack its report
+ */
+static void start_kettle(void)
+{
+    stub_reset();
+    stub_driver_reset();
+    tuya_app_kettle_init();
+    tuya_app_kettle_loop();
+    tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+    stub_dp_report_cnt = 0;
+}
+
+/**
+ * @brief count the DPs in a report: id(1) + type(1) + len(1) + value(len)
+ */
+static uint32_t count_dp(const uint8_t *buf, uint32_t len)
+{
+    uint32_t offset = 0, num = 0;
+
+    while (offset + 3 <= len) {
+        offset += 3 + buf[offset + 2];
+        num++;
+    }
+    return num;
+}
+
+/**
+ * @brief run the main loop for ms, acking each report as the app would and counting it
+ */
+static void run_acked(uint32_t ms)
+{
+    uint32_t cnt;
+
+    while (ms >= LOOP_MS) {
+        stub_delay_ms(LOOP_MS);
+        cnt = stub_dp_report_cnt;
+        tuya_app_kettle_loop();
+        if (stub_dp_report_cnt != cnt) {
+            sg_report_num++;
+            sg_report_dp_num += count_dp(stub_dp_report_buf, stub_dp_report_len);
+            tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+        }
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief raise the temperature by step every 100ms until the relay goes off, count the reports
+ *        of the 100ms the relay went off in; one sample at most falls in it
+ * @param[in] step: 0.1 degree per 100ms
+ */
+static void heat_until_off(uint16_t step)
+{
+    while ((stub_relay == ON) && (stub_temp_x10 < 1100)) {
+        stub_temp_x10 += step;
+        sg_report_num = 0;
+        sg_report_dp_num = 0;
+        run_acked(100);
+    }
+}
+
+/**
+ * @brief one user action or event: its DPs go out in one report, not one report per DP
+ */
+static void test_report_per_action(void)
+{
+    const uint8_t boil_on[] = {DP_BOIL, DT_BOOL, 1, 1};
+
+    /* both keys in one pass: boil and keep warm */
+    start_kettle();
+    run_acked(1000);
+    sg_report_num = 0;
+    sg_report_dp_num = 0;
+    key_boil_short_press_cb_fun();
+    key_keep_short_press_cb_fun();
+    run_acked(LOOP_MS);
+    printf("dp report, both keys: %u report for %u DPs\n", sg_report_num, sg_report_dp_num);
+    TEST_CHECK_EQ(sg_report_num, 1);
+    TEST_CHECK_EQ(sg_report_dp_num, 2);
+
+    /* boil cut: boil off, temp cur */
+    heat_until_off(1);
+    printf("dp report, boil cut: %u report for %u DPs\n", sg_report_num, sg_report_dp_num);
+    TEST_CHECK_EQ(sg_report_num, 1);
+    TEST_CHECK_EQ(sg_report_dp_num, 2);
+    TEST_CHECK_EQ(stub_dp_report_buf[0], DP_BOIL);
+
+    /* dry heating: boil and keep warm off, temp cur, fault */
+    start_kettle();
+    stub_temp_x10 = 300;
+    run_acked(TIME_IDLE_MS);
+    tuya_app_kettle_dp_data_handler(boil_on, sizeof(boil_on));
+    tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+    run_acked(LOOP_MS);
+    TEST_CHECK_EQ(stub_relay, ON);
+    heat_until_off(10);
+    printf("dp report, dry heating fault: %u report for %u DPs\n", sg_report_num, sg_report_dp_num);
+    TEST_CHECK_EQ(sg_report_num, 1);
+    TEST_CHECK_EQ(sg_report_dp_num, 4);
+    TEST_CHECK_EQ(stub_dp_report_buf[stub_dp_report_len - 4], DP_FAULT);
+    TEST_CHECK(stub_temp_x10 < 1000);
+}
+
+/**
+ * @brief one write of boil, keep warm and temp set is applied and echoed in one report
+ */
+static void test_packed_write(void)
+{
+    const uint8_t write[] = {
+        DP_BOIL,      DT_BOOL,  1, 1,
+        DP_KEEP_WARM, DT_BOOL,  1, 1,
+        DP_TEMP_SET,  DT_VALUE, 4, 0, 0, 0, 60,
+    };
+
+    start_kettle();
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+    TEST_CHECK_EQ(stub_dp_report_len, sizeof(write));
+    TEST_CHECK(memcmp(stub_dp_report_buf, write, sizeof(write)) == 0);
+
+    /* applied: the next pass starts boiling, nothing more is sent while the echo is in flight */
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_relay, ON);
+    TEST_CHECK_EQ(stub_led[LED_RED], ON);
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+}
+
+/**
+ * @brief only the response with the sn of the report in flight acks it
+ */
+static void test_report_response_sn(void)
+{
+    const uint8_t write[] = {DP_TEMP_SET, DT_VALUE, 4, 0, 0, 0, 70};
+    uint16_t sn;
+
+    start_kettle();
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+    sn = stub_dp_report_sn;
+
+    /* a response to another report leaves ours in flight */
+    tuya_app_kettle_dp_report_response_handler(sn + 1, 0);
+    stub_temp_x10 += 20;
+    stub_delay_ms(3000);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+
+    /* our response: the waiting change goes out in the next pass, with a new sn */
+    tuya_app_kettle_dp_report_response_handler(sn, 0);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 2);
+    TEST_CHECK_EQ(stub_dp_report_sn, (uint16_t)(sn + 1));
+    TEST_CHECK_EQ(stub_dp_report_buf[0], DP_TEMP_CUR);
+}
+
+/**
+ * @brief a response with a wrong or stale sn does not ack the report: its DPs stay dirty and
+ *        are sent again, unchanged, after the timeout; a failed response resends them at once
+ */
+static void test_stale_sn_resend(void)
+{
+    const uint8_t write[] = {DP_TEMP_SET, DT_VALUE, 4, 0, 0, 0, 70};
+    uint16_t sn;
+
+    start_kettle();
+    sn = stub_dp_report_sn;                     /* acked in start_kettle(): stale from now on */
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+    TEST_CHECK_EQ(stub_dp_report_sn, (uint16_t)(sn + 1));
+
+    tuya_app_kettle_dp_report_response_handler(sn, 0);
+    tuya_app_kettle_dp_report_response_handler(sn + 2, 0);
+    stub_delay_ms(4900);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+
+    /* no ack in 5s: the same DP goes out again, the app's value is not trusted */
+    stub_delay_ms(200);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 2);
+    TEST_CHECK_EQ(stub_dp_report_sn, (uint16_t)(sn + 2));
+    TEST_CHECK_EQ(stub_dp_report_len, sizeof(write));
+    TEST_CHECK(memcmp(stub_dp_report_buf, write, sizeof(write)) == 0);
+
+    /* the response to the timed out report is stale too */
+    tuya_app_kettle_dp_report_response_handler(sn + 1, 0);
+    tuya_app_kettle_dp_report_response_handler(sn + 2, 1);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 3);
+    TEST_CHECK_EQ(stub_dp_report_sn, (uint16_t)(sn + 3));
+    TEST_CHECK(memcmp(stub_dp_report_buf, write, sizeof(write)) == 0);
+
+    /* acked: nothing more to send */
+    tuya_app_kettle_dp_report_response_handler(sn + 3, 0);
+    tuya_app_kettle_loop();
+    TEST_CHECK_EQ(stub_dp_report_cnt, 3);
+}
+
+/**
+ * @brief an out of range value is not applied, the echo carries the value in effect
+ */
+static void test_invalid_value(void)
+{
+    const uint8_t write[] = {
+        DP_TEMP_SET, DT_VALUE, 4, 0, 0, 0, 200,
+        DP_BOIL,     DT_BOOL,  1, 1,
+    };
+
+    start_kettle();
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+    TEST_CHECK_EQ(stub_dp_report_len, 11);
+    TEST_CHECK_EQ(stub_dp_report_buf[0], DP_BOIL);
+    TEST_CHECK_EQ(stub_dp_report_buf[3], 1);
+    TEST_CHECK_EQ(stub_dp_report_buf[4], DP_TEMP_SET);
+    TEST_CHECK_EQ(stub_dp_report_buf[10], 55);  /* TEMP_KEEP_WARM_DEFAULT */
+}
+
+/**
+ * @brief write one DP and return the value echoed for it, -1 if it is not echoed
+ */
+static int32_t write_one(uint8_t id, uint8_t type, uint8_t len, uint32_t value)
+{
+    uint8_t write[3 + 4] = {id, type, len};
+    uint32_t cnt = stub_dp_report_cnt;
+    uint8_t i;
+
+    for (i = 0; i < len; i++) {
+        write[3 + i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    }
+    tuya_app_kettle_dp_data_handler(write, 3 + len);
+    if (stub_dp_report_cnt == cnt) {
+        return -1;
+    }
+    tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+    TEST_CHECK_EQ(stub_dp_report_buf[0], id);
+    TEST_CHECK_EQ(stub_dp_report_buf[1], type);
+    TEST_CHECK_EQ(stub_dp_report_len, 3u + stub_dp_report_buf[2]);
+    value = 0;
+    for (i = 0; i < stub_dp_report_buf[2]; i++) {
+        value = (value << 8) | stub_dp_report_buf[3 + i];
+    }
+    return (int32_t)value;
+}
+
+/**
+ * @brief the schema table checks range, type and length of every writable DP: a value out of
+ *        range is echoed with the value in effect, a DP of the wrong type or length, unknown
+ *        or report only is not applied nor echoed
+ */
+static void test_dp_schema(void)
+{
+    const uint8_t write[] = {
+        100,          DT_BOOL,  1, 1,
+        DP_TEMP_CUR,  DT_VALUE, 4, 0, 0, 0, 50,
+        DP_BOIL,      DT_BOOL,  4, 0, 0, 0, 1,
+        107,          DT_VALUE, 4, 0, 0, 0, 1,
+        DP_KEEP_WARM, DT_BOOL,  1, 1,
+    };
+
+    start_kettle();
+    /* temp set: 45 ~ 90 */
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 44), 55);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 45), 45);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 90), 90);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 91), 90);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 0x100002D), 90);
+    /* bool and enum: 0 ~ 1 */
+    TEST_CHECK_EQ(write_one(DP_BOIL, DT_BOOL, 1, 2), 0);
+    TEST_CHECK_EQ(write_one(DP_WATER_TYPE, DT_ENUM, 1, 2), 0);
+    TEST_CHECK_EQ(write_one(DP_WATER_TYPE, DT_ENUM, 1, 1), 1);
+    /* wrong length or type */
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 1, 60), -1);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 2, 60), -1);
+    TEST_CHECK_EQ(write_one(DP_BOIL, DT_BOOL, 4, 1), -1);
+    TEST_CHECK_EQ(write_one(DP_BOIL, DT_ENUM, 1, 1), -1);
+    TEST_CHECK_EQ(write_one(DP_TEMP_SET, DT_VALUE, 4, 60), 60);
+    /* report only and unknown */
+    TEST_CHECK_EQ(write_one(DP_TEMP_CUR, DT_VALUE, 4, 50), -1);
+    TEST_CHECK_EQ(write_one(DP_FAULT, DT_ENUM, 1, 1), -1);
+    TEST_CHECK_EQ(write_one(100, DT_BOOL, 1, 1), -1);
+    TEST_CHECK_EQ(write_one(107, DT_BOOL, 1, 1), -1);
+    TEST_CHECK_EQ(stub_relay, OFF);
+
+    /* skipped DPs do not stop the ones after them */
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_len, 4);
+    TEST_CHECK_EQ(stub_dp_report_buf[0], DP_KEEP_WARM);
+    TEST_CHECK_EQ(stub_dp_report_buf[3], 1);
+}
+
+/**
+ * @brief a truncated DP at the end is dropped, the DPs before it are applied
+ */
+static void test_truncated_write(void)
+{
+    const uint8_t write[] = {
+        DP_KEEP_WARM, DT_BOOL,  1, 1,
+        DP_TEMP_SET,  DT_VALUE, 4, 0, 0,
+    };
+
+    start_kettle();
+    tuya_app_kettle_dp_data_handler(write, sizeof(write));
+    TEST_CHECK_EQ(stub_dp_report_cnt, 1);
+    TEST_CHECK_EQ(stub_dp_report_len, 4);
+    TEST_CHECK_EQ(stub_dp_report_buf[0], DP_KEEP_WARM);
+}
+
+/**
+ * @brief the write is decoded in the SDK buffer, which is left as it was, and echoed as through
+ *        the copy
+ */
+static void test_write_in_place(void)
+{
+    const uint8_t write[] = {
+        DP_BOIL,       DT_BOOL,  1, 1,
+        DP_KEEP_WARM,  DT_BOOL,  1, 1,
+        DP_TEMP_SET,   DT_VALUE, 4, 0, 0, 0, 200,
+        DP_WATER_TYPE, DT_ENUM,  1, 1,
+    };
+    uint8_t sdk_buf[sizeof(write)];
+    uint8_t ref_echo[sizeof(stub_dp_report_buf)];
+    uint32_t ref_len;
+
+    start_kettle();
+    ref_dp_write(write, sizeof(write));
+    ref_len = stub_dp_report_len;
+    memcpy(ref_echo, stub_dp_report_buf, ref_len);
+
+    start_kettle();
+    memcpy(sdk_buf, write, sizeof(write));
+    tuya_app_kettle_dp_data_handler(sdk_buf, sizeof(sdk_buf));
+    TEST_CHECK(memcmp(sdk_buf, write, sizeof(write)) == 0);
+    TEST_CHECK_EQ(stub_dp_report_len, ref_len);
+    TEST_CHECK(memcmp(stub_dp_report_buf, ref_echo, ref_len) == 0);
+}
+
+/**
+ * @brief cycles of a four DP write from the callback to the echo report, in the SDK buffer and
+ *        through the cleared 258 byte copy
+ */
+static void bench_dp_write(void)
+{
+    const uint8_t write[] = {
+        DP_BOIL,       DT_BOOL,  1, 0,
+        DP_KEEP_WARM,  DT_BOOL,  1, 0,
+        DP_TEMP_SET,   DT_VALUE, 4, 0, 0, 0, 60,
+        DP_WATER_TYPE, DT_ENUM,  1, 1,
+    };
+    const uint32_t write_num = 100000;
+    uint64_t start, ref = 0, in_place = 0;
+    uint32_t i;
+
+    start_kettle();
+    for (i = 0; i < write_num; i++) {
+        start = test_cycles();
+        ref_dp_write(write, sizeof(write));
+        ref += test_cycles() - start;
+        tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+
+        start = test_cycles();
+        tuya_app_kettle_dp_data_handler(write, sizeof(write));
+        in_place += test_cycles() - start;
+        tuya_app_kettle_dp_report_response_handler(stub_dp_report_sn, 0);
+    }
+    TEST_CHECK_EQ(stub_dp_report_cnt, 2 * write_num);
+    printf("dp write, 4 DPs: %.0f cycles in the SDK buffer, %.0f cycles through the copy\n",
+           (double)in_place / write_num, (double)ref / write_num);
+}
+
+int main(int argc, char *argv[])
+{
+    test_report_per_action();
+    test_packed_write();
+    test_report_response_sn();
+    test_stale_sn_resend();
+    test_invalid_value();
+    test_truncated_write();
+    test_dp_schema();
+    test_write_in_place();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_dp_write();
+    }
+    return test_result("test_kettle_dp");
+}
@@ -0,0 +1,370 @@
+/**
+ * @file test_kettle_fsm.c
+ * @brief host test of the kettle state machine, built with the kettle source to see its mode
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "../src/tuya_app_smart_kettle.c"
+
+#define LOOP_MS         10          /* main loop pass */
+
+static const uint8_t sg_dp_water_pure[] = {DP_ID_WATER_TYPE, DT_ENUM, 1, WATER_TYPE_PURE};
+static const uint8_t sg_dp_water_tap[] = {DP_ID_WATER_TYPE, DT_ENUM, 1, WATER_TYPE_TAP};
+
+/* the inputs that raise the kettle events */
+enum {
+    IN_FAULT,                       /* FAULT_SET: a reading at the limit */
+    IN_FAULT_CLEAR,                 /* FAULT_CLEAR: a reading under the limit */
+    IN_SAMPLE,                      /* TEMP_SAMPLE: a reading, no change */
+    IN_KEY_BOIL,                    /* SETTING */
+    IN_KEY_KEEP,
+    IN_WATER_TAP,                   /* SETTING: water type DP write */
+    IN_WATER_PURE,
+    IN_NUM,
+};
+static const KETTLE_EVT_E sg_in_evt[IN_NUM] = {
+    EVT_FAULT_SET, EVT_FAULT_CLEAR, EVT_TEMP_SAMPLE, EVT_SETTING, EVT_SETTING, EVT_SETTING, EVT_SETTING,
+};
+
+/* mode after each input, from a kettle started in the mode of the row */
+static const MODE_E sg_in_mode[MODE_NUM][IN_NUM] = {
+    /*                     FAULT        FAULT_CLEAR      SAMPLE           KEY_BOIL     KEY_KEEP         WATER_TAP        WATER_PURE */
+    [MODE_NATURE]       = {MODE_FAULT,  MODE_NATURE,     MODE_NATURE,     MODE_BOIL,   MODE_KEEP_WARM1, MODE_NATURE,     MODE_NATURE},
+    [MODE_BOIL]         = {MODE_FAULT,  MODE_BOIL,       MODE_BOIL,       MODE_NATURE, MODE_BOIL,       MODE_BOIL,       MODE_BOIL},
+    [MODE_KEEP_WARM1]   = {MODE_FAULT,  MODE_KEEP_WARM1, MODE_KEEP_WARM1, MODE_BOIL,   MODE_NATURE,     MODE_KEEP_WARM1, MODE_KEEP_WARM2},
+    [MODE_KEEP_WARM2]   = {MODE_FAULT,  MODE_KEEP_WARM2, MODE_KEEP_WARM2, MODE_BOIL,   MODE_NATURE,     MODE_KEEP_WARM1, MODE_KEEP_WARM2},
+    [MODE_FAULT]        = {MODE_FAULT,  MODE_NATURE,     MODE_FAULT,      MODE_FAULT,  MODE_FAULT,      MODE_FAULT,      MODE_FAULT},
+};
+
+static void run_ms(uint32_t ms)
+{
+    while (ms >= LOOP_MS) {
+        stub_delay_ms(LOOP_MS);
+        tuya_app_kettle_loop();
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief set the temperature and run until it has been sampled
+ * @param[in] temp: temperature (0.1 degree)
+ */
+static void set_temp(uint16_t temp)
+{
+    stub_temp_x10 = temp;
+    run_ms(TIME_GET_TEMP_IDLE + LOOP_MS);
+}
+
+/**
+ * @brief heat at 1 degree/s, below the dry heating rate, then hold until sampled
+ * @param[in] temp: temperature (0.1 degree)
+ */
+static void heat_to(uint16_t temp)
+{
+    while (stub_temp_x10 < temp) {
+        stub_temp_x10++;
+        run_ms(100);
+    }
+    set_temp(temp);
+}
+
+/**
+ * @brief a fresh kettle at 25 degree in the given mode
+ * @param[in] mode: MODE_NATURE ~ MODE_FAULT
+ */
+static void start_kettle(MODE_E mode)
+{
+    stub_reset();
+    stub_driver_reset();
+    tuya_app_kettle_init();
+    set_temp(250);
+    switch (mode) {
+    case MODE_BOIL:
+        key_boil_short_press_cb_fun();
+        break;
+    case MODE_KEEP_WARM1:
+        key_keep_short_press_cb_fun();
+        break;
+    case MODE_KEEP_WARM2:
+        tuya_app_kettle_dp_data_handler(sg_dp_water_pure, sizeof(sg_dp_water_pure));
+        key_keep_short_press_cb_fun();
+        break;
+    case MODE_FAULT:
+        set_temp(TEMP_X10(TEMP_UPPER_LIMIT));
+        break;
+    default:
+        break;
+    }
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, mode);
+}
+
+/**
+ * @brief apply an input as the kettle gets it; an event no input can raise in the mode is posted
+ *        as its source would: FAULT_SET in FAULT, FAULT_CLEAR out of FAULT
+ * @param[in] in: IN_FAULT ~ IN_WATER_PURE
+ * @return the event raised by a key or DP write, or posted, 0-none or a reading
+ */
+static uint8_t apply_input(uint8_t in)
+{
+    uint8_t fault = (g_kettle.mode == MODE_FAULT);
+
+    switch (in) {
+    case IN_FAULT:
+        if (fault) {
+            post_kettle_event(EVT_FAULT_SET);
+            break;
+        }
+        set_temp(TEMP_X10(TEMP_UPPER_LIMIT));
+        return 0;
+    case IN_FAULT_CLEAR:
+        if (!fault) {
+            post_kettle_event(EVT_FAULT_CLEAR);
+            break;
+        }
+        set_temp(TEMP_X10(TEMP_UPPER_LIMIT) - 10);
+        return 0;
+    case IN_SAMPLE:
+        set_temp(stub_temp_x10);
+        return 0;
+    case IN_KEY_BOIL:
+        key_boil_short_press_cb_fun();
+        break;
+    case IN_KEY_KEEP:
+        key_keep_short_press_cb_fun();
+        break;
+    case IN_WATER_TAP:
+        tuya_app_kettle_dp_data_handler(sg_dp_water_tap, sizeof(sg_dp_water_tap));
+        break;
+    default:
+        tuya_app_kettle_dp_data_handler(sg_dp_water_pure, sizeof(sg_dp_water_pure));
+        break;
+    }
+    return sg_kettle_evt;
+}
+
+/**
+ * @brief every row and event of sg_kettle_trans, by the inputs that raise the event: the mode
+ *        each input leads to, and the table cell agrees with it
+ */
+static void test_trans_table(void)
+{
+    uint8_t seen[MODE_NUM][EVT_NUM];
+    MODE_E mode, next;
+    uint8_t in, evt, posted;
+    uint32_t cells = 0;
+
+    memset(seen, 0, sizeof(seen));
+    for (mode = MODE_NATURE; mode < MODE_NUM; mode++) {
+        for (in = 0; in < IN_NUM; in++) {
+            start_kettle(mode);
+            evt = sg_in_evt[in];
+            posted = apply_input(in);
+            /* a key in FAULT is locked before it posts anything */
+            if ((posted & (1 << evt)) || (evt != EVT_SETTING)) {
+                seen[mode][evt] = 1;
+            }
+            run_ms(LOOP_MS);
+            if (g_kettle.mode != sg_in_mode[mode][in]) {
+                printf("mode %d, input %d: mode %d, expected %d\n", mode, in, g_kettle.mode, sg_in_mode[mode][in]);
+            }
+            TEST_CHECK_EQ(g_kettle.mode, sg_in_mode[mode][in]);
+            next = sg_kettle_trans[mode][evt];
+            if (next == MODE_NONE) {
+                TEST_CHECK_EQ(sg_in_mode[mode][in], mode);
+            } else if (next != MODE_BY_SETTING) {
+                TEST_CHECK_EQ(sg_in_mode[mode][in], next);
+            }
+            if (g_kettle.mode == MODE_NATURE) {
+                TEST_CHECK_EQ(stub_relay, OFF);
+            }
+        }
+    }
+    for (mode = MODE_NATURE; mode < MODE_NUM; mode++) {
+        for (evt = 0; evt < EVT_NUM; evt++) {
+            cells += seen[mode][evt];
+        }
+    }
+    TEST_CHECK_EQ(cells, MODE_NUM * EVT_NUM);
+}
+
+/**
+ * @brief SETTING transitions: keys and water type pick the mode
+ */
+static void test_setting_transition(void)
+{
+    /* NATURE -> BOIL -> NATURE */
+    start_kettle(MODE_NATURE);
+    TEST_CHECK_EQ(stub_relay, OFF);
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_BOIL);
+    TEST_CHECK_EQ(stub_relay, ON);
+    TEST_CHECK_EQ(stub_led[LED_RED], ON);
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+    TEST_CHECK_EQ(stub_relay, OFF);
+
+    /* NATURE -> KEEP_WARM1 (tap water) -> KEEP_WARM2 once boiled -> NATURE */
+    start_kettle(MODE_KEEP_WARM1);
+    TEST_CHECK_EQ(stub_relay, ON);
+    heat_to(TEMP_X10(TEMP_BOILED) + 10);
+    TEST_CHECK_EQ(g_kettle.water_type, WATER_TYPE_PURE);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM2);
+    TEST_CHECK_EQ(stub_relay, OFF);
+    key_keep_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+
+    /* KEEP_WARM1 -> BOIL -> KEEP_WARM1 -> NATURE */
+    start_kettle(MODE_KEEP_WARM1);
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_BOIL);
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM1);
+    key_keep_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+
+    /* NATURE -> KEEP_WARM2 (pure water) -> BOIL -> KEEP_WARM2 once boiled */
+    start_kettle(MODE_KEEP_WARM2);
+    key_boil_short_press_cb_fun();
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_BOIL);
+    TEST_CHECK_EQ(stub_relay, ON);
+    heat_to(TEMP_X10(TEMP_BOILED) + 10);
+    TEST_CHECK_EQ(g_kettle.boil_turn, OFF);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM2);
+
+    /* BOIL -> NATURE once boiled, keep warm off */
+    start_kettle(MODE_BOIL);
+    heat_to(TEMP_X10(TEMP_BOILED) + 10);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+    TEST_CHECK_EQ(stub_relay, OFF);
+}
+
+/**
+ * @brief FAULT_SET from every mode, SETTING is ignored in FAULT, FAULT_CLEAR goes to NATURE
+ */
+static void test_fault_transition(void)
+{
+    MODE_E mode;
+
+    for (mode = MODE_NATURE; mode < MODE_FAULT; mode++) {
+        start_kettle(mode);
+        set_temp(TEMP_X10(TEMP_UPPER_LIMIT));
+        TEST_CHECK_EQ(g_kettle.mode, MODE_FAULT);
+        TEST_CHECK_EQ(g_kettle.fault, FAULT_LACK_WATER);
+        TEST_CHECK_EQ(stub_relay, OFF);
+        TEST_CHECK_EQ(stub_led[LED_RED] | stub_led[LED_ORANGE] | stub_led[LED_GREEN], OFF);
+        TEST_CHECK_EQ(stub_buzzer_mode, BUZZER_MODE_FAULT);
+        TEST_CHECK_EQ(g_kettle.boil_turn | g_kettle.keep_warm_turn, OFF);
+    }
+
+    /* keys and DP writes are locked */
+    key_boil_short_press_cb_fun();
+    key_keep_short_press_cb_fun();
+    tuya_app_kettle_dp_data_handler(sg_dp_water_pure, sizeof(sg_dp_water_pure));
+    run_ms(LOOP_MS);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_FAULT);
+    TEST_CHECK_EQ(stub_relay, OFF);
+
+    /* cleared once below the limit */
+    set_temp(TEMP_X10(TEMP_UPPER_LIMIT) - 10);
+    TEST_CHECK_EQ(g_kettle.mode, MODE_NATURE);
+    TEST_CHECK_EQ(g_kettle.fault, FAULT_NORMAL);
+    TEST_CHECK_EQ(stub_buzzer_mode, BUZZER_MODE_STOP);
+}
+
+/**
+ * @brief a dry kettle is caught by its rate of rise, well below the limit
+ */
+static void test_dry_heating(void)
+{
+    uint16_t temp = 300;
+
+    start_kettle(MODE_BOIL);
+    while ((g_kettle.mode == MODE_BOIL) && (temp < 800)) {
+        temp += 10;                         /* 5 degree/s */
+        stub_temp_x10 = temp;
+        run_ms(200);
+    }
+    TEST_CHECK_EQ(g_kettle.mode, MODE_FAULT);
+    TEST_CHECK(temp < 500);
+    TEST_CHECK_EQ(stub_relay, OFF);
+}
+
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+/**
+ * @brief the PI window can not turn the heater back on once a fault is raised
+ */
+static void test_fault_stops_pi(void)
+{
+    uint32_t toggle;
+
+    /* below temp_set: the PI window starts with the relay on */
+    start_kettle(MODE_KEEP_WARM2);
+    TEST_CHECK_EQ(stub_relay, ON);
+    TEST_CHECK(app_timer_is_active(&sg_pi_timer));
+
+    /* the fault is found first in a timer pass, the PI window ends in the same pass */
+    g_kettle.temp_cur = TEMP_X10(TEMP_UPPER_LIMIT);
+    detect_and_handle_fault_event();
+    TEST_CHECK_EQ(g_kettle.mode, MODE_KEEP_WARM2);
+    pi_window_timeout_handler();
+    TEST_CHECK_EQ(stub_relay, OFF);
+    dispatch_kettle_event();
+    TEST_CHECK_EQ(g_kettle.mode, MODE_FAULT);
+    TEST_CHECK(!app_timer_is_active(&sg_pi_timer));
+
+    /* and stays off for two windows */
+    stub_temp_x10 = TEMP_X10(TEMP_UPPER_LIMIT);
+    toggle = stub_relay_toggle_cnt;
+    run_ms(2 * TIME_PI_WINDOW);
+    TEST_CHECK_EQ(stub_relay_toggle_cnt, toggle);
+}
+#endif
+
+/**
+ * @brief actions run on transitions and samples only, not on every loop pass
+ */
+static void test_loop_work(void)
+{
+    uint32_t relay_cnt, led_cnt;
+    uint32_t i;
+
+    start_kettle(MODE_BOIL);
+    run_ms(100);                            /* the sample due after the mode change */
+    relay_cnt = stub_relay_set_cnt;
+    led_cnt = stub_led_set_cnt;
+    for (i = 0; i < 1000; i++) {
+        tuya_app_kettle_loop();
+    }
+    TEST_CHECK_EQ(stub_relay_set_cnt, relay_cnt);
+    TEST_CHECK_EQ(stub_led_set_cnt, led_cnt);
+
+    /* 10s of 10ms passes: one relay action per 2s sample */
+    run_ms(10000 - 100);
+    printf("boil, 1000 passes in 10s: %u relay and %u led calls\n",
+           stub_relay_set_cnt - relay_cnt, stub_led_set_cnt - led_cnt);
+    TEST_CHECK(stub_relay_set_cnt - relay_cnt <= 10000 / TIME_GET_TEMP);
+    TEST_CHECK_EQ(stub_led_set_cnt, led_cnt);
+}
+
+int main(void)
+{
+    test_trans_table();
+    test_setting_transition();
+    test_fault_transition();
+    test_dry_heating();
+#if (KEEP_WARM2_CTRL == KEEP_WARM2_CTRL_PI)
+    test_fault_stops_pi();
+#endif
+    test_loop_work();
+    return test_result("test_kettle_fsm");
+}
@@ -0,0 +1,318 @@
+/**
+ * @file test_key.c
+ * @brief host test and benchmark of the key driver: debounce, short / long press, double click, combo
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_timer.h"
+#include "tuya_app_driver_key.h"
+#include "tuya_app_pm.h"
+#include "key_ref.h"
+
+#define KEY1_PIN        GPIO_PC3
+#define KEY2_PIN        GPIO_PC2
+#define SCAN_MS         10
+
+/* key events seen */
+enum {
+    EVT_SHORT1,
+    EVT_SHORT2,
+    EVT_LONG2,
+    EVT_DOUBLE1,
+    EVT_COMBO,
+    EVT_NUM,
+};
+static uint32_t sg_evt_cnt[EVT_NUM];
+static uint32_t sg_evt_ms[EVT_NUM];
+static uint32_t sg_passes;          /* main loop passes */
+
+static void record(uint8_t evt)
+{
+    sg_evt_cnt[evt]++;
+    sg_evt_ms[evt] = app_timer_get_ms();
+}
+
+static void short1_cb(void)  { record(EVT_SHORT1); }
+static void short2_cb(void)  { record(EVT_SHORT2); }
+static void long2_cb(void)   { record(EVT_LONG2); }
+static void double1_cb(void) { record(EVT_DOUBLE1); }
+static void combo_cb(void)   { record(EVT_COMBO); }
+
+/* as the kettle: key1 short press only, key2 short and 5s long press, both held 1s */
+static KEY_DEF_T sg_key_def[] = {
+    {KEY1_PIN, short1_cb, NULL, NULL, 0},
+    {KEY2_PIN, short2_cb, long2_cb, NULL, 5000},
+};
+static const KEY_COMBO_DEF_T sg_combo_def[] = {
+    {KEY_CODE(0) | KEY_CODE(1), combo_cb, 1000},
+};
+
+/**
+ * @brief fresh timers and keys
+ * @param[in] double_click: give key1 a double click callback
+ */
+static void start_key(bool double_click)
+{
+    TS02N_KEY_DEF_T def = {sg_key_def, 2, sg_combo_def, 1, SCAN_MS};
+
+    stub_reset();
+    memset(sg_evt_cnt, 0, sizeof(sg_evt_cnt));
+    sg_key_def[0].double_click_cb = double_click ? double1_cb : NULL;
+    app_timer_init();
+    TEST_CHECK_EQ(ts02n_key_init(&def), KEY_INIT_OK);
+}
+
+/**
+ * @brief the end of a loop pass as app_pm_idle(): awake while the next deadline is close, else a
+ *        suspend that a pressed key ends at once; run_ms moves the clock
+ */
+static void pm_idle(uint32_t sleep_ms)
+{
+    if (sleep_ms < APP_PM_SLEEP_MIN) {
+        ts02n_key_wake_up();
+    } else if (cpu_sleep_wakeup(SUSPEND_MODE, PM_WAKEUP_PAD | PM_WAKEUP_TIMER, stub_tick) &
+               (WAKEUP_STATUS_PAD | STATUS_GPIO_ERR_NO_ENTER_PM)) {
+        ts02n_key_wake_up();
+    }
+}
+
+/**
+ * @brief main loop every ms: wake check, the timers, then the idle
+ */
+static void run_ms(uint32_t ms)
+{
+    while (ms--) {
+        stub_delay_ms(1);
+        ts02n_key_wake_check();
+        pm_idle(app_timer_run());
+        sg_passes++;
+    }
+}
+
+/**
+ * @brief contact bounce: 6 changes 3ms apart, then settled at level
+ */
+static void bounce(uint32_t pin, int level)
+{
+    uint8_t i;
+
+    for (i = 0; i < 6; i++) {
+        stub_set_gpio_in(pin, (i & 1) ? level : !level);
+        run_ms(3);
+    }
+    stub_set_gpio_in(pin, level);
+}
+
+static void click(uint32_t pin, uint32_t ms)
+{
+    stub_set_gpio_in(pin, 0);
+    run_ms(ms);
+    stub_set_gpio_in(pin, 1);
+}
+
+/**
+ * @brief a bouncing press and release is one short press, on the press when there is no release event
+ */
+static void test_bounce(void)
+{
+    start_key(false);
+    run_ms(100);
+    bounce(KEY1_PIN, 0);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 1);
+    bounce(KEY1_PIN, 1);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 1);
+
+    /* key2 has a long press: its short press is on the release */
+    bounce(KEY2_PIN, 0);
+    run_ms(300);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT2], 0);
+    bounce(KEY2_PIN, 1);
+    run_ms(100);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT2], 1);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_LONG2], 0);
+}
+
+/**
+ * @brief a 20ms glitch is shorter than the 4 scan debounce and is ignored
+ */
+static void test_glitch(void)
+{
+    start_key(false);
+    click(KEY1_PIN, 20);
+    click(KEY2_PIN, 20);
+    run_ms(500);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1] + sg_evt_cnt[EVT_SHORT2], 0);
+}
+
+/**
+ * @brief the long press fires once while held, with no short press on the release
+ */
+static void test_long_press(void)
+{
+    uint32_t press_ms;
+
+    start_key(false);
+    run_ms(100);
+    press_ms = app_timer_get_ms();
+    stub_set_gpio_in(KEY2_PIN, 0);
+    run_ms(6000);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_LONG2], 1);
+    /* debounced 3 scans after the press */
+    TEST_CHECK(sg_evt_ms[EVT_LONG2] - press_ms >= 5000 + 3 * SCAN_MS);
+    TEST_CHECK(sg_evt_ms[EVT_LONG2] - press_ms <= 5000 + 4 * SCAN_MS);
+    stub_set_gpio_in(KEY2_PIN, 1);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_LONG2], 1);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT2], 0);
+}
+
+/**
+ * @brief two clicks in the gap are one double click, one click is a short press after the gap
+ */
+static void test_double_click(void)
+{
+    start_key(true);
+    click(KEY1_PIN, 100);
+    run_ms(100);
+    click(KEY1_PIN, 100);
+    run_ms(500);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_DOUBLE1], 1);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 0);
+
+    click(KEY1_PIN, 100);
+    run_ms(KEY_DOUBLE_CLICK_TIME - 50);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 0);
+    run_ms(100);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 1);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_DOUBLE1], 1);
+
+    /* too slow: two short presses */
+    click(KEY1_PIN, 100);
+    run_ms(KEY_DOUBLE_CLICK_TIME + 100);
+    click(KEY1_PIN, 100);
+    run_ms(KEY_DOUBLE_CLICK_TIME + 100);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 3);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_DOUBLE1], 1);
+}
+
+/**
+ * @brief both keys held are the combo only: no short or long press of either key
+ */
+static void test_combo(void)
+{
+    start_key(false);
+    bounce(KEY1_PIN, 0);
+    bounce(KEY2_PIN, 0);
+    run_ms(6000);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_COMBO], 1);
+    stub_set_gpio_in(KEY1_PIN, 1);
+    run_ms(100);
+    stub_set_gpio_in(KEY2_PIN, 1);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_COMBO], 1);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1] + sg_evt_cnt[EVT_SHORT2] + sg_evt_cnt[EVT_LONG2], 0);
+}
+
+/**
+ * @brief with the keys released the scan stops: no timer left and no key read in the loop passes
+ *        until a press wakes the chip up
+ */
+static void test_idle(void)
+{
+    start_key(false);
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+    click(KEY1_PIN, 100);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 1);
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+    stub_gpio_read_cnt = 0;
+    sg_passes = 0;
+    run_ms(10000);
+    printf("key, idle: %u gpio reads in %u loop passes\n", stub_gpio_read_cnt, sg_passes);
+    TEST_CHECK_EQ(sg_passes, 10000);
+    TEST_CHECK_EQ(stub_gpio_read_cnt, 0);
+
+    /* the press wakes the chip up, the scan starts from the pass after */
+    click(KEY1_PIN, 100);
+    run_ms(200);
+    TEST_CHECK_EQ(sg_evt_cnt[EVT_SHORT1], 2);
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+}
+
+/**
+ * @brief cycles of a scan with all KEY_NUM_MAX keys defined and one held
+ */
+static void bench_scan(void)
+{
+    static const uint32_t pin[KEY_NUM_MAX] = {
+        GPIO_PB4, GPIO_PB5, GPIO_PB6, GPIO_PC2, GPIO_PC3, GPIO_PD2, GPIO_PD3, GPIO_PD4,
+    };
+    const uint32_t scan_num = 1000000;
+    KEY_DEF_T key[KEY_NUM_MAX];
+    TS02N_KEY_DEF_T def = {key, KEY_NUM_MAX, NULL, 0, SCAN_MS};
+    uint64_t start, base, scan;
+    uint32_t i;
+
+    stub_reset();
+    app_timer_init();
+    for (i = 0; i < KEY_NUM_MAX; i++) {
+        key[i] = (KEY_DEF_T){pin[i], short1_cb, long2_cb, NULL, 0xFFFFFFFF};
+    }
+    ts02n_key_init(&def);
+
+    /* the timer pass alone, no timer due */
+    start = test_cycles();
+    for (i = 0; i < scan_num; i++) {
+        app_timer_run();
+    }
+    base = test_cycles() - start;
+
+    stub_set_gpio_in(pin[0], 0);
+    ts02n_key_wake_up();
+    ts02n_key_wake_check();
+    start = test_cycles();
+    for (i = 0; i < scan_num; i++) {
+        stub_delay_ms(SCAN_MS);
+        app_timer_run();
+    }
+    scan = test_cycles() - start;
+    printf("key scan, %d keys: %.1f cycles, %.1f per key\n", KEY_NUM_MAX,
+           (double)(scan - base) / scan_num, (double)(scan - base) / scan_num / KEY_NUM_MAX);
+}
+
+/**
+ * @brief the driver takes nothing from the SDK heap, the old one kept its manager there;
+ *        last: the old driver's scan timer stays in the list
+ */
+static void test_heap(void)
+{
+    TS02N_KEY_DEF_T def = {sg_key_def, 2, sg_combo_def, 1, SCAN_MS};
+
+    start_key(false);
+    TEST_CHECK_EQ(stub_heap_max, 0);
+    run_ms(100);
+    TEST_CHECK_EQ(stub_heap_max, 0);
+
+    TEST_CHECK_EQ(ref_ts02n_key_init(&def), KEY_INIT_OK);
+    printf("key, heap high-water after init: 0 bytes, %u bytes before the static manager (host pointers)\n",
+           stub_heap_max);
+    TEST_CHECK(stub_heap_max > 0);
+}
+
+int main(int argc, char *argv[])
+{
+    test_bounce();
+    test_glitch();
+    test_long_press();
+    test_double_click();
+    test_combo();
+    test_idle();
+    test_heap();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_scan();
+    }
+    return test_result("test_key");
+}
@@ -0,0 +1,151 @@
+/**
+ * @file test_key_timing.c
+ * @brief host test of the key timing with main loop stalls (flash writes, BLE events)
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_timer.h"
+#include "tuya_app_driver_key.h"
+#include "tuya_app_pm.h"
+
+#define KEY_PIN         GPIO_PC2
+#define SCAN_MS         10
+#define DEBOUNCE_MS     (3 * SCAN_MS)   /* 4 equal scans, the first on the wake check */
+
+static uint32_t sg_seed;
+static uint32_t sg_long_cnt, sg_long_ms;
+static uint32_t sg_short_cnt;
+static uint32_t sg_period_cnt;
+static APP_TIMER_T sg_period_timer;
+
+static void short_cb(void)
+{
+    sg_short_cnt++;
+}
+
+static void long_cb(void)
+{
+    sg_long_cnt++;
+    sg_long_ms = app_timer_get_ms();
+}
+
+static void period_cb(void)
+{
+    sg_period_cnt++;
+}
+
+static uint32_t get_rand(void)
+{
+    sg_seed = sg_seed * 1103515245u + 12345u;
+    return (sg_seed >> 16) & 0x7FFF;
+}
+
+/**
+ * @brief the end of a loop pass as app_pm_idle(): awake while the next deadline is close, else a
+ *        suspend that a pressed key ends at once; run_ms moves the clock
+ */
+static void pm_idle(uint32_t sleep_ms)
+{
+    if (sleep_ms < APP_PM_SLEEP_MIN) {
+        ts02n_key_wake_up();
+    } else if (cpu_sleep_wakeup(SUSPEND_MODE, PM_WAKEUP_PAD | PM_WAKEUP_TIMER, stub_tick) &
+               (WAKEUP_STATUS_PAD | STATUS_GPIO_ERR_NO_ENTER_PM)) {
+        ts02n_key_wake_up();
+    }
+}
+
+/**
+ * @brief main loop, about one pass in 50 stalls for 100 ~ 400ms
+ * @param[in] ms: time to run
+ * @param[in] stall: 0-a pass every ms 1-random stalls
+ */
+static void run_ms(uint32_t ms, bool stall)
+{
+    uint32_t step;
+
+    while (ms > 0) {
+        step = (stall && (get_rand() % 50 == 0)) ? (100 + get_rand() % 300) : 1;
+        if (step > ms) {
+            step = ms;
+        }
+        stub_delay_ms(step);
+        ts02n_key_wake_check();
+        pm_idle(app_timer_run());
+        ms -= step;
+    }
+}
+
+static void start_key(uint32_t seed)
+{
+    static const KEY_DEF_T key_def[] = {
+        {KEY_PIN, short_cb, long_cb, NULL, 5000},
+    };
+    TS02N_KEY_DEF_T def = {key_def, 1, NULL, 0, SCAN_MS};
+
+    stub_reset();
+    app_timer_init();
+    ts02n_key_init(&def);
+    app_timer_start(&sg_period_timer, 1000, 1000, period_cb);
+    sg_seed = seed;
+    sg_long_cnt = 0;
+    sg_short_cnt = 0;
+    sg_period_cnt = 0;
+}
+
+/**
+ * @brief stalls during the hold do not delay the 5s long press: it fires within one scan of 5000ms held
+ */
+static void test_long_press_with_stalls(void)
+{
+    uint32_t seed, press_ms, late, late_max = 0;
+
+    for (seed = 1; seed <= 20; seed++) {
+        start_key(seed);
+        run_ms(100, false);
+        press_ms = app_timer_get_ms();
+        stub_set_gpio_in(KEY_PIN, 0);
+        run_ms(DEBOUNCE_MS + 100, false);
+        /* stalls until 500ms before the deadline, so none covers the crossing itself */
+        run_ms(4400, true);
+        run_ms(1500, false);
+        stub_set_gpio_in(KEY_PIN, 1);
+        run_ms(500, true);
+
+        TEST_CHECK_EQ(sg_long_cnt, 1);
+        TEST_CHECK_EQ(sg_short_cnt, 0);
+        TEST_CHECK(sg_long_ms - press_ms >= DEBOUNCE_MS + 5000);
+        late = sg_long_ms - press_ms - DEBOUNCE_MS - 5000;
+        TEST_CHECK(late <= SCAN_MS);
+        if (late > late_max) {
+            late_max = late;
+        }
+        /* the 1s timer keeps its phase through the stalls: one call per period, none lost */
+        TEST_CHECK_EQ(sg_period_cnt, app_timer_get_ms() / 1000);
+    }
+    printf("long press with stalls: at most %ums late\n", late_max);
+}
+
+/**
+ * @brief a stall inside a short press still gives one short press on the release
+ */
+static void test_short_press_with_stall(void)
+{
+    start_key(1);
+    run_ms(100, false);
+    stub_set_gpio_in(KEY_PIN, 0);
+    run_ms(DEBOUNCE_MS + 10, false);
+    stub_delay_ms(300);                 /* one stall */
+    run_ms(1, false);
+    stub_set_gpio_in(KEY_PIN, 1);
+    run_ms(200, false);
+    TEST_CHECK_EQ(sg_short_cnt, 1);
+    TEST_CHECK_EQ(sg_long_cnt, 0);
+}
+
+int main(void)
+{
+    test_long_press_with_stalls();
+    test_short_press_with_stall();
+    return test_result("test_key_timing");
+}
@@ -0,0 +1,205 @@
+/**
+ * @file test_led.c
+ * @brief host test of the led pattern engine: solid, blink, N-blink and breathe on the stub GPIO
+ *        port and PWM, one out register write per port per step, steps run from the timer deadline
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_timer.h"
+#include "tuya_app_driver_led.h"
+
+#define PORT_B          (P_LED_RED >> 8)            /* red and orange */
+#define PORT_D          (P_LED_GREEN >> 8)
+#define PWM_CYCLE       (1000 * CLOCK_SYS_CLOCK_1US)
+#define EDGE_MAX        32
+
+/* the out register as the pin sees it, without counting an access */
+#define IS_LED_ON(pin)  ((stub_regs[0x10 + ((pin) >> 8)] & (uint8_t)(pin)) == 0)
+
+/* what the leds did */
+typedef struct {
+    uint32_t access_max[STUB_GPIO_PORT_NUM];   /* most out register accesses in a loop pass */
+    uint32_t edge_ms[EDGE_MAX];                 /* green on / off changes */
+    uint32_t edge_num;
+    uint32_t passes;                            /* loop passes woken by the timer deadline */
+} LED_RUN_T;
+
+static LED_RUN_T sg_run;
+static uint32_t sg_start_ms;
+
+static const LED_PATTERN_T sg_solid = {LED_PATTERN_SOLID, 0, 0, 0, 0};
+static const LED_PATTERN_T sg_n_blink = {LED_PATTERN_N_BLINK, 3, 100, 100, 1000};
+static const LED_PATTERN_T sg_breathe = {LED_PATTERN_BREATHE, 0, 1000, 1000, 0};
+
+/**
+ * @brief fresh timers and leds, all off
+ */
+static void start_led(void)
+{
+    stub_reset();
+    app_timer_init();
+    led_init();
+    memset(&sg_run, 0, sizeof(sg_run));
+    memset(stub_gpio_out_access_cnt, 0, sizeof(stub_gpio_out_access_cnt));
+    sg_start_ms = app_timer_get_ms();
+}
+
+/**
+ * @brief tickless main loop: sleeps until the timer deadline, counts the accesses of each pass
+ *        and the green edges
+ */
+static void run_ms(uint32_t ms)
+{
+    uint32_t access[STUB_GPIO_PORT_NUM];
+    uint32_t end = app_timer_get_ms() + ms;
+    uint32_t sleep, left;
+    uint8_t green = IS_LED_ON(P_LED_GREEN);
+    uint8_t i;
+
+    sleep = app_timer_run();
+    while ((left = end - app_timer_get_ms()) != 0) {
+        if (sleep > left) {
+            stub_delay_ms(left);
+            sleep = app_timer_run();
+            continue;
+        }
+        stub_delay_ms(sleep);
+        memcpy(access, stub_gpio_out_access_cnt, sizeof(access));
+        sleep = app_timer_run();
+        sg_run.passes++;
+        for (i = 0; i < STUB_GPIO_PORT_NUM; i++) {
+            if (stub_gpio_out_access_cnt[i] - access[i] > sg_run.access_max[i]) {
+                sg_run.access_max[i] = stub_gpio_out_access_cnt[i] - access[i];
+            }
+        }
+        if ((IS_LED_ON(P_LED_GREEN) != green) && (sg_run.edge_num < EDGE_MAX)) {
+            green = IS_LED_ON(P_LED_GREEN);
+            sg_run.edge_ms[sg_run.edge_num++] = app_timer_get_ms() - sg_start_ms;
+        }
+    }
+}
+
+/**
+ * @brief on and off without a pattern: a write only for a change, solid runs no timer
+ */
+static void test_solid(void)
+{
+    start_led();
+    set_led(LED_GREEN, ON);
+    TEST_CHECK(IS_LED_ON(P_LED_GREEN));
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_D], 2);
+    set_led(LED_GREEN, ON);
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_D], 2);
+
+    set_led_pattern(LED_RED, &sg_solid);
+    TEST_CHECK(IS_LED_ON(P_LED_RED));
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_B], 2);
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+    run_ms(10000);
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_B], 2);
+
+    /* back to the base set while the pattern ran */
+    set_led(LED_RED, OFF);
+    TEST_CHECK(IS_LED_ON(P_LED_RED));
+    set_led_pattern(LED_RED, NULL);
+    TEST_CHECK(!IS_LED_ON(P_LED_RED));
+}
+
+/**
+ * @brief red and orange blink on one port: one read-modify-write of it per step, the steps on
+ *        the 200ms deadlines and the loop idle between them
+ */
+static void test_blink_one_write(void)
+{
+    uint32_t access;
+
+    start_led();
+    set_led_pattern(LED_RED, &g_led_pattern_twinkle);
+    set_led_pattern(LED_ORANGE, &g_led_pattern_twinkle);
+    TEST_CHECK(IS_LED_ON(P_LED_RED) && IS_LED_ON(P_LED_ORANGE));
+    TEST_CHECK_EQ(app_timer_run(), 200);
+
+    access = stub_gpio_out_access_cnt[PORT_B];
+    run_ms(2000);
+    printf("led, 2 leds blinking on one port for 2s: %u out register writes in %u loop passes, each woken by a step deadline\n",
+           (stub_gpio_out_access_cnt[PORT_B] - access) / 2, sg_run.passes);
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_B] - access, 2 * 10);
+    TEST_CHECK_EQ(sg_run.access_max[PORT_B], 2);
+    TEST_CHECK_EQ(sg_run.passes, 10);
+    TEST_CHECK(IS_LED_ON(P_LED_RED) && IS_LED_ON(P_LED_ORANGE));
+
+    /* stopped, the timer goes with the last pattern */
+    set_led_pattern(LED_RED, NULL);
+    set_led_pattern(LED_ORANGE, NULL);
+    TEST_CHECK_EQ(app_timer_run(), APP_TIMER_NO_DEADLINE);
+}
+
+/**
+ * @brief 3 blinks of 100ms, then 1s off, edge by edge
+ */
+static void test_n_blink(void)
+{
+    const uint32_t edge[] = {100, 200, 300, 400, 500, 1500, 1600, 1700, 1800, 1900, 2000, 3000};
+    uint32_t i;
+
+    start_led();
+    set_led_pattern(LED_GREEN, &sg_n_blink);
+    TEST_CHECK(IS_LED_ON(P_LED_GREEN));
+    run_ms(3050);
+    TEST_CHECK_EQ(sg_run.edge_num, sizeof(edge) / sizeof(edge[0]));
+    for (i = 0; (i < sg_run.edge_num) && (i < sizeof(edge) / sizeof(edge[0])); i++) {
+        TEST_CHECK_EQ(sg_run.edge_ms[i], edge[i]);
+    }
+    TEST_CHECK_EQ(sg_run.passes, sizeof(edge) / sizeof(edge[0]));
+}
+
+/**
+ * @brief breathe runs on PWM: no GPIO write, dark to full on in on_time and back in off_time
+ */
+static void test_breathe(void)
+{
+    uint16_t cmp_min = 0xFFFF;
+    uint32_t ms, changes = 0;
+    uint16_t cmp;
+
+    start_led();
+    set_led_pattern(LED_GREEN, &sg_breathe);
+    TEST_CHECK(get_led_pwm());
+    TEST_CHECK(stub_pwm_on[PWM3_ID]);
+    TEST_CHECK_EQ(stub_pwm_cmp[PWM3_ID], PWM_CYCLE);
+    cmp = stub_pwm_cmp[PWM3_ID];
+    for (ms = 0; ms < 2000; ms += 10) {
+        run_ms(10);
+        if (stub_pwm_cmp[PWM3_ID] != cmp) {
+            cmp = stub_pwm_cmp[PWM3_ID];
+            changes++;
+        }
+        if (cmp < cmp_min) {
+            cmp_min = cmp;
+        }
+        if (ms + 10 == 1000) {
+            TEST_CHECK_EQ(cmp, 0);              /* full on, low is on */
+        }
+    }
+    TEST_CHECK_EQ(cmp_min, 0);
+    TEST_CHECK_EQ(cmp, PWM_CYCLE);
+    TEST_CHECK(changes >= 2000 / 20 - 10);
+    TEST_CHECK_EQ(sg_run.passes, 2000 / 20);
+    TEST_CHECK_EQ(stub_gpio_out_access_cnt[PORT_D], 0);
+
+    /* back to GPIO, off as set */
+    set_led_pattern(LED_GREEN, NULL);
+    TEST_CHECK(!get_led_pwm());
+    TEST_CHECK(!stub_pwm_on[PWM3_ID]);
+    TEST_CHECK(!IS_LED_ON(P_LED_GREEN));
+}
+
+int main(void)
+{
+    test_solid();
+    test_blink_one_write();
+    test_n_blink();
+    test_breathe();
+    return test_result("test_led");
+}
@@ -0,0 +1,338 @@
+/**
+ * @file test_ntc.c
+ * @brief host test of the NTC driver: table lookup and the median + IIR filter
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_common.h"
+#include "tuya_app_driver_ntc.h"
+#include "ntc_table.h"
+
+#define TEMP_TABLE_SIZE     120
+#define TICK_NUM            600         /* 20min of samples every 2s */
+
+extern const uint16_t vol_data_of_temp[TEMP_TABLE_SIZE];
+extern const uint8_t temp_data_of_vol[];
+
+/* unfiltered build of the same driver, ntc_raw.c */
+void raw_ntc_adc_init(void);
+uint8_t raw_get_cur_temp(void);
+uint16_t raw_get_cur_temp_x10(void);
+
+/* synthetic ADC trace, not recorded on a kettle: true voltage of the tick plus made-up noise and spikes */
+static uint32_t sg_true_mv;
+static uint32_t sg_seed;
+static uint16_t sg_fixed_mv;
+
+static uint32_t get_rand(void)
+{
+    sg_seed = sg_seed * 1103515245u + 12345u;
+    return (sg_seed >> 16) & 0x7FFF;
+}
+
+/**
+ * @brief noisy ADC sample: about 6mV rms noise, 3% spikes of 200 ~ 400mV; picked to stand for
+ *        relay and radio bursts, not measured
+ */
+static uint32_t get_noisy_sample(void)
+{
+    int32_t mv;
+
+    mv = (int32_t)sg_true_mv + (int32_t)(get_rand() % 11 + get_rand() % 11 + get_rand() % 11 + get_rand() % 11) - 20;
+    if (get_rand() % 100 < 3) {
+        mv += (int32_t)((get_rand() & 1) ? 1 : -1) * (int32_t)(200 + get_rand() % 200);
+    }
+    return (mv < 0) ? 0 : (uint32_t)mv;
+}
+
+static uint32_t get_fixed_sample(void)
+{
+    return sg_fixed_mv;
+}
+
+/**
+ * @brief voltage of a temperature, interpolated in the NTC table
+ * @param[in] temp: temperature (0.1 degree)
+ */
+static uint32_t get_temp_mv(uint16_t temp)
+{
+    uint16_t i = temp / 10;
+
+    return vol_data_of_temp[i] + (vol_data_of_temp[i+1] - vol_data_of_temp[i]) * (temp % 10) / 10;
+}
+
+/**
+ * @brief reference lookup, as the linear search before the direct-index table: nearest entry, a tie goes up
+ */
+static uint8_t ref_vol_to_temp(uint16_t vol)
+{
+    uint8_t i;
+
+    if (vol <= vol_data_of_temp[0]) {
+        return 0;
+    }
+    for (i = 0; i < TEMP_TABLE_SIZE - 1; i++) {
+        if (vol <= vol_data_of_temp[i+1]) {
+            return ((vol - vol_data_of_temp[i]) < (vol_data_of_temp[i+1] - vol)) ? i : (i + 1);
+        }
+    }
+    return TEMP_TABLE_SIZE - 1;
+}
+
+/**
+ * @brief reference 0.1 degree lookup: linear interpolation between the entries around vol, rounded
+ */
+static uint16_t ref_vol_to_temp_x10(uint16_t vol)
+{
+    uint8_t i;
+    uint16_t diff;
+
+    if (vol <= vol_data_of_temp[0]) {
+        return 0;
+    }
+    for (i = 0; i < TEMP_TABLE_SIZE - 1; i++) {
+        if (vol < vol_data_of_temp[i+1]) {
+            diff = vol_data_of_temp[i+1] - vol_data_of_temp[i];
+            return i * 10 + ((vol - vol_data_of_temp[i]) * 10 + (diff >> 1)) / diff;
+        }
+    }
+    return (TEMP_TABLE_SIZE - 1) * 10;
+}
+
+/**
+ * @brief the 8mV direct-index table is the one gen_ntc_table makes from the voltage table
+ */
+static void test_table_of_vol(void)
+{
+    uint8_t temp_of_vol[NTC_TABLE_VOL_MAX];
+    uint16_t num, i;
+    uint32_t diff = 0;
+
+    num = ntc_table_make_temp_of_vol(vol_data_of_temp, temp_of_vol);
+    TEST_CHECK_EQ(num, 323);
+    for (i = 0; i < num; i++) {
+        if (temp_data_of_vol[i] != temp_of_vol[i]) {
+            diff++;
+        }
+    }
+    TEST_CHECK_EQ(diff, 0);
+}
+
+/**
+ * @brief the voltage table follows the NTC curve of the part
+ */
+static void test_table_model(void)
+{
+    double err, err_max = 0;
+    uint16_t i;
+
+    for (i = 0; i < TEMP_TABLE_SIZE; i++) {
+        err = ntc_table_get_mv(i) - vol_data_of_temp[i];
+        if (err < 0) {
+            err = -err;
+        }
+        if (err > err_max) {
+            err_max = err;
+        }
+    }
+    printf("ntc table, vol_data_of_temp against R25 %.0fK, B25/50 %.0f, B25/100 %.0f: %.1f mV off at most\n",
+           NTC_R25_KOHM, NTC_B25_50, NTC_B25_100, err_max);
+    TEST_CHECK(err_max < NTC_TABLE_ERR_MV + 0.5);
+}
+
+/**
+ * @brief the table lookup gives the same temperature as the reference search for every voltage
+ */
+static void test_lookup_equivalence(void)
+{
+    uint32_t mv;
+    uint32_t diff = 0;
+
+    stub_reset();
+    stub_adc_sample = get_fixed_sample;
+    for (mv = 0; mv <= 3300; mv++) {
+        sg_fixed_mv = (uint16_t)mv;
+        if (raw_get_cur_temp() != ref_vol_to_temp(mv)) {
+            diff++;
+        }
+    }
+    TEST_CHECK_EQ(diff, 0);
+}
+
+/**
+ * @brief the 0.1 degree lookup is the interpolation of the reference for every voltage, rises with
+ *        the voltage and rounds to the whole degree lookup
+ */
+static void test_lookup_x10(void)
+{
+    uint32_t mv;
+    uint32_t diff = 0, fall = 0, far = 0;
+    uint16_t temp, whole, last = 0;
+
+    stub_reset();
+    stub_adc_sample = get_fixed_sample;
+    for (mv = 0; mv <= 3300; mv++) {
+        sg_fixed_mv = (uint16_t)mv;
+        /* no IIR in the raw build: each call is one conversion */
+        temp = raw_get_cur_temp_x10();
+        if (temp != ref_vol_to_temp_x10(mv)) {
+            diff++;
+        }
+        if (temp < last) {
+            fall++;
+        }
+        whole = raw_get_cur_temp() * 10;
+        if ((temp + 5 < whole) || (temp > whole + 5)) {
+            far++;
+        }
+        last = temp;
+    }
+    TEST_CHECK_EQ(diff, 0);
+    TEST_CHECK_EQ(fall, 0);
+    TEST_CHECK_EQ(far, 0);
+}
+
+/**
+ * @brief bang-bang keep warm on a synthetic trace: relay toggles and lack water faults (>= 105 degree) seen
+ * @param[in] get_temp_x10: temperature source under test
+ * @param[in] temp_of_tick: true temperature of each tick (0.1 degree)
+ * @param[out] toggle: relay toggles
+ * @param[out] fault: ticks read at or above 105 degree
+ */
+static void replay_trace(uint16_t (*get_temp_x10)(void), const uint16_t *temp_of_tick,
+                         uint32_t *toggle, uint32_t *fault)
+{
+    uint16_t temp;
+    bool relay = OFF;
+    bool next;
+    uint32_t i;
+
+    *toggle = 0;
+    *fault = 0;
+    sg_seed = 1;
+    stub_adc_sample = get_noisy_sample;
+    for (i = 0; i < TICK_NUM; i++) {
+        sg_true_mv = get_temp_mv(temp_of_tick[i]);
+        temp = get_temp_x10();
+        if (temp >= 1050) {
+            (*fault)++;
+        }
+        /* keep warm at 60 degree, as kettle_mode_keep_warm2() without PI */
+        if (temp > 600) {
+            next = OFF;
+        } else if (temp < 570) {
+            next = ON;
+        } else {
+            next = OFF;
+        }
+        if (next != relay) {
+            (*toggle)++;
+            relay = next;
+        }
+    }
+}
+
+/**
+ * @brief the filter takes out the spurious relay toggles and fault reads of the noisy traces;
+ *        the traces are synthetic, a flat and a ramp temperature with the noise above, so this shows
+ *        the filter against that noise model, not against a recording of the real ADC
+ */
+static void test_filter_replay(void)
+{
+    static uint16_t keep_warm[TICK_NUM], boil[TICK_NUM];
+    uint32_t raw_toggle, raw_fault, toggle, fault;
+    uint32_t i;
+
+    /* made up: holding in the keep warm band, then boiling after a heat-up from 60 degree */
+    for (i = 0; i < TICK_NUM; i++) {
+        keep_warm[i] = 585;
+        boil[i] = (i < 300) ? (600 + i * 400 / 300) : 1000;
+    }
+    stub_reset();
+
+    replay_trace(raw_get_cur_temp_x10, keep_warm, &raw_toggle, &raw_fault);
+    replay_trace(get_cur_temp_x10, keep_warm, &toggle, &fault);
+    printf("synthetic trace, keep warm at 58.5: relay toggles raw %u, filtered %u\n", raw_toggle, toggle);
+    TEST_CHECK(raw_toggle > 0);
+    TEST_CHECK(toggle * 4 <= raw_toggle);
+
+    replay_trace(raw_get_cur_temp_x10, boil, &raw_toggle, &raw_fault);
+    replay_trace(get_cur_temp_x10, boil, &toggle, &fault);
+    printf("synthetic trace, boil at 100.0: fault reads raw %u, filtered %u\n", raw_fault, fault);
+    TEST_CHECK(raw_fault > 0);
+    TEST_CHECK_EQ(fault, 0);
+}
+
+/**
+ * @brief the filtered reading follows a real step within a few samples
+ */
+static void test_filter_step(void)
+{
+    uint16_t temp = 0;
+    uint8_t i;
+
+    stub_reset();
+    stub_adc_sample = get_fixed_sample;
+    sg_fixed_mv = (uint16_t)get_temp_mv(500);
+    for (i = 0; i < 4; i++) {
+        temp = get_cur_temp_x10();
+    }
+    TEST_CHECK_EQ(temp, 500);
+    sg_fixed_mv = (uint16_t)get_temp_mv(800);
+    for (i = 0; i < 8; i++) {
+        temp = get_cur_temp_x10();
+    }
+    TEST_CHECK(temp >= 798);
+}
+
+/**
+ * @brief the ADC is set up on the first reading and on the first one after a session reset
+ *        (a suspend) only, the resets themselves cost nothing
+ */
+static void test_adc_session(void)
+{
+    uint32_t reset_cnt;
+    uint8_t i;
+
+    stub_reset();
+    stub_adc_sample = get_fixed_sample;
+    sg_fixed_mv = (uint16_t)get_temp_mv(250);
+    ntc_adc_session_reset();
+    for (i = 0; i < 100; i++) {
+        ntc_adc_session_reset();
+        get_cur_temp_x10();
+    }
+    reset_cnt = stub_adc_init_cnt;
+
+    stub_adc_init_cnt = 0;
+    for (i = 0; i < 100; i++) {
+        get_cur_temp_x10();
+    }
+    printf("ntc adc, 100 readings: %u adc_init calls, %u with a suspend before each\n",
+           stub_adc_init_cnt, reset_cnt);
+    TEST_CHECK_EQ(reset_cnt, 100);
+    TEST_CHECK_EQ(stub_adc_init_cnt, 0);
+
+    for (i = 0; i < 3; i++) {
+        ntc_adc_session_reset();
+    }
+    TEST_CHECK_EQ(stub_adc_init_cnt, 0);
+    get_cur_temp_x10();
+    get_cur_temp_x10();
+    TEST_CHECK_EQ(stub_adc_init_cnt, 1);
+}
+
+int main(void)
+{
+    raw_ntc_adc_init();
+    ntc_adc_init();
+    test_table_of_vol();
+    test_table_model();
+    test_lookup_equivalence();
+    test_lookup_x10();
+    test_filter_step();
+    test_filter_replay();
+    test_adc_session();
+    return test_result("test_ntc");
+}
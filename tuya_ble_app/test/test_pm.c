@@ -0,0 +1,357 @@
+/**
+ * @file test_pm.c
+ * @brief host simulation of the tickless idle: the kettle app with its drivers, app_exe() and the
+ *        suspends of the stack, over a day of idle and with the UART link talking;
+ *        built with the uart handler source to start each run with the link down
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_smart_kettle.h"
+#include "tuya_app_pm.h"
+#include "tuya_app_driver_relay.h"
+#include "../src/sdk/tuya_uart_common_handler.c"
+
+#define TICK_MS         CLOCK_16M_SYS_TIMER_CLK_1MS
+#define PASS_TICK       (100 * CLOCK_16M_SYS_TIMER_CLK_1US)     /* a main loop pass: 100us awake */
+#define DAY_MS          (24 * 3600 * 1000u)
+#define RX_AWAKE_MS     5000                                    /* UART_RX_AWAKE_MS */
+#define EVT_MAX         2000
+#define KEY_PRESS_MS    200
+
+/* a frame the MCU or the factory tester sends */
+typedef struct {
+    uint32_t ms;                    /* ms since power-on */
+    uint8_t head;                   /* 0x55-MCU 0x66-factory test */
+    uint8_t lost;                   /* sent while the chip was suspended */
+} RX_EVT_T;
+
+/* what a run did */
+typedef struct {
+    uint32_t passes;                /* main loop passes */
+    uint32_t wakes;                 /* suspends ended */
+    uint32_t late;                  /* wakes after the deadline */
+    uint32_t wasted;                /* wakes before the deadline with nothing to do */
+    uint32_t radio_wakes;           /* wakes of the stack for a connection event */
+    uint64_t sleep_tick;            /* time suspended */
+    uint32_t first_sleep_ms;        /* time of the first suspend */
+    uint32_t samples;               /* temperature readings */
+    uint32_t sample_gap_max;        /* ms, longest time between readings */
+    uint32_t rx_num;                /* frames handled */
+    uint32_t rx_lost;
+    uint32_t key_reads;             /* key pin reads after the first suspend */
+    uint32_t awake_passes;          /* passes after the first suspend without a suspend */
+    uint32_t relay_ms;              /* relay on, 0-never */
+} PM_RUN_T;
+
+static uint64_t sg_sim_tick;       /* ticks since power-on, stub_tick wraps every 268s */
+static uint32_t sg_conn_ms;         /* connection interval, 0-the stack wakes for the app only */
+static uint8_t sg_radio_woke;
+static RX_EVT_T sg_evt[EVT_MAX];
+static uint32_t sg_evt_num;
+static uint32_t sg_evt_next;        /* next frame to deliver */
+static PM_RUN_T sg_run;
+static uint32_t sg_sample_tick;
+static uint32_t sg_seed;
+static uint32_t sg_key_ms;          /* boil key press, 0-none */
+
+static uint32_t get_rand(void)
+{
+    sg_seed = sg_seed * 1103515245u + 12345u;
+    return (sg_seed >> 16) & 0x7FFF;
+}
+
+/**
+ * @brief stand-in ADC: a cold kettle, one reading is NTC_SAMPLE_NUM samples at the same tick
+ */
+static uint32_t sample_adc(void)
+{
+    uint32_t gap;
+
+    if ((sg_run.samples == 0) || (stub_tick != sg_sample_tick)) {
+        gap = (stub_tick - sg_sample_tick) / TICK_MS;
+        if ((sg_run.samples != 0) && (gap > sg_run.sample_gap_max)) {
+            sg_run.sample_gap_max = gap;
+        }
+        sg_run.samples++;
+        sg_sample_tick = stub_tick;
+    }
+    return 400;                     /* about 20 degree */
+}
+
+/**
+ * @brief sleep to wakeup_tick or the next connection event, the frames sent meanwhile are lost:
+ *        no rx wakes the chip up
+ */
+static uint32_t sleep_to(uint32_t wakeup_tick)
+{
+    uint32_t i;
+    uint64_t end = sg_sim_tick + (uint32_t)(wakeup_tick - stub_tick);
+    uint64_t radio;
+
+    if ((sg_conn_ms != 0) && (stub_ll_state != BLS_LINK_STATE_IDLE)) {
+        radio = (sg_sim_tick / (sg_conn_ms * TICK_MS) + 1) * sg_conn_ms * TICK_MS;
+        if (radio < end) {
+            wakeup_tick -= (uint32_t)(end - radio);
+            end = radio;
+            sg_radio_woke = 1;
+        }
+    }
+
+    /* a key press ends the suspend as a pad wake-up */
+    if ((sg_key_ms != 0) && ((uint64_t)sg_key_ms * TICK_MS > sg_sim_tick) && ((uint64_t)sg_key_ms * TICK_MS < end)) {
+        wakeup_tick -= (uint32_t)(end - (uint64_t)sg_key_ms * TICK_MS);
+        end = (uint64_t)sg_key_ms * TICK_MS;
+        sg_radio_woke = 0;
+        stub_set_gpio_in(P_KEY_BOIL, 0);
+    }
+
+    if (sg_run.first_sleep_ms == 0) {
+        sg_run.first_sleep_ms = sg_sim_tick / TICK_MS;
+    }
+    for (i = sg_evt_next; (i < sg_evt_num) && ((uint64_t)sg_evt[i].ms * TICK_MS < end); i++) {
+        sg_evt[i].lost = 1;
+    }
+    sg_run.sleep_tick += end - sg_sim_tick;
+    return wakeup_tick;
+}
+
+static void count_factory(u8 *p_data, u16 len)
+{
+    sg_run.rx_num++;
+}
+
+static void count_send(u8 *p_data, u16 len)
+{
+    /* the 8 byte response to a status frame */
+    if ((len == 8) && (p_data[3] == TY_SEND_STATUS_TYPE)) {
+        sg_run.rx_num++;
+    }
+}
+
+/**
+ * @brief deliver the frames due, as the uart irq would
+ */
+static void deliver_frames(void)
+{
+    uint8_t frame[] = {0x55, 0xAA, 0x00, TY_SEND_STATUS_TYPE, 0x00, 0x05, 0x65, 0x01, 0x00, 0x01, 0x00, 0x00};
+    RX_EVT_T *evt;
+
+    while ((sg_evt_next < sg_evt_num) && ((uint64_t)sg_evt[sg_evt_next].ms * TICK_MS <= sg_sim_tick)) {
+        evt = &sg_evt[sg_evt_next++];
+        if (evt->lost) {
+            sg_run.rx_lost++;
+            continue;
+        }
+        frame[0] = evt->head;
+        frame[sizeof(frame) - 1] = check_sum(frame, sizeof(frame) - 1);
+        tuya_uart_rx_handler(frame, sizeof(frame));
+    }
+}
+
+/**
+ * @brief the boil key, pressed at sg_key_ms for KEY_PRESS_MS: pressed here if no suspend ended
+ *        at it, released here
+ */
+static void press_key(void)
+{
+    if (sg_key_ms == 0) {
+        return;
+    }
+    if (sg_sim_tick >= (uint64_t)(sg_key_ms + KEY_PRESS_MS) * TICK_MS) {
+        stub_set_gpio_in(P_KEY_BOIL, 1);
+    } else if (sg_sim_tick >= (uint64_t)sg_key_ms * TICK_MS) {
+        stub_set_gpio_in(P_KEY_BOIL, 0);
+    }
+}
+
+/**
+ * @brief run the app for ms as the SDK main loop does: the stack, app_exe(), then the suspend
+ * @param[in] ms: time to run
+ */
+static void run_ms(uint32_t ms)
+{
+    uint64_t end = sg_sim_tick + (uint64_t)ms * TICK_MS;
+    uint32_t start, deadline, sleep_ms, suspend_cnt, reads;
+
+    while (sg_sim_tick < end) {
+        deliver_frames();
+        press_key();
+        start = stub_tick;
+        suspend_cnt = stub_suspend_cnt;
+        reads = stub_gpio_read_cnt;
+        sg_radio_woke = 0;
+        /* app_exe() */
+        sleep_ms = tuya_app_kettle_loop();
+        if (sg_run.first_sleep_ms != 0) {
+            sg_run.key_reads += stub_gpio_read_cnt - reads;
+        }
+        if ((sg_run.relay_ms == 0) && get_relay()) {
+            sg_run.relay_ms = sg_sim_tick / TICK_MS;
+        }
+        stub_tick += PASS_TICK;
+        if (tuya_uart_tx_process() != 0) {
+            sleep_ms = 0;
+        }
+        app_pm_idle(sleep_ms);
+        if (stub_ll_state != BLS_LINK_STATE_IDLE) {
+            stub_stack_suspend();
+        }
+        sg_run.passes++;
+        sg_sim_tick += (uint32_t)(stub_tick - start);
+        if (stub_suspend_cnt == suspend_cnt) {
+            if (sg_run.first_sleep_ms != 0) {
+                sg_run.awake_passes++;
+            }
+            continue;
+        }
+        sg_run.wakes++;
+        if (sg_radio_woke) {
+            sg_run.radio_wakes++;
+            continue;
+        }
+        if (sleep_ms > APP_PM_SLEEP_MAX) {
+            continue;                           /* woken on purpose before a far deadline */
+        }
+        deadline = start + sleep_ms * TICK_MS;
+        if ((int32_t)(stub_tick - deadline) > TICK_MS) {
+            sg_run.late++;
+        } else if ((int32_t)(deadline - stub_tick) > TICK_MS) {
+            sg_run.wasted++;
+        }
+    }
+}
+
+/**
+ * @brief power on the kettle, cold and idle, with frames at the ticks in sg_evt
+ * @param[in] ll_state: link layer state, BLS_LINK_STATE_IDLE-the app calls cpu_sleep_wakeup()
+ */
+static void start_kettle(uint8_t ll_state)
+{
+    stub_reset();
+    stub_ll_state = ll_state;
+    stub_adc_sample = sample_adc;
+    stub_wakeup = sleep_to;
+    stub_uart_factory = count_factory;
+    stub_uart_send = count_send;
+    uart_link_active = 0;
+    uart_rx_len = 0;
+    memset(&sg_run, 0, sizeof(sg_run));
+    sg_sim_tick = 0;
+    sg_evt_next = 0;
+    sg_key_ms = 0;
+    tuya_app_kettle_init();
+    app_pm_init();
+}
+
+/**
+ * @brief a day idle: every wake is a deadline, none is missed, the readings keep their period;
+ *        the ADC is set up again on the first reading after a wake, not on the wake
+ * @param[in] ll_state: link layer state
+ * @param[in] conn_ms: connection interval, 0-none
+ */
+static void test_idle_day(uint8_t ll_state, uint32_t conn_ms, const char *name)
+{
+    sg_evt_num = 0;
+    sg_conn_ms = conn_ms;
+    start_kettle(ll_state);
+    run_ms(DAY_MS);
+    printf("pm, 24h idle, %s: %u loop passes, %u wakes, %u readings, %u adc inits, awake %.1f s\n", name,
+           sg_run.passes, sg_run.wakes, sg_run.samples, stub_adc_init_cnt,
+           (double)(sg_sim_tick - sg_run.sleep_tick) / (1000.0 * TICK_MS));
+    TEST_CHECK_EQ(sg_run.late, 0);
+    TEST_CHECK_EQ(sg_run.wasted, 0);
+    TEST_CHECK(sg_run.first_sleep_ms >= RX_AWAKE_MS);
+    TEST_CHECK(sg_run.first_sleep_ms < RX_AWAKE_MS + 20);
+    TEST_CHECK(sg_run.samples >= DAY_MS / 10000);
+    TEST_CHECK(sg_run.samples < DAY_MS / 10000 + 100);
+    TEST_CHECK(sg_run.sample_gap_max <= 10000 + 1);
+    /* awake only for the power-on window and a pass per wake */
+    TEST_CHECK(sg_run.wakes - sg_run.radio_wakes <= sg_run.samples);
+    TEST_CHECK(sg_run.passes < RX_AWAKE_MS * 10 + 2 * sg_run.wakes + 1000);
+    /* one at power-on, then one per reading after a suspend */
+    TEST_CHECK(stub_adc_init_cnt <= sg_run.samples);
+    TEST_CHECK(stub_adc_init_cnt + 10 >= sg_run.samples);
+    if (conn_ms != 0) {
+        TEST_CHECK(sg_run.radio_wakes + sg_run.samples >= DAY_MS / conn_ms);
+    }
+    /* the keys are read after a pass that stayed awake only, not per wake */
+    printf("pm, 24h idle, %s: %u key pin reads after the power-on window, %u wakes\n", name,
+           sg_run.key_reads, sg_run.wakes);
+    TEST_CHECK(sg_run.key_reads <= 2 * sg_run.awake_passes);
+    TEST_CHECK(sg_run.key_reads * 100 < sg_run.wakes);
+}
+
+/**
+ * @brief a boil key press in the middle of a 10s suspend wakes the chip up and starts the boil
+ * @param[in] ll_state: link layer state
+ */
+static void test_key_wake(uint8_t ll_state, const char *name)
+{
+    sg_evt_num = 0;
+    sg_conn_ms = 0;
+    start_kettle(ll_state);
+    sg_key_ms = 60000 + 3333;
+    run_ms(70000);
+    printf("pm, %s: boil key pressed in a suspend, relay on after %u ms\n", name, sg_run.relay_ms - sg_key_ms);
+    TEST_CHECK(sg_run.relay_ms >= sg_key_ms);
+    TEST_CHECK(sg_run.relay_ms <= sg_key_ms + 100);
+    TEST_CHECK(get_relay());
+    set_relay(OFF);                             /* relay_init() does not reset the state of the next run */
+}
+
+/**
+ * @brief frames from power-on keep the chip awake while the link is up, none is lost
+ * @param[in] head: 0x55-MCU 0x66-factory test
+ * @param[in] gap_max: longest ms between frames
+ */
+static void test_link_awake(uint8_t head, uint32_t gap_max, uint32_t ms)
+{
+    uint32_t t = 300;
+
+    sg_seed = head;
+    for (sg_evt_num = 0; (sg_evt_num < EVT_MAX) && (t < ms); sg_evt_num++) {
+        sg_evt[sg_evt_num].ms = t;
+        sg_evt[sg_evt_num].head = head;
+        sg_evt[sg_evt_num].lost = 0;
+        t += 1 + get_rand() % gap_max;
+    }
+    sg_conn_ms = 0;
+    start_kettle(BLS_LINK_STATE_CONN);
+    run_ms(ms);
+    printf("pm, %s link for %u min: %u of %u frames handled, %u suspends\n", (head == 0x66) ? "factory test" : "MCU",
+           ms / 60000, sg_run.rx_num, sg_evt_num, sg_run.wakes);
+    TEST_CHECK(sg_evt_num > 10);
+    TEST_CHECK_EQ(sg_run.rx_lost, 0);
+    TEST_CHECK_EQ(sg_run.rx_num, sg_evt_num);
+    TEST_CHECK_EQ(sg_run.wakes, 0);
+}
+
+/**
+ * @brief without the link the chip suspends after the power-on window, a frame sent then is lost
+ */
+static void test_link_down(void)
+{
+    sg_evt[0].ms = RX_AWAKE_MS + 10000;
+    sg_evt[0].head = 0x55;
+    sg_evt[0].lost = 0;
+    sg_evt_num = 1;
+    sg_conn_ms = 0;
+    start_kettle(BLS_LINK_STATE_CONN);
+    run_ms(RX_AWAKE_MS + 20000);
+    TEST_CHECK(sg_run.wakes > 0);
+    TEST_CHECK_EQ(sg_run.rx_lost, 1);
+}
+
+int main(void)
+{
+    test_idle_day(BLS_LINK_STATE_CONN, 0, "stack suspend");
+    test_idle_day(BLS_LINK_STATE_CONN, 1000, "stack suspend, 1s connection events");
+    test_idle_day(BLS_LINK_STATE_IDLE, 0, "cpu_sleep_wakeup");
+    test_key_wake(BLS_LINK_STATE_CONN, "stack suspend");
+    test_key_wake(BLS_LINK_STATE_IDLE, "cpu_sleep_wakeup");
+    test_link_awake(0x66, 3000, 10 * 60 * 1000);
+    test_link_awake(0x55, 30000, 60 * 60 * 1000);
+    test_link_down();
+    return test_result("test_pm");
+}
@@ -0,0 +1,191 @@
+/**
+ * @file test_sample.c
+ * @brief host benchmark of the adaptive temperature sample period against the fixed 2s period,
+ *        on the kettle model; built with the kettle source to hold its sample timer to 2s
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "driver_stub.h"
+#include "kettle_model.h"
+#include "tuya_app_driver_ntc.h"
+#include "../src/tuya_app_smart_kettle.c"
+
+#define LOOP_MS         10          /* main loop pass, the model step */
+#define HOUR_MS         (3600 * 1000)
+#define BOIL_NUM        12          /* boils, each at another phase of the 2s grid */
+
+/* what a run did */
+typedef struct {
+    uint32_t readings;
+    uint32_t late_ms;               /* relay on after the reading reached the cut point */
+    double overshoot;               /* degree, highest reading above the cut point */
+} SAMPLE_RUN_T;
+
+static uint8_t sg_fixed;            /* 1-sample every TIME_GET_TEMP as before */
+
+/**
+ * @brief run the model and the main loop; in fixed mode the sample timer is put back on the
+ *        2s grid after each pass
+ */
+static void run_ms(uint32_t ms)
+{
+    uint32_t deadline;
+
+    while (ms >= LOOP_MS) {
+        model_step(LOOP_MS);
+        stub_delay_ms(LOOP_MS);
+        tuya_app_kettle_loop();
+        deadline = sg_temp_sample_ms + TIME_GET_TEMP;
+        if (sg_fixed && app_timer_is_active(&sg_temp_timer) && (sg_temp_timer.deadline != deadline)) {
+            app_timer_start_at(&sg_temp_timer, deadline, 0, update_cur_temp);
+        }
+        ms -= LOOP_MS;
+    }
+}
+
+/**
+ * @brief a cold kettle with 1l of water and a threshold cut at 90 degree, where the water still
+ *        rises at the full rate: how late the sampler sees the crossing, not the plateau
+ */
+static void start_kettle(uint8_t fixed)
+{
+    stub_reset();
+    stub_driver_reset();
+    memset(&g_model, 0, sizeof(g_model));
+    model_fill(100.0, 1.0);
+    sg_fixed = fixed;
+    tuya_app_kettle_init();
+    sg_boil_point.point = TEMP_X10(90);
+    sg_boil_cut.lag = 0;                        /* cut at the point, as the sampler found it */
+    run_ms(LOOP_MS);
+}
+
+/**
+ * @brief an hour idle at room temperature
+ */
+static void run_idle(uint8_t fixed, SAMPLE_RUN_T *run)
+{
+    memset(run, 0, sizeof(SAMPLE_RUN_T));
+    start_kettle(fixed);
+    run_ms(HOUR_MS);
+    run->readings = stub_temp_read_cnt;
+}
+
+/**
+ * @brief a boil from cold: how long the relay stays on after the reading reached the point
+ * @param[in] phase_ms: time idle before the boil key
+ */
+static void run_boil_once(uint8_t fixed, uint32_t phase_ms, SAMPLE_RUN_T *run)
+{
+    uint16_t point;
+    uint32_t reached = 0, ms;
+
+    memset(run, 0, sizeof(SAMPLE_RUN_T));
+    start_kettle(fixed);
+    run_ms(phase_ms);
+    point = sg_boil_point.point;
+    stub_temp_read_cnt = 0;
+    key_boil_short_press_cb_fun();
+    for (ms = 0; ms < 2 * TIME_BOIL_OBSERVE + 600000; ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        if ((reached == 0) && (stub_temp_x10 >= point)) {
+            reached = ms;
+        }
+        if ((reached != 0) && (stub_relay == ON)) {
+            run->late_ms += LOOP_MS;
+        }
+        if (stub_temp_x10 > point + run->overshoot * 10) {
+            run->overshoot = (stub_temp_x10 - point) / 10.0;
+        }
+        if ((g_kettle.mode != MODE_BOIL) && (ms > reached + TIME_BOIL_OBSERVE)) {
+            break;
+        }
+    }
+    run->readings = stub_temp_read_cnt;
+}
+
+/**
+ * @brief boils from cold, each started at another phase of the sample grid: how long the relay
+ *        stays on after the reading reached the point, on average
+ */
+static void run_boil(uint8_t fixed, SAMPLE_RUN_T *run)
+{
+    SAMPLE_RUN_T boil;
+    uint32_t i;
+
+    memset(run, 0, sizeof(SAMPLE_RUN_T));
+    for (i = 0; i < BOIL_NUM; i++) {
+        run_boil_once(fixed, i * 170, &boil);
+        run->readings += boil.readings;
+        run->late_ms += boil.late_ms;
+        run->overshoot += boil.overshoot;
+    }
+    run->readings /= BOIL_NUM;
+    run->late_ms /= BOIL_NUM;
+    run->overshoot /= BOIL_NUM;
+}
+
+/**
+ * @brief an hour of keep warm 2 at 55 degree
+ */
+static void run_keep_warm(uint8_t fixed, SAMPLE_RUN_T *run)
+{
+    const uint8_t water_pure[] = {DP_ID_WATER_TYPE, DT_ENUM, 1, WATER_TYPE_PURE};
+    uint32_t ms;
+    double reading;
+
+    memset(run, 0, sizeof(SAMPLE_RUN_T));
+    start_kettle(fixed);
+    tuya_app_kettle_dp_data_handler(water_pure, sizeof(water_pure));
+    key_keep_short_press_cb_fun();
+    stub_temp_read_cnt = 0;
+    for (ms = 0; ms < HOUR_MS; ms += LOOP_MS) {
+        run_ms(LOOP_MS);
+        reading = g_model.sensor - TEMP_KEEP_WARM_DEFAULT;
+        if (reading > run->overshoot) {
+            run->overshoot = reading;
+        }
+    }
+    run->readings = stub_temp_read_cnt;
+}
+
+/**
+ * @brief fewer ADC readings idle, no more warm, a shorter late cut near the boil point
+ */
+static void test_sample_period(void)
+{
+    SAMPLE_RUN_T fixed, adaptive;
+
+    run_idle(1, &fixed);
+    run_idle(0, &adaptive);
+    printf("sample, 1h idle: %u readings (%u adc conversions) adaptive, %u (%u) fixed 2s\n",
+           adaptive.readings, adaptive.readings * NTC_SAMPLE_NUM, fixed.readings, fixed.readings * NTC_SAMPLE_NUM);
+    TEST_CHECK(adaptive.readings * 4 < fixed.readings);
+    TEST_CHECK(adaptive.readings >= HOUR_MS / TIME_GET_TEMP_IDLE);
+
+    run_boil(1, &fixed);
+    run_boil(0, &adaptive);
+    printf("sample, boil 1l cut at 90: relay on %.1f s after the reading reached the point, %.2f degree over, "
+           "%u readings adaptive; %.1f s, %.2f degree, %u readings fixed 2s\n",
+           adaptive.late_ms / 1000.0, adaptive.overshoot, adaptive.readings,
+           fixed.late_ms / 1000.0, fixed.overshoot, fixed.readings);
+    /* a noisy reading can sit under the point for a fast period more */
+    TEST_CHECK(adaptive.late_ms <= 2 * TIME_GET_TEMP_FAST + LOOP_MS);
+    TEST_CHECK(adaptive.late_ms * 2 < fixed.late_ms);
+    TEST_CHECK(adaptive.overshoot <= fixed.overshoot);
+
+    run_keep_warm(1, &fixed);
+    run_keep_warm(0, &adaptive);
+    printf("sample, 1h keep warm at 55: %u readings, %.2f degree over adaptive; %u, %.2f degree fixed 2s\n",
+           adaptive.readings, adaptive.overshoot, fixed.readings, fixed.overshoot);
+    /* the PI window holds the relay by time, it reads at the 2s period */
+    TEST_CHECK(adaptive.readings <= fixed.readings);
+    TEST_CHECK(adaptive.overshoot <= fixed.overshoot + 0.2);
+}
+
+int main(void)
+{
+    test_sample_period();
+    return test_result("test_sample");
+}
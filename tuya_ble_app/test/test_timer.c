@@ -0,0 +1,206 @@
+/**
+ * @file test_timer.c
+ * @brief host test and benchmark of the app software timers
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "tuya_app_timer.h"
+
+static APP_TIMER_T sg_timer[5];
+static uint32_t sg_fire_cnt[5];
+static uint32_t sg_fire_ms[5];
+static uint32_t sg_max_err;         /* ms, largest periodic error */
+static uint8_t sg_order[8];
+static uint8_t sg_order_num;
+
+static void record(uint8_t id)
+{
+    sg_fire_cnt[id]++;
+    sg_fire_ms[id] = app_timer_get_ms();
+    if (sg_order_num < sizeof(sg_order)) {
+        sg_order[sg_order_num++] = id;
+    }
+}
+
+static void timer0_cb(void)
+{
+    uint32_t now = app_timer_get_ms();
+    uint32_t err;
+
+    if (sg_fire_cnt[0] != 0) {
+        err = (now > sg_fire_ms[0] + 10) ? (now - sg_fire_ms[0] - 10) : (sg_fire_ms[0] + 10 - now);
+        if (err > sg_max_err) {
+            sg_max_err = err;
+        }
+    }
+    record(0);
+}
+
+static void timer1_cb(void)
+{
+    record(1);
+}
+
+static void timer2_cb(void)
+{
+    record(2);
+    app_timer_stop(&sg_timer[0]);
+}
+
+static void timer3_cb(void)
+{
+    record(3);
+    app_timer_start(&sg_timer[3], 100, 0, timer3_cb);      /* restart from its own callback */
+}
+
+static void timer4_cb(void)
+{
+    record(4);
+}
+
+static void reset_timer(uint32_t tick)
+{
+    stub_reset();
+    stub_tick = tick;
+    app_timer_init();
+    memset(sg_timer, 0, sizeof(sg_timer));
+    memset(sg_fire_cnt, 0, sizeof(sg_fire_cnt));
+    memset(sg_fire_ms, 0, sizeof(sg_fire_ms));
+    sg_max_err = 0;
+    sg_order_num = 0;
+}
+
+/**
+ * @brief run the loop every ms
+ * @return return value of the last app_timer_run()
+ */
+static uint32_t run_ms(uint32_t ms)
+{
+    uint32_t next = 0;
+
+    while (ms--) {
+        stub_delay_ms(1);
+        next = app_timer_run();
+    }
+    return next;
+}
+
+/**
+ * @brief periodic and one-shot deadlines are met to the ms across clock_time() wraps
+ */
+static void test_deadline(void)
+{
+    reset_timer(0xFFFF0000u);
+    app_timer_start(&sg_timer[0], 0, 10, timer0_cb);
+    app_timer_start(&sg_timer[1], 50, 0, timer1_cb);
+    app_timer_start(&sg_timer[2], 400000, 0, timer2_cb);
+    TEST_CHECK_EQ(app_timer_run(), 10);             /* 0 timeout: due now, next in a period */
+    TEST_CHECK_EQ(sg_fire_cnt[0], 1);
+
+    /* 400s: the 16MHz clock_time() wraps every 268s */
+    run_ms(400000);
+    /* timer 2 started first: it runs before the re-armed timer 0 due at the same ms, and stops it */
+    TEST_CHECK_EQ(sg_fire_cnt[0], 40000);
+    TEST_CHECK_EQ(sg_max_err, 0);
+    TEST_CHECK_EQ(sg_fire_cnt[1], 1);
+    TEST_CHECK_EQ(sg_fire_ms[1], 50);
+    TEST_CHECK_EQ(sg_fire_cnt[2], 1);
+    TEST_CHECK(!app_timer_is_active(&sg_timer[0]));  /* stopped by timer 2 */
+    TEST_CHECK_EQ(run_ms(1), APP_TIMER_NO_DEADLINE);
+}
+
+/**
+ * @brief the run returns the time to the next deadline, a stall does not fire a burst
+ */
+static void test_next_and_stall(void)
+{
+    reset_timer(0);
+    app_timer_start(&sg_timer[0], 10, 10, timer0_cb);
+    app_timer_start(&sg_timer[1], 25, 0, timer1_cb);
+    TEST_CHECK_EQ(app_timer_run(), 10);
+    stub_delay_ms(4);
+    TEST_CHECK_EQ(app_timer_run(), 6);
+
+    /* a 35ms stall: one late run, the period keeps its phase */
+    stub_delay_ms(31);
+    app_timer_run();
+    TEST_CHECK_EQ(sg_fire_cnt[0], 1);
+    TEST_CHECK_EQ(sg_fire_cnt[1], 1);
+    TEST_CHECK_EQ(app_timer_run(), 5);              /* next at 40 */
+    run_ms(5);
+    TEST_CHECK_EQ(sg_fire_cnt[0], 2);
+    TEST_CHECK_EQ(sg_fire_ms[0], 40);
+}
+
+/**
+ * @brief equal deadlines run in start order, a callback may restart its own timer
+ */
+static void test_order_and_restart(void)
+{
+    reset_timer(0);
+    app_timer_start(&sg_timer[4], 20, 0, timer4_cb);
+    app_timer_start(&sg_timer[1], 20, 0, timer1_cb);
+    app_timer_start(&sg_timer[3], 20, 0, timer3_cb);
+    run_ms(20);
+    TEST_CHECK_EQ(sg_order_num, 3);
+    TEST_CHECK_EQ(sg_order[0], 4);
+    TEST_CHECK_EQ(sg_order[1], 1);
+    TEST_CHECK_EQ(sg_order[2], 3);
+    run_ms(1000);
+    TEST_CHECK_EQ(sg_fire_cnt[3], 11);
+    TEST_CHECK_EQ(sg_fire_ms[3], 1020);
+
+    /* restart of a running timer moves it, stop of a stopped one is harmless */
+    app_timer_start(&sg_timer[1], 30, 0, timer1_cb);
+    app_timer_start(&sg_timer[1], 60, 0, timer1_cb);
+    app_timer_stop(&sg_timer[4]);
+    run_ms(59);
+    TEST_CHECK_EQ(sg_fire_cnt[1], 1);
+    run_ms(1);
+    TEST_CHECK_EQ(sg_fire_cnt[1], 2);
+}
+
+/**
+ * @brief cycles of a loop pass with the kettle's timers running: nothing due, and one due
+ */
+static void bench_loop(void)
+{
+    const uint32_t loop_num = 1000000;
+    uint64_t start, idle, due;
+    uint32_t i;
+
+    reset_timer(0);
+    /* as in the kettle: key scan, led, buzzer, temperature sample, ble wait */
+    app_timer_start(&sg_timer[0], 10, 10, timer1_cb);
+    app_timer_start(&sg_timer[1], 200, 200, timer1_cb);
+    app_timer_start(&sg_timer[2], 70, 70, timer1_cb);
+    app_timer_start(&sg_timer[3], 2000, 2000, timer1_cb);
+    app_timer_start(&sg_timer[4], 180000, 0, timer1_cb);
+
+    start = test_cycles();
+    for (i = 0; i < loop_num; i++) {
+        app_timer_run();
+    }
+    idle = test_cycles() - start;
+
+    start = test_cycles();
+    for (i = 0; i < loop_num; i++) {
+        stub_delay_ms(10);
+        app_timer_run();
+    }
+    due = test_cycles() - start;
+    printf("timer loop pass, 5 timers: %.1f cycles idle, %.1f cycles with the 10ms timer due\n",
+           (double)idle / loop_num, (double)due / loop_num);
+}
+
+int main(int argc, char *argv[])
+{
+    test_deadline();
+    test_next_and_stall();
+    test_order_and_restart();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_loop();
+    }
+    return test_result("test_timer");
+}
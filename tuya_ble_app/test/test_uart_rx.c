@@ -0,0 +1,260 @@
+/**
+ * @file test_uart_rx.c
+ * @brief host test and benchmark of the uart rx parser against the byte by byte parser it replaced,
+ *        built with the handler source to see the frame left by uart_data_unpack()
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "uart_ref.h"
+#include "../src/sdk/tuya_uart_common_handler.c"
+
+#define STREAM_SIZE     (1 << 20)
+#define CHUNK_MAX       40          /* bytes per rx handler call */
+#define FNV_INIT        1469598103934665603ull
+#define FNV_PRIME       1099511628211ull
+
+/* what the parser under test did */
+typedef struct {
+    uint32_t factory_num;           /* 0x66 frames dispatched */
+    uint64_t factory_hash;
+    uint32_t tx_num;                /* bytes sent: 0x55 status frame responses */
+    uint64_t tx_hash;
+    uint32_t report_num;            /* dp reports of the 0x55 status frames */
+} RX_RESULT_T;
+
+static uint8_t sg_stream[STREAM_SIZE];
+static uint32_t sg_stream_len;
+static uint32_t sg_frame_num;
+static RX_RESULT_T sg_result;
+static uint32_t sg_seed;
+
+static uint32_t get_rand(void)
+{
+    sg_seed = sg_seed * 1103515245u + 12345u;
+    return (sg_seed >> 16) & 0x7FFF;
+}
+
+static uint64_t hash(uint64_t h, const uint8_t *p, uint32_t len)
+{
+    while (len--) {
+        h = (h ^ *p++) * FNV_PRIME;
+    }
+    return h;
+}
+
+static void record_factory(u8 *p_data, u16 len)
+{
+    sg_result.factory_num++;
+    sg_result.factory_hash = hash(sg_result.factory_hash, p_data, len);
+}
+
+static void record_send(u8 *p_data, u16 len)
+{
+    sg_result.tx_num += len;
+    sg_result.tx_hash = hash(sg_result.tx_hash, p_data, len);
+}
+
+static void reset_result(void)
+{
+    stub_reset();
+    stub_uart_factory = record_factory;
+    stub_uart_send = record_send;
+    memset(&sg_result, 0, sizeof(sg_result));
+    sg_result.factory_hash = FNV_INIT;
+    sg_result.tx_hash = FNV_INIT;
+}
+
+/**
+ * @brief build a frame: head(2) version(1) cmd(1) len(2) data(len) sum(1)
+ * @return frame length
+ */
+static uint16_t build_frame(uint8_t *frame, uint8_t head, uint8_t cmd, uint16_t len)
+{
+    uint16_t i;
+
+    frame[0] = head;
+    frame[1] = 0xAA;
+    frame[2] = 0x00;
+    frame[3] = cmd;
+    frame[4] = len >> 8;
+    frame[5] = len;
+    for (i = 0; i < len; i++) {
+        frame[6 + i] = get_rand();
+    }
+    frame[6 + len] = check_sum(frame, 6 + len);
+    return 7 + len;
+}
+
+/**
+ * @brief noisy link: frames of the three heads, some too long or with a bad sum, and garbage between them
+ *        full of head and 0xAA bytes
+ */
+static void build_stream(void)
+{
+    static const uint8_t head[] = {0x55, 0x66, 0x77};
+    uint8_t *frame;
+    uint32_t r, i, gap;
+
+    sg_seed = 7;
+    sg_stream_len = 0;
+    sg_frame_num = 0;
+    while (sg_stream_len < STREAM_SIZE - 300) {
+        r = get_rand() % 10;
+        if (r < 2) {
+            gap = get_rand() % 20;
+            for (i = 0; i < gap; i++) {
+                sg_stream[sg_stream_len++] = (get_rand() % 4 == 0) ? 0xAA : ((get_rand() % 3 == 0) ? 0x66 : get_rand());
+            }
+        } else {
+            frame = sg_stream + sg_stream_len;
+            sg_stream_len += build_frame(frame, head[get_rand() % 3], (get_rand() % 3 == 0) ? TY_SEND_STATUS_TYPE : 0x20,
+                                         get_rand() % ((r == 9) ? 290 : 64));
+            if (get_rand() % 15 == 0) {
+                sg_stream[sg_stream_len - 1]++;
+            }
+            sg_frame_num++;
+        }
+    }
+}
+
+/**
+ * @brief feed the stream in chunks of 1 ~ CHUNK_MAX bytes, as the uart irq does, and drain the tx ring
+ */
+static void feed_stream(void (*rx_handler)(u8 *, u16))
+{
+    uint32_t i, n;
+
+    sg_seed = 11;
+    for (i = 0; i < sg_stream_len; i += n) {
+        n = 1 + get_rand() % CHUNK_MAX;
+        if (n > sg_stream_len - i) {
+            n = sg_stream_len - i;
+        }
+        rx_handler(sg_stream + i, n);
+        tuya_uart_tx_flush();
+    }
+}
+
+/**
+ * @brief the chunk parser dispatches the same frames and sends the same responses as the byte parser
+ */
+static void test_rx_differential(void)
+{
+    RX_RESULT_T ref;
+
+    build_stream();
+    reset_result();
+    feed_stream(ref_tuya_uart_rx_handler);
+    ref = sg_result;
+    ref.report_num = stub_dp_report_cnt;
+
+    reset_result();
+    feed_stream(tuya_uart_rx_handler);
+    sg_result.report_num = stub_dp_report_cnt;
+    printf("uart rx, %u frames: %u factory frames, %u reports, %u tx bytes\n",
+           sg_frame_num, sg_result.factory_num, sg_result.report_num, sg_result.tx_num);
+
+    TEST_CHECK(ref.factory_num > 1000);
+    TEST_CHECK(ref.tx_num > 1000);
+    TEST_CHECK_EQ(sg_result.factory_num, ref.factory_num);
+    TEST_CHECK_EQ(sg_result.factory_hash, ref.factory_hash);
+    TEST_CHECK_EQ(sg_result.tx_num, ref.tx_num);
+    TEST_CHECK_EQ(sg_result.tx_hash, ref.tx_hash);
+    TEST_CHECK_EQ(sg_result.report_num, ref.report_num);
+}
+
+/**
+ * @brief uart_data_unpack() byte by byte returns the same as the old byte parser and leaves the same frame
+ */
+static void test_byte_wrapper(void)
+{
+    uint32_t i, diff = 0, ok = 0, bad = 0;
+    uint8_t ret;
+
+    build_stream();
+    reset_result();
+    for (i = 0; i < sg_stream_len; i++) {
+        ret = uart_data_unpack(sg_stream[i]);
+        if (ret != ref_uart_data_unpack(sg_stream[i])) {
+            diff++;
+        } else if (ret == 0) {
+            ok++;
+            if ((uart_rx_len != ref_uart_rx_len) || (memcmp(uart_rx_buffer, ref_uart_rx_buffer(), uart_rx_len) != 0)) {
+                diff++;
+            }
+        } else if (ret == 2) {
+            bad++;
+        }
+    }
+    printf("uart_data_unpack: %u frames ok, %u bad sums\n", ok, bad);
+    TEST_CHECK(ok > 1000);
+    TEST_CHECK(bad > 100);
+    TEST_CHECK_EQ(diff, 0);
+}
+
+/**
+ * @brief one frame split at every point, and byte by byte, is dispatched once and whole
+ */
+static void test_split_frame(void)
+{
+    uint8_t frame[32];
+    uint16_t len, split;
+    uint64_t whole;
+
+    sg_seed = 3;
+    len = build_frame(frame, 0x66, 0x20, 20);
+    whole = hash(FNV_INIT, frame, len);
+    for (split = 1; split < len; split++) {
+        reset_result();
+        tuya_uart_rx_handler(frame, split);
+        tuya_uart_rx_handler(frame + split, len - split);
+        TEST_CHECK_EQ(sg_result.factory_num, 1);
+        TEST_CHECK_EQ(sg_result.factory_hash, whole);
+    }
+    reset_result();
+    for (split = 0; split < len; split++) {
+        tuya_uart_rx_handler(frame + split, 1);
+    }
+    TEST_CHECK_EQ(sg_result.factory_num, 1);
+    TEST_CHECK_EQ(sg_result.factory_hash, whole);
+}
+
+/**
+ * @brief MB/s and cycles per frame of the two parsers on the same stream
+ */
+static void bench_rx(void)
+{
+    static void (* const rx_handler[])(u8 *, u16) = {ref_tuya_uart_rx_handler, tuya_uart_rx_handler};
+    static const char *name[] = {"byte parser", "chunk parser"};
+    const uint8_t rep_num = 20;
+    uint64_t start;
+    clock_t time;
+    uint8_t i, rep;
+
+    build_stream();
+    for (i = 0; i < 2; i++) {
+        reset_result();
+        time = clock();
+        start = test_cycles();
+        for (rep = 0; rep < rep_num; rep++) {
+            feed_stream(rx_handler[i]);
+        }
+        start = test_cycles() - start;
+        time = clock() - time;
+        printf("uart rx, %s: %.1f MB/s, %.0f cycles per frame\n", name[i],
+               (double)sg_stream_len * rep_num / 1e6 / ((double)time / CLOCKS_PER_SEC),
+               (double)start / ((double)sg_frame_num * rep_num));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    test_rx_differential();
+    test_byte_wrapper();
+    test_split_frame();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_rx();
+    }
+    return test_result("test_uart_rx");
+}
@@ -0,0 +1,244 @@
+/**
+ * @file test_uart_tx.c
+ * @brief host test and benchmark of the uart tx ring against the blocking senders it replaced
+ */
+
+#include "test.h"
+#include "tuya_sdk_stub.h"
+#include "custom_app_uart_common_handler.h"
+#include "uart_ref.h"
+
+#define TX_RING_SIZE    512         /* UART_TX_RING_SIZE */
+#define TX_CHUNK        16          /* UART_TX_CHUNK */
+#define TX_DATA_MAX     (255 + 4)   /* UART_TX_DATA_MAX */
+/* the blocking sends overrun their stack buffer by a byte at these lengths and above */
+#define REF_SEND_MAX    (255 + 4)
+#define REF_FACTORY_MAX (256 - 7)
+#define WIRE_SIZE       (1 << 22)
+
+u32 ty_uart_protocol_send(u8 type, u8 *pdata, u16 len);
+u32 ty_uart_debug_send(u8 type, u8 *pdata, u16 len);
+u32 ty_uart_protocol_factory_send(u8 type, u8 *pdata, u8 len);
+void tuya_uart_rx_handler(u8 *uart_Data, u16 len);
+
+/* stand-in uart: the bytes on the wire */
+static uint8_t sg_wire[WIRE_SIZE];
+static uint32_t sg_wire_len;
+static uint16_t sg_send_max;        /* longest single send */
+static uint32_t sg_byte_cycles;     /* cycles a byte takes on the wire, 0-none */
+static uint32_t sg_seed;
+
+static uint32_t get_rand(void)
+{
+    sg_seed = sg_seed * 1103515245u + 12345u;
+    return (sg_seed >> 16) & 0x7FFF;
+}
+
+static void wire_send(u8 *p_data, u16 len)
+{
+    uint64_t end;
+
+    if (sg_wire_len + len <= WIRE_SIZE) {
+        memcpy(sg_wire + sg_wire_len, p_data, len);
+    }
+    sg_wire_len += len;
+    if (len > sg_send_max) {
+        sg_send_max = len;
+    }
+    /* a blocking send waits for the uart */
+    if (sg_byte_cycles != 0) {
+        end = test_cycles() + (uint64_t)sg_byte_cycles * len;
+        while (test_cycles() < end);
+    }
+}
+
+static void reset_wire(void)
+{
+    stub_reset();
+    stub_uart_send = wire_send;
+    sg_wire_len = 0;
+    sg_send_max = 0;
+    sg_byte_cycles = 0;
+}
+
+/**
+ * @brief send one random frame with the senders picked by sel
+ * @param[in] ref: 0-ring senders 1-blocking senders
+ * @return the sender's return
+ */
+static u32 send_frame(bool ref, uint8_t sel, uint8_t type, uint8_t *data, uint16_t len)
+{
+    switch (sel) {
+    case 0:
+        return ref ? ref_ty_uart_protocol_send(type, data, len) : ty_uart_protocol_send(type, data, len);
+    case 1:
+        return ref ? ref_ty_uart_debug_send(type, data, len) : ty_uart_debug_send(type, data, len);
+    default:
+        return ref ? ref_ty_uart_protocol_factory_send(type, data, len) : ty_uart_protocol_factory_send(type, data, len);
+    }
+}
+
+/**
+ * @brief random frames of the three senders, some too long
+ * @param[in] ref: 0-ring senders, drained after each 1-blocking senders
+ * @param[out] ret: sum of the returns
+ */
+static void send_frames(bool ref, uint32_t frame_num, uint32_t *ret)
+{
+    uint8_t data[300];
+    uint16_t len, i;
+
+    sg_seed = 3;
+    *ret = 0;
+    while (frame_num--) {
+        len = get_rand() % (TX_DATA_MAX + 4);
+        if (len == REF_SEND_MAX) {
+            len++;                              /* too long for both */
+        }
+        for (i = 0; i < len; i++) {
+            data[i] = get_rand();
+        }
+        i = get_rand() % 3;
+        *ret += send_frame(ref, i, get_rand(), data, (i == 2) ? (len % REF_FACTORY_MAX) : len);
+        if (!ref) {
+            tuya_uart_tx_flush();
+        }
+    }
+}
+
+/**
+ * @brief the ring senders put the same bytes on the wire as the blocking senders, in chunks
+ */
+static void test_byte_exact(void)
+{
+    static uint8_t ref_wire[WIRE_SIZE];
+    uint32_t ref_len, ref_ret, ret;
+
+    reset_wire();
+    send_frames(true, 20000, &ref_ret);
+    ref_len = sg_wire_len;
+    memcpy(ref_wire, sg_wire, ref_len);
+
+    reset_wire();
+    send_frames(false, 20000, &ret);
+    TEST_CHECK(ref_len > 100000);
+    TEST_CHECK(ref_len <= WIRE_SIZE);
+    TEST_CHECK(ref_ret > 0);                    /* some too long */
+    TEST_CHECK_EQ(ret, ref_ret);
+    TEST_CHECK_EQ(sg_wire_len, ref_len);
+    TEST_CHECK(memcmp(sg_wire, ref_wire, ref_len) == 0);
+    TEST_CHECK_EQ(sg_send_max, TX_CHUNK);
+}
+
+/**
+ * @brief a frame that does not fit in the ring sends chunks until it does: nothing is lost,
+ *        the wire gets every frame as the blocking senders sent it
+ */
+static void test_backpressure(void)
+{
+    static uint8_t ref_wire[WIRE_SIZE];
+    const uint32_t frame_num = 50;
+    uint8_t data[TX_DATA_MAX];
+    uint32_t ref_len, ret = 0, i;
+
+    reset_wire();
+    for (i = 0; i < frame_num; i++) {
+        memset(data, i, 200);
+        ref_ty_uart_protocol_send(0x20, data, 200 - i);
+    }
+    ref_len = sg_wire_len;
+    memcpy(ref_wire, sg_wire, ref_len);
+
+    /* no process or flush between the frames: the ring fills up after the second one */
+    reset_wire();
+    TEST_CHECK_EQ(tuya_uart_tx_free(), TX_RING_SIZE);
+    for (i = 0; i < frame_num; i++) {
+        memset(data, i, 200);
+        ret |= ty_uart_protocol_send(0x20, data, 200 - i);
+        TEST_CHECK(TX_RING_SIZE - tuya_uart_tx_free() >= 200 - i + 7);
+    }
+    TEST_CHECK_EQ(ret, 0);
+    TEST_CHECK(sg_wire_len > 0);
+    TEST_CHECK_EQ(sg_send_max, TX_CHUNK);
+    tuya_uart_tx_flush();
+    TEST_CHECK_EQ(tuya_uart_tx_free(), TX_RING_SIZE);
+    TEST_CHECK_EQ(sg_wire_len, ref_len);
+    TEST_CHECK(memcmp(sg_wire, ref_wire, ref_len) == 0);
+
+    /* the largest frame into a nearly full ring */
+    reset_wire();
+    ty_uart_protocol_send(0x20, data, 250);
+    ty_uart_protocol_send(0x20, data, TX_RING_SIZE - 1 - 2 * 7 - 250);
+    TEST_CHECK_EQ(tuya_uart_tx_free(), 1);
+    TEST_CHECK_EQ(ty_uart_debug_send(0x20, data, TX_DATA_MAX), 0);
+    tuya_uart_tx_flush();
+    TEST_CHECK_EQ(sg_wire_len, TX_RING_SIZE - 1 + TX_DATA_MAX + 7);
+    TEST_CHECK_EQ(sg_wire[TX_RING_SIZE - 1], 0x77);
+}
+
+/**
+ * @brief the flush empties the ring, a reset command from the mcu flushes what is queued
+ */
+static void test_flush(void)
+{
+    uint8_t data[100] = {0};
+    uint8_t reset_cmd[] = {0x55, 0xAA, 0x00, TUYA_BLE_UART_COMMON_RESET_TYPE, 0x00, 0x00, 0x00};
+
+    reset_wire();
+    ty_uart_protocol_send(0x20, data, sizeof(data));
+    ty_uart_debug_send(0x20, data, sizeof(data));
+    TEST_CHECK(tuya_uart_tx_free() < TX_RING_SIZE);
+    tuya_uart_tx_flush();
+    TEST_CHECK_EQ(tuya_uart_tx_free(), TX_RING_SIZE);
+    TEST_CHECK_EQ(sg_wire_len, 2 * (sizeof(data) + 7));
+    tuya_uart_tx_flush();
+    TEST_CHECK_EQ(sg_wire_len, 2 * (sizeof(data) + 7));
+
+    reset_wire();
+    ty_uart_protocol_send(0x20, data, sizeof(data));
+    reset_cmd[6] = check_sum(reset_cmd, 6);
+    tuya_uart_rx_handler(reset_cmd, sizeof(reset_cmd));
+    TEST_CHECK_EQ(tuya_uart_tx_free(), TX_RING_SIZE);
+    TEST_CHECK_EQ(sg_wire_len, sizeof(data) + 7);
+}
+
+/**
+ * @brief cycles the caller waits for a 64 byte frame, with the wire at 115200 baud of a 16MHz chip:
+ *        about 1389 cycles a byte
+ */
+static void bench_tx(void)
+{
+    const uint32_t frame_num = 200;
+    uint8_t data[64] = {0};
+    uint64_t start, ref, ring;
+    uint32_t i;
+
+    reset_wire();
+    sg_byte_cycles = CLOCK_SYS_CLOCK_HZ / (115200 / 10);
+    start = test_cycles();
+    for (i = 0; i < frame_num; i++) {
+        ref_ty_uart_protocol_send(0x20, data, sizeof(data));
+    }
+    ref = test_cycles() - start;
+
+    ring = 0;
+    for (i = 0; i < frame_num; i++) {
+        start = test_cycles();
+        ty_uart_protocol_send(0x20, data, sizeof(data));
+        ring += test_cycles() - start;
+        tuya_uart_tx_flush();
+    }
+    printf("uart tx, 64 byte frame: caller waits %.0f cycles blocking, %.0f cycles queued\n",
+           (double)ref / frame_num, (double)ring / frame_num);
+}
+
+int main(int argc, char *argv[])
+{
+    test_byte_exact();
+    test_backpressure();
+    test_flush();
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0)) {
+        bench_tx();
+    }
+    return test_result("test_uart_tx");
+}
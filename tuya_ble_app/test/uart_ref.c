@@ -0,0 +1,34 @@
+/**
+ * @file uart_ref.c
+ * @brief the uart handler as it was before the chunk parser and the tx ring (ref/), renamed ref_*,
+ *        the reference of test_uart_rx and test_uart_tx
+ */
+
+#define tuya_uart_common_send_bytes             ref_tuya_uart_common_send_bytes
+#define ty_uart_protocol_send                   ref_ty_uart_protocol_send
+#define ty_uart_debug_send                      ref_ty_uart_debug_send
+#define ty_uart_protocol_factory_send           ref_ty_uart_protocol_factory_send
+#define mcu_heartbeat_callback                  ref_mcu_heartbeat_callback
+#define ble_dpData_to_uart_dpData               ref_ble_dpData_to_uart_dpData
+#define uart_dpData_to_ble_dpData               ref_uart_dpData_to_ble_dpData
+#define uart_rx_len                             ref_uart_rx_len
+#define uart_timeout_handler                    ref_uart_timeout_handler
+#define uart_data_unpack                        ref_uart_data_unpack
+#define tuya_uart_send_ble_dpdata               ref_tuya_uart_send_ble_dpdata
+#define tuya_uart_send_ble_state                ref_tuya_uart_send_ble_state
+#define tuya_uart_common_handler                ref_tuya_uart_common_handler
+#define tuya_uart_debug_handler                 ref_tuya_uart_debug_handler
+#define tuya_uart_rx_handler                    ref_tuya_uart_rx_handler
+#define tuya_ble_custom_app_uart_common_process ref_tuya_ble_custom_app_uart_common_process
+
+#include "ref/tuya_uart_common_handler.c"
+
+/**
+ * @brief frame left by ref_uart_data_unpack()
+ * @param[in] none
+ * @return uart_rx_buffer, ref_uart_rx_len bytes
+ */
+u8 *ref_uart_rx_buffer(void)
+{
+    return uart_rx_buffer;
+}
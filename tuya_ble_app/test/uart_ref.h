@@ -0,0 +1,19 @@
+/**
+ * @file uart_ref.h
+ * @brief the uart handler before the chunk parser and the tx ring, see uart_ref.c
+ */
+
+#ifndef __UART_REF_H__
+#define __UART_REF_H__
+
+#include "tuya_sdk_stub.h"
+
+extern u16 ref_uart_rx_len;
+u8 ref_uart_data_unpack(u8 data);
+u8 *ref_uart_rx_buffer(void);
+void ref_tuya_uart_rx_handler(u8 *uart_Data, u16 len);
+u32 ref_ty_uart_protocol_send(u8 type, u8 *pdata, u16 len);
+u32 ref_ty_uart_debug_send(u8 type, u8 *pdata, u16 len);
+u32 ref_ty_uart_protocol_factory_send(u8 type, u8 *pdata, u8 len);
+
+#endif /* __UART_REF_H__ */